@@ -89,7 +89,7 @@ typedef struct SoundStreamInfoEx_
 typedef enum EIntConfigKey_
 {
 	zmusic_adl_chips_count,
-	zmusic_adl_emulator_id,
+	zmusic_adl_emulator_id,	// -1 picks the most accurate core that is fast enough on this machine, see zmusic_snd_fmrealtime.
 	zmusic_adl_run_at_pcm_rate,
 	zmusic_adl_fullpan,
 	zmusic_adl_bank,
@@ -110,7 +110,7 @@ typedef enum EIntConfigKey_
 	zmusic_opl_fullpan,
 
 	zmusic_opn_chips_count,
-	zmusic_opn_emulator_id,
+	zmusic_opn_emulator_id,	// -1 picks the most accurate core that is fast enough on this machine, see zmusic_snd_fmrealtime.
 	zmusic_opn_run_at_pcm_rate,
 	zmusic_opn_fullpan,
 	zmusic_opn_use_custom_bank,
@@ -160,6 +160,14 @@ typedef enum EIntConfigKey_
 	zmusic_opn_volume_model,
 	zmusic_opn_chan_alloc,
 	zmusic_opn_auto_arpeggio,
+
+	zmusic_snd_resampler_quality,
+	zmusic_snd_softclip,
+	zmusic_snd_songcache,	// memory budget in KiB for keeping loaded songs around for reopening them. 0 disables it. Shared by all contexts.
+	zmusic_snd_midiquantum,	// software MIDI synths render in blocks of this many samples and apply the events due inside a block at its start. 0 renders up to every event.
+	zmusic_snd_midisplit,	// spreads the MIDI channels over this many FluidSynth instances which render in parallel. 0 or 1 uses a single one. Takes effect when the next song starts.
+	zmusic_snd_wavebits,	// sample format for ZMusic_MIDIDumpWave: 16 or 24 write dithered integer PCM, 32 writes float.
+	zmusic_opl_resample,	// 1-3 makes the OPL synth convert its output from the chip rate to snd_outputrate itself, with the quality levels of zmusic_snd_resampler_quality. 0 outputs 49716 Hz. Takes effect when the next song starts.
 	
 	NUM_ZMUSIC_INT_CONFIGS
 } EIntConfigKey;
@@ -190,6 +198,7 @@ typedef enum EFloatConfigKey_
 	zmusic_opl_gain,
 	zmusic_adl_gain,
 	zmusic_opn_gain,
+	zmusic_snd_fmrealtime,	// realtime factor the automatic emulator choice of libADLMIDI and libOPNMIDI (emulator id -1) must reach for the configured chip count.
 	
 	NUM_FLOAT_CONFIGS
 } EFloatConfigKey;
@@ -286,6 +295,46 @@ typedef struct ZMusicConfigurationSetting_
 	const char* defaultString;
 } ZMusicConfigurationSetting;
 
+typedef struct ZMusicRenderAheadStats_
+{
+	uint32_t mUnderruns;		// Number of ZMusic_FillStream calls that could not be served completely from the buffer.
+	uint32_t mUnderrunBytes;	// Amount of silence that had to be inserted for them.
+	uint32_t mBufferedBytes;	// Current fill level.
+	uint32_t mLowWaterBytes;	// Lowest fill level ZMusic_FillStream has seen.
+	uint32_t mTargetBytes;		// Fill level the render thread tries to maintain for the song's current format.
+} ZMusicRenderAheadStats;
+
+typedef struct ZMusicPerfCounters_
+{
+	uint64_t mBlocks;				// Number of blocks the song has rendered since it was opened.
+	uint64_t mFrames;				// Number of frames in them.
+	uint64_t mRenderNanoseconds;	// Wall time spent rendering them.
+	uint64_t mEvents;				// MIDI events dispatched to a software synth.
+	uint64_t mBytesDecoded;			// Audio data produced by the decoder for compressed wave formats (Vorbis, FLAC, MP3 etc.).
+	uint32_t mLastBlockFrames;
+	uint32_t mLastBlockNanoseconds;
+	uint32_t mLastBlockEvents;
+	uint32_t mUnderruns;			// Same as in ZMusicRenderAheadStats. 0 if the song has no render-ahead buffer.
+	float mRealtimeFactor;			// Playback time divided by render time over all blocks. Above 1 is faster than realtime.
+	float mLastBlockRealtimeFactor;
+	int32_t mActiveVoices;			// Voices or channels currently sounding. -1 if the player cannot tell.
+} ZMusicPerfCounters;
+
+typedef struct ZMusicTempoChange_
+{
+	uint32_t mTime;				// Position in milliseconds.
+	uint32_t mTempo;			// Microseconds per quarter note.
+} ZMusicTempoChange;
+
+typedef struct ZMusicSongAnalysis_
+{
+	uint32_t mDuration;			// Length of one pass through the song in milliseconds.
+	int32_t mLoopStart;			// The part that gets repeated when playing looped, in milliseconds. -1 if the format cannot tell where a loop jumps to.
+	int32_t mLoopEnd;
+	int32_t mSubsongCount;
+	int32_t mTempoChanges;		// Total number of entries in the tempo map. Only MIDI songs have one.
+} ZMusicSongAnalysis;
+
 
 #ifndef ZMUSIC_INTERNAL
 #if defined(_MSC_VER) && !defined(ZMUSIC_STATIC)
@@ -296,6 +345,9 @@ typedef struct ZMusicConfigurationSetting_
 // Note that the internal 'class' definitions are not C compatible!
 typedef struct _ZMusic_MidiSource_Struct { int zm1; } *ZMusic_MidiSource;
 typedef struct _ZMusic_MusicStream_Struct { int zm2; } *ZMusic_MusicStream;
+typedef struct _ZMusic_Mixer_Struct { int zm3; } *ZMusic_Mixer;
+typedef struct _ZMusic_Context_Struct { int zm4; } *ZMusic_Context;
+typedef struct _ZMusic_SongLoader_Struct { int zm5; } *ZMusic_SongLoader;
 struct SoundDecoder;
 #endif
 
@@ -326,9 +378,21 @@ extern "C"
 	DLL_IMPORT ZMusic_MusicStream ZMusic_OpenSong(ZMusicCustomReader* reader, EMidiDevice device, const char* Args);
 	DLL_IMPORT ZMusic_MusicStream ZMusic_OpenSongFile(const char *filename, EMidiDevice device, const char* Args);
 	DLL_IMPORT ZMusic_MusicStream ZMusic_OpenSongMem(const void *mem, size_t size, EMidiDevice device, const char* Args);
+	// Like ZMusic_OpenSongMem but reads the memory in place. It must stay valid until 'release' gets called, which happens exactly once,
+	// as soon as the song does not need the data anymore - right after loading for most formats, on closing for streamed ones, or on failure.
+	DLL_IMPORT ZMusic_MusicStream ZMusic_OpenSongMemNoCopy(const void *mem, size_t size, void (*release)(void* userdata), void* userdata, EMidiDevice device, const char* Args);
 	DLL_IMPORT ZMusic_MusicStream ZMusic_OpenCDSong(int track, int cdid);
 
+	// Determines a song's length, loop points, subsong count and tempo map without playing it. Results are cached by the data's content,
+	// so asking again for the same song is cheap. Up to 'tempomapsize' entries of the tempo map get copied to 'tempomap', which may be NULL.
+	DLL_IMPORT zmusic_bool ZMusic_AnalyzeSong(ZMusicCustomReader* reader, int subsong, ZMusicSongAnalysis* analysis, ZMusicTempoChange* tempomap, int tempomapsize);
+	DLL_IMPORT zmusic_bool ZMusic_AnalyzeSongFile(const char* filename, int subsong, ZMusicSongAnalysis* analysis, ZMusicTempoChange* tempomap, int tempomapsize);
+	DLL_IMPORT zmusic_bool ZMusic_AnalyzeSongMem(const void* mem, size_t size, int subsong, ZMusicSongAnalysis* analysis, ZMusicTempoChange* tempomap, int tempomapsize);
+
 	DLL_IMPORT zmusic_bool ZMusic_FillStream(ZMusic_MusicStream stream, void* buff, int len);
+	// Renders up to 'frames' frames in the song's output format (see ZMusic_GetStreamInfoEx) as fast as possible, for writing songs to disk.
+	// Returns the number of frames written. If this is less than requested, the song has ended.
+	DLL_IMPORT size_t ZMusic_Render(ZMusic_MusicStream stream, size_t frames, void* buffer);
 	DLL_IMPORT zmusic_bool ZMusic_Start(ZMusic_MusicStream song, int subsong, zmusic_bool loop);
 	DLL_IMPORT void ZMusic_Pause(ZMusic_MusicStream song);
 	DLL_IMPORT void ZMusic_Resume(ZMusic_MusicStream song);
@@ -336,7 +400,11 @@ extern "C"
 	DLL_IMPORT zmusic_bool ZMusic_IsPlaying(ZMusic_MusicStream song);
 	DLL_IMPORT void ZMusic_Stop(ZMusic_MusicStream song);
 	DLL_IMPORT void ZMusic_Close(ZMusic_MusicStream song);
+	// If the song is busy rendering, this and ZMusic_SetPosition only queue the change and return true, so the result then just means
+	// that it has been queued. A queued change that fails gets reported through the message callback as a warning.
 	DLL_IMPORT zmusic_bool ZMusic_SetSubsong(ZMusic_MusicStream song, int subsong);
+	// Jumps to the given time. Works for MIDI on the software synths and for the stream formats that support it.
+	DLL_IMPORT zmusic_bool ZMusic_SetPosition(ZMusic_MusicStream song, unsigned int milliseconds);
 	DLL_IMPORT zmusic_bool ZMusic_IsLooping(ZMusic_MusicStream song);
 	DLL_IMPORT int ZMusic_GetDeviceType(ZMusic_MusicStream song);
 	DLL_IMPORT zmusic_bool ZMusic_IsMIDI(ZMusic_MusicStream song);
@@ -351,6 +419,56 @@ extern "C"
 	DLL_IMPORT zmusic_bool ChangeMusicSettingString(EStringConfigKey key, ZMusic_MusicStream song, const char* value);
 	DLL_IMPORT const char *ZMusic_GetStats(ZMusic_MusicStream song);
 
+	// Renders the song on a separate thread, keeping the given amount of audio buffered ahead, so that ZMusic_FillStream never has to wait for the synth.
+	// 0 turns it off again. Must not be called while another thread is inside ZMusic_FillStream for this song.
+	// Setting changes take effect with the buffer's delay, restarting, stopping or changing the subsong discards the buffered audio.
+	DLL_IMPORT zmusic_bool ZMusic_SetRenderAhead(ZMusic_MusicStream song, int milliseconds);
+	// Returns false if the song has no render-ahead buffer. With reset set the underrun counters and the low water mark start over.
+	DLL_IMPORT zmusic_bool ZMusic_GetRenderAheadStats(ZMusic_MusicStream song, ZMusicRenderAheadStats* stats, zmusic_bool reset);
+	// Machine readable counterpart of ZMusic_GetStats. Like that, this does not wait for a busy song and may return the state from before its current block.
+	DLL_IMPORT zmusic_bool ZMusic_GetPerfCounters(ZMusic_MusicStream song, ZMusicPerfCounters* counters);
+
+	// Renders any number of songs in parallel on a pool of worker threads and mixes them into one 32 bit float stereo stream.
+	// Songs must be playing at the mixer's sample rate when being added and must be removed before they get closed.
+	// A thread count of 0 uses all available hardware threads.
+	DLL_IMPORT ZMusic_Mixer ZMusic_CreateMixer(int samplerate, int numthreads);
+	DLL_IMPORT zmusic_bool ZMusic_MixerAdd(ZMusic_Mixer mixer, ZMusic_MusicStream song, float gain);
+	DLL_IMPORT void ZMusic_MixerRemove(ZMusic_Mixer mixer, ZMusic_MusicStream song);
+	DLL_IMPORT void ZMusic_MixerSetGain(ZMusic_Mixer mixer, ZMusic_MusicStream song, float gain);
+	DLL_IMPORT zmusic_bool ZMusic_MixerFill(ZMusic_Mixer mixer, void* buff, int len);
+	DLL_IMPORT void ZMusic_DestroyMixer(ZMusic_Mixer mixer);
+
+	// A context holds its own set of configuration settings, instrument caches and error state, so that different threads
+	// can open and configure songs independently. Songs belong to the context they were opened with and settings changed
+	// through a song always affect that song's context. The functions without a context parameter use the default context.
+	// New contexts start with the default settings but inherit the GENMIDI, WOPN and DMXGUS data that was set for the default context.
+	// Timidity++'s settings are global in the synth itself and remain shared between all contexts.
+	// A context may only be destroyed after all of its songs have been closed. Passing NULL for a context means the default one.
+	DLL_IMPORT ZMusic_Context ZMusic_CreateContext();
+	DLL_IMPORT void ZMusic_DestroyContext(ZMusic_Context ctx);
+	DLL_IMPORT const char* ZMusic_GetLastErrorCtx(ZMusic_Context ctx);
+	DLL_IMPORT ZMusic_MusicStream ZMusic_OpenSongCtx(ZMusic_Context ctx, ZMusicCustomReader* reader, EMidiDevice device, const char* Args);
+	DLL_IMPORT ZMusic_MusicStream ZMusic_OpenSongFileCtx(ZMusic_Context ctx, const char* filename, EMidiDevice device, const char* Args);
+	DLL_IMPORT ZMusic_MusicStream ZMusic_OpenSongMemCtx(ZMusic_Context ctx, const void* mem, size_t size, EMidiDevice device, const char* Args);
+	DLL_IMPORT ZMusic_MusicStream ZMusic_OpenSongMemNoCopyCtx(ZMusic_Context ctx, const void* mem, size_t size, void (*release)(void* userdata), void* userdata, EMidiDevice device, const char* Args);
+	DLL_IMPORT zmusic_bool ChangeMusicSettingIntCtx(ZMusic_Context ctx, EIntConfigKey key, ZMusic_MusicStream song, int value, int* pRealValue);
+	DLL_IMPORT zmusic_bool ChangeMusicSettingFloatCtx(ZMusic_Context ctx, EFloatConfigKey key, ZMusic_MusicStream song, float value, float* pRealValue);
+	DLL_IMPORT zmusic_bool ChangeMusicSettingStringCtx(ZMusic_Context ctx, EStringConfigKey key, ZMusic_MusicStream song, const char* value);
+
+	// Opens and starts a song on a separate thread, so that loading sound fonts, patches and banks does not hold up the caller.
+	// The loader uses the context's settings and instrument caches, so the context must not be used for anything else until the song has been collected.
+	// The callback may be NULL. Otherwise it gets called on the loader thread once the song is ready or has failed and must not call ZMusic_FinishSongLoad itself.
+	// The reader must stay valid until the load has finished and may get used from the loader thread.
+	// Every loader must be passed to either ZMusic_FinishSongLoad or ZMusic_CancelSongLoad, otherwise its thread and the song leak.
+	DLL_IMPORT ZMusic_SongLoader ZMusic_OpenSongAsync(ZMusic_Context ctx, ZMusicCustomReader* reader, EMidiDevice device, const char* Args, int subsong, zmusic_bool loop, void (*callback)(ZMusic_SongLoader loader, void* userdata), void* userdata);
+	DLL_IMPORT ZMusic_SongLoader ZMusic_OpenSongFileAsync(ZMusic_Context ctx, const char* filename, EMidiDevice device, const char* Args, int subsong, zmusic_bool loop, void (*callback)(ZMusic_SongLoader loader, void* userdata), void* userdata);
+	DLL_IMPORT ZMusic_SongLoader ZMusic_OpenSongMemAsync(ZMusic_Context ctx, const void* mem, size_t size, EMidiDevice device, const char* Args, int subsong, zmusic_bool loop, void (*callback)(ZMusic_SongLoader loader, void* userdata), void* userdata);
+	DLL_IMPORT zmusic_bool ZMusic_IsSongLoaded(ZMusic_SongLoader loader);
+	// Waits for the load to finish if needed and frees the loader. Returns NULL if the song could not be opened or started, with the error set for the context.
+	DLL_IMPORT ZMusic_MusicStream ZMusic_FinishSongLoad(ZMusic_SongLoader loader);
+	// Waits for the loader thread and frees the loader along with the song. A song that has not been started yet won't be.
+	DLL_IMPORT void ZMusic_CancelSongLoad(ZMusic_SongLoader loader);
+
 
 	DLL_IMPORT struct SoundDecoder* CreateDecoder(const uint8_t* data, size_t size, zmusic_bool isstatic);
 	DLL_IMPORT void SoundDecoder_GetInfo(struct SoundDecoder* decoder, int* samplerate, ChannelConfig* chans, SampleType* type);
@@ -416,8 +534,13 @@ typedef zmusic_bool (*pfn_ZMusic_MIDIDumpWave)(ZMusic_MidiSource source, EMidiDe
 typedef ZMusic_MusicStream (*pfn_ZMusic_OpenSong)(ZMusicCustomReader* reader, EMidiDevice device, const char* Args);
 typedef ZMusic_MusicStream (*pfn_ZMusic_OpenSongFile)(const char *filename, EMidiDevice device, const char* Args);
 typedef ZMusic_MusicStream (*pfn_ZMusic_OpenSongMem)(const void *mem, size_t size, EMidiDevice device, const char* Args);
+typedef ZMusic_MusicStream (*pfn_ZMusic_OpenSongMemNoCopy)(const void *mem, size_t size, void (*release)(void* userdata), void* userdata, EMidiDevice device, const char* Args);
 typedef ZMusic_MusicStream (*pfn_ZMusic_OpenCDSong)(int track, int cdid);
+typedef zmusic_bool (*pfn_ZMusic_AnalyzeSong)(ZMusicCustomReader* reader, int subsong, ZMusicSongAnalysis* analysis, ZMusicTempoChange* tempomap, int tempomapsize);
+typedef zmusic_bool (*pfn_ZMusic_AnalyzeSongFile)(const char* filename, int subsong, ZMusicSongAnalysis* analysis, ZMusicTempoChange* tempomap, int tempomapsize);
+typedef zmusic_bool (*pfn_ZMusic_AnalyzeSongMem)(const void* mem, size_t size, int subsong, ZMusicSongAnalysis* analysis, ZMusicTempoChange* tempomap, int tempomapsize);
 typedef zmusic_bool (*pfn_ZMusic_FillStream)(ZMusic_MusicStream stream, void* buff, int len);
+typedef size_t (*pfn_ZMusic_Render)(ZMusic_MusicStream stream, size_t frames, void* buffer);
 typedef zmusic_bool (*pfn_ZMusic_Start)(ZMusic_MusicStream song, int subsong, zmusic_bool loop);
 typedef void (*pfn_ZMusic_Pause)(ZMusic_MusicStream song);
 typedef void (*pfn_ZMusic_Resume)(ZMusic_MusicStream song);
@@ -426,6 +549,7 @@ typedef zmusic_bool (*pfn_ZMusic_IsPlaying)(ZMusic_MusicStream song);
 typedef void (*pfn_ZMusic_Stop)(ZMusic_MusicStream song);
 typedef void (*pfn_ZMusic_Close)(ZMusic_MusicStream song);
 typedef zmusic_bool (*pfn_ZMusic_SetSubsong)(ZMusic_MusicStream song, int subsong);
+typedef zmusic_bool (*pfn_ZMusic_SetPosition)(ZMusic_MusicStream song, unsigned int milliseconds);
 typedef zmusic_bool (*pfn_ZMusic_IsLooping)(ZMusic_MusicStream song);
 typedef zmusic_bool (*pfn_ZMusic_IsMIDI)(ZMusic_MusicStream song);
 typedef void (*pfn_ZMusic_VolumeChanged)(ZMusic_MusicStream song);
@@ -436,12 +560,37 @@ typedef zmusic_bool (*pfn_ChangeMusicSettingInt)(EIntConfigKey key, ZMusic_Music
 typedef zmusic_bool (*pfn_ChangeMusicSettingFloat)(EFloatConfigKey key, ZMusic_MusicStream song, float value, float* pRealValue);
 typedef zmusic_bool (*pfn_ChangeMusicSettingString)(EStringConfigKey key, ZMusic_MusicStream song, const char* value);
 typedef const char *(*pfn_ZMusic_GetStats)(ZMusic_MusicStream song);
+typedef zmusic_bool (*pfn_ZMusic_SetRenderAhead)(ZMusic_MusicStream song, int milliseconds);
+typedef zmusic_bool (*pfn_ZMusic_GetRenderAheadStats)(ZMusic_MusicStream song, ZMusicRenderAheadStats* stats, zmusic_bool reset);
+typedef zmusic_bool (*pfn_ZMusic_GetPerfCounters)(ZMusic_MusicStream song, ZMusicPerfCounters* counters);
 typedef struct SoundDecoder* (*pfn_CreateDecoder)(const uint8_t* data, size_t size, zmusic_bool isstatic);
 typedef void (*pfn_SoundDecoder_GetInfo)(struct SoundDecoder* decoder, int* samplerate, ChannelConfig* chans, SampleType* type);
 typedef size_t (*pfn_SoundDecoder_Read)(struct SoundDecoder* decoder, void* buffer, size_t length);
 typedef void (*pfn_SoundDecoder_Close)(struct SoundDecoder* decoder);
 typedef void (*pfn_FindLoopTags)(const uint8_t* data, size_t size, uint32_t* start, zmusic_bool* startass, uint32_t* end, zmusic_bool* endass);
 typedef const ZMusicMidiOutDevice *(*pfn_ZMusic_GetMidiDevices)(int *pAmount);
+typedef ZMusic_Mixer (*pfn_ZMusic_CreateMixer)(int samplerate, int numthreads);
+typedef zmusic_bool (*pfn_ZMusic_MixerAdd)(ZMusic_Mixer mixer, ZMusic_MusicStream song, float gain);
+typedef void (*pfn_ZMusic_MixerRemove)(ZMusic_Mixer mixer, ZMusic_MusicStream song);
+typedef void (*pfn_ZMusic_MixerSetGain)(ZMusic_Mixer mixer, ZMusic_MusicStream song, float gain);
+typedef zmusic_bool (*pfn_ZMusic_MixerFill)(ZMusic_Mixer mixer, void* buff, int len);
+typedef void (*pfn_ZMusic_DestroyMixer)(ZMusic_Mixer mixer);
+typedef ZMusic_Context (*pfn_ZMusic_CreateContext)();
+typedef void (*pfn_ZMusic_DestroyContext)(ZMusic_Context ctx);
+typedef const char* (*pfn_ZMusic_GetLastErrorCtx)(ZMusic_Context ctx);
+typedef ZMusic_MusicStream (*pfn_ZMusic_OpenSongCtx)(ZMusic_Context ctx, ZMusicCustomReader* reader, EMidiDevice device, const char* Args);
+typedef ZMusic_MusicStream (*pfn_ZMusic_OpenSongFileCtx)(ZMusic_Context ctx, const char* filename, EMidiDevice device, const char* Args);
+typedef ZMusic_MusicStream (*pfn_ZMusic_OpenSongMemCtx)(ZMusic_Context ctx, const void* mem, size_t size, EMidiDevice device, const char* Args);
+typedef ZMusic_MusicStream (*pfn_ZMusic_OpenSongMemNoCopyCtx)(ZMusic_Context ctx, const void* mem, size_t size, void (*release)(void* userdata), void* userdata, EMidiDevice device, const char* Args);
+typedef zmusic_bool (*pfn_ChangeMusicSettingIntCtx)(ZMusic_Context ctx, EIntConfigKey key, ZMusic_MusicStream song, int value, int* pRealValue);
+typedef zmusic_bool (*pfn_ChangeMusicSettingFloatCtx)(ZMusic_Context ctx, EFloatConfigKey key, ZMusic_MusicStream song, float value, float* pRealValue);
+typedef zmusic_bool (*pfn_ChangeMusicSettingStringCtx)(ZMusic_Context ctx, EStringConfigKey key, ZMusic_MusicStream song, const char* value);
+typedef ZMusic_SongLoader (*pfn_ZMusic_OpenSongAsync)(ZMusic_Context ctx, ZMusicCustomReader* reader, EMidiDevice device, const char* Args, int subsong, zmusic_bool loop, void (*callback)(ZMusic_SongLoader loader, void* userdata), void* userdata);
+typedef ZMusic_SongLoader (*pfn_ZMusic_OpenSongFileAsync)(ZMusic_Context ctx, const char* filename, EMidiDevice device, const char* Args, int subsong, zmusic_bool loop, void (*callback)(ZMusic_SongLoader loader, void* userdata), void* userdata);
+typedef ZMusic_SongLoader (*pfn_ZMusic_OpenSongMemAsync)(ZMusic_Context ctx, const void* mem, size_t size, EMidiDevice device, const char* Args, int subsong, zmusic_bool loop, void (*callback)(ZMusic_SongLoader loader, void* userdata), void* userdata);
+typedef zmusic_bool (*pfn_ZMusic_IsSongLoaded)(ZMusic_SongLoader loader);
+typedef ZMusic_MusicStream (*pfn_ZMusic_FinishSongLoad)(ZMusic_SongLoader loader);
+typedef void (*pfn_ZMusic_CancelSongLoad)(ZMusic_SongLoader loader);
 
 
 
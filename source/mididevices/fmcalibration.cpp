@@ -0,0 +1,232 @@
+/*
+** fmcalibration.cpp
+** Picks FM emulation cores by how fast they run on this machine
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <system_error>
+#include "zmusic/zmusic_internal.h"
+#include "fmcalibration.h"
+
+//==========================================================================
+//
+// FMCalibration Constructor
+//
+//==========================================================================
+
+FMCalibration::FMCalibration(const char *name, const int *cores, int count, const std::function<double(int)> &benchmark)
+	: Cores(cores, cores + count), Speeds(count)
+{
+	try
+	{
+		Thread = std::thread(&FMCalibration::Run, this, std::string(name), benchmark);
+	}
+	catch (const std::system_error &)
+	{
+		Run(name, benchmark);
+	}
+}
+
+//==========================================================================
+//
+// FMCalibration Destructor
+//
+//==========================================================================
+
+FMCalibration::~FMCalibration()
+{
+	if (Thread.joinable())
+	{
+		Thread.join();
+	}
+}
+
+//==========================================================================
+//
+// FMCalibration :: Run
+//
+//==========================================================================
+
+void FMCalibration::Run(const std::string &name, const std::function<double(int)> &benchmark)
+{
+	for (size_t i = 0; i < Cores.size(); i++)
+	{
+		Speeds[i] = benchmark(Cores[i]);
+		ZMusic_Printf(ZMUSIC_MSG_DEBUG, "%s emulator %d: %.1fx realtime per chip\n", name.c_str(), Cores[i], Speeds[i]);
+	}
+	Finished.store(true, std::memory_order_release);
+}
+
+//==========================================================================
+//
+// FMCalibration :: Measure
+//
+// Slow cores stop after 100 ms so that calibrating does not take ages,
+// fast ones get a second of audio for a stable figure.
+//
+//==========================================================================
+
+double FMCalibration::Measure(int samplerate, const std::function<void(float *, int)> &render)
+{
+	const int blocksize = 512;
+	std::vector<float> buffer(blocksize * 2);
+
+	// The first block pays for warming up the caches.
+	render(buffer.data(), blocksize);
+
+	auto start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::duration elapsed;
+	int64_t frames = 0;
+	do
+	{
+		render(buffer.data(), blocksize);
+		frames += blocksize;
+		elapsed = std::chrono::steady_clock::now() - start;
+	} while (frames < samplerate && elapsed < std::chrono::milliseconds(100));
+
+	double seconds = std::chrono::duration<double>(elapsed).count();
+	return seconds > 0 ? frames / (samplerate * seconds) : 0;
+}
+
+//==========================================================================
+//
+// FMCalibration :: Select
+//
+//==========================================================================
+
+int FMCalibration::Select(int numchips, double target) const
+{
+	int fastest = 0;
+	for (int i = 0; i < (int)Cores.size(); i++)
+	{
+		if (Speeds[i] / std::max(numchips, 1) >= target)
+		{
+			return i;
+		}
+		if (Speeds[i] > Speeds[fastest])
+		{
+			fastest = i;
+		}
+	}
+	return fastest;
+}
+
+//==========================================================================
+//
+// FMCalibration :: Faster
+//
+// The measurements are not precise enough to tell cores of about the same
+// speed apart, so only one that is half again as fast counts.
+//
+//==========================================================================
+
+int FMCalibration::Faster(int index) const
+{
+	for (int i = 0; i < (int)Cores.size(); i++)
+	{
+		if (Speeds[i] > Speeds[index] * 1.5)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+//==========================================================================
+//
+// FMAutoEmulator :: Select
+//
+//==========================================================================
+
+int FMAutoEmulator::Select(int numchips, double target)
+{
+	NumChips = numchips;
+	Target = target;
+	Overruns = 0;
+	Waiting = !Calibration.Ready();
+	if (Waiting)
+	{
+		return -1;
+	}
+	Index = Calibration.Select(numchips, target);
+	return Current();
+}
+
+//==========================================================================
+//
+// FMAutoEmulator :: Update
+//
+//==========================================================================
+
+int FMAutoEmulator::Update()
+{
+	if (!Waiting || !Calibration.Ready())
+	{
+		return -1;
+	}
+	return Select(NumChips, Target);
+}
+
+//==========================================================================
+//
+// FMAutoEmulator :: BlockRendered
+//
+// A single slow block can come from the thread being preempted, so only a
+// run of them makes this downgrade.
+//
+//==========================================================================
+
+int FMAutoEmulator::BlockRendered(uint64_t nanoseconds, int frames, int samplerate)
+{
+	if (frames <= 0 || samplerate <= 0 || Waiting)
+	{
+		return -1;
+	}
+	if (nanoseconds * samplerate <= uint64_t(frames) * 1000000000u)
+	{
+		Overruns = 0;
+		return -1;
+	}
+	if (++Overruns < 4)
+	{
+		return -1;
+	}
+	Overruns = 0;
+	int faster = Calibration.Faster(Index);
+	if (faster < 0)
+	{
+		return -1;
+	}
+	Index = faster;
+	return Current();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Speed of one library's emulation cores on this machine, measured with a single chip.
+// The candidates are listed from most to least accurate.
+
+class FMCalibration
+{
+public:
+	// The benchmark renders one chip with the given core and returns how many times faster than
+	// realtime that ran, or 0 if the core is not available. It runs on a thread of its own, because
+	// going through all the cores takes a noticeable amount of time.
+	FMCalibration(const char *name, const int *cores, int count, const std::function<double(int)> &benchmark);
+	~FMCalibration();
+
+	// Nothing below may be used before this returns true.
+	bool Ready() const { return Finished.load(std::memory_order_acquire); }
+
+	// Index of the most accurate candidate that renders numchips at least 'target' times faster than realtime.
+	// If none does, the fastest available one.
+	int Select(int numchips, double target) const;
+	// Index of the most accurate candidate that is clearly faster than the given one, or -1.
+	int Faster(int index) const;
+
+	int Core(int index) const { return Cores[index]; }
+	double Speed(int index) const { return Speeds[index]; }
+
+	// Renders stereo blocks through the callback until the figure is stable and returns the realtime factor.
+	static double Measure(int samplerate, const std::function<void(float *, int)> &render);
+
+private:
+	void Run(const std::string &name, const std::function<double(int)> &benchmark);
+
+	std::vector<int> Cores;
+	std::vector<double> Speeds;
+	std::atomic<bool> Finished{ false };
+	std::thread Thread;
+};
+
+// Automatic core selection for one playing device. The device reports every block it renders
+// and switches to a cheaper core when this asks for it. Until the calibration is done the device
+// keeps playing with the core it has.
+
+class FMAutoEmulator
+{
+public:
+	FMAutoEmulator(const FMCalibration &calibration) : Calibration(calibration) {}
+
+	// Returns the core to switch to, or -1 if the calibration is still running.
+	int Select(int numchips, double target);
+	// Returns the core picked by the last Select once the calibration has finished, otherwise -1.
+	int Update();
+	// Returns the core to switch to after a run of blocks that took longer to render than to play, or -1.
+	int BlockRendered(uint64_t nanoseconds, int frames, int samplerate);
+	int Current() const { return Calibration.Core(Index); }
+
+private:
+	const FMCalibration &Calibration;
+	int Index = 0;
+	int Overruns = 0;
+	bool Waiting = false;	// Select got called before the calibration was ready.
+	int NumChips = 1;
+	double Target = 0;
+};
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <functional>
 #include <mutex>
+#include <vector>
 #include "zmusic/midiconfig.h"
 #include "zmusic/mididefs.h"
 
@@ -42,6 +44,7 @@ public:
 	virtual int UnprepareHeader(MidiHeader *data);
 	virtual bool FakeVolume();
 	virtual bool Pause(bool paused) = 0;
+	virtual bool FlushStream();
 	virtual void InitPlayback();
 	virtual bool Update();
 	virtual void PrecacheInstruments(const uint16_t *instruments, int count);
@@ -49,6 +52,7 @@ public:
 	virtual void ChangeSettingNum(const char *setting, double value);
 	virtual void ChangeSettingString(const char *setting, const char *value);
 	virtual std::string GetStats();
+	virtual void GetPerfCounters(ZMusicPerfCounters &counters) {}
 	virtual int GetDeviceType() const { return MDEV_DEFAULT; }
 	virtual bool CanHandleSysex() const { return true; }
 	virtual SoundStreamInfoEx GetStreamInfoEx() const;
@@ -63,6 +67,7 @@ protected:
 class SoftSynthMIDIDevice : public MIDIDevice
 {
 	friend class MIDIWaveWriter;
+	friend class SplitMIDIDevice;
 public:
 	SoftSynthMIDIDevice(int samplerate, int minrate = 1, int maxrate = 1000000 /* something higher than any valid value */);
 	~SoftSynthMIDIDevice();
@@ -77,11 +82,13 @@ public:
 	int Resume() override;
 	void Stop() override;
 	bool Pause(bool paused) override;
+	bool FlushStream() override;
 
 	virtual int Open() override;
 	virtual bool ServiceStream(void* buff, int numbytes);
 	int GetSampleRate() const { return SampleRate; }
 	SoundStreamInfoEx GetStreamInfoEx() const override;
+	void GetPerfCounters(ZMusicPerfCounters &counters) override;
 
 protected:
 	double Tempo;
@@ -95,6 +102,8 @@ protected:
 	uint32_t Position;
 	int SampleRate;
 	int StreamBlockSize = 2;
+	uint64_t EventCount = 0;
+	uint32_t LastBlockEvents = 0;
 
 	virtual void CalcTickRate();
 	int PlayTick();
@@ -127,6 +136,7 @@ public:
 	void ComputeOutput(float *buffer, int len) override { playDevice->ComputeOutput(buffer, len);  }
 	int StreamOutSync(MidiHeader *data) override { return playDevice->StreamOutSync(data); }
 	int StreamOut(MidiHeader *data) override { return playDevice->StreamOut(data); }
+	bool FlushStream() override { return playDevice->FlushStream(); }
 	int GetDeviceType() const override { return playDevice->GetDeviceType(); }
 	bool ServiceStream (void *buff, int numbytes) override { return playDevice->ServiceStream(buff, numbytes); }
 	int GetTechnology() const override { return playDevice->GetTechnology(); }
@@ -136,8 +146,16 @@ public:
 	void CalcTickRate() override { playDevice->CalcTickRate(); }
 
 protected:
+	int WriteSamples(const float *samples, size_t count);
+
+	// Size of each of the two write buffers, in 4096 float chunks.
+	enum { WriteBufferChunks = 64 };
+
 	FILE *File;
 	SoftSynthMIDIDevice *playDevice;
+	int BitsPerSample = 32;
+	uint32_t DitherSeed = 1;
+	std::vector<uint8_t> Converted;
 };
 
 
@@ -146,10 +164,11 @@ protected:
 MIDIDevice *CreateFluidSynthMIDIDevice(int samplerate, const char *Args);
 MIDIDevice *CreateADLMIDIDevice(const char* args);
 MIDIDevice *CreateOPNMIDIDevice(const char *args);
-MIDIDevice *CreateOplMIDIDevice(const char* Args);
+MIDIDevice *CreateOplMIDIDevice(const char* Args, int samplerate);
 MIDIDevice *CreateTimidityMIDIDevice(const char* Args, int samplerate);
 MIDIDevice *CreateTimidityPPMIDIDevice(const char *Args, int samplerate);
 MIDIDevice *CreateWildMIDIDevice(const char *Args, int samplerate);
+MIDIDevice *CreateSplitMIDIDevice(const std::function<MIDIDevice *()> &factory);
 
 #ifdef _WIN32
 MIDIDevice* CreateWinMIDIDevice(int mididevice);
@@ -36,17 +36,20 @@
 
 #include <stdexcept>
 #include <stdlib.h>
+#include <chrono>
+#include <memory>
 
 #include "zmusic/zmusic_internal.h"
+#include "zmusic/simd.h"
+#include "zmusic/threadpool.h"
 #include "mididevice.h"
+#include "fmcalibration.h"
 
 #ifdef HAVE_ADL
 #include "adlmidi.h"
 #include "wopl/wopl_file.h"
 #include "oplsynth/genmidi.h"
 
-ADLConfig adlConfig;
-
 class ADLMIDIDevice : public SoftSynthMIDIDevice
 {
 	struct ADL_MIDIPlayer *Renderer;
@@ -57,6 +60,7 @@ class ADLMIDIDevice : public SoftSynthMIDIDevice
 	bool use_custom_bank;
 	bool use_genmidi;
 	int last_bank;
+	std::unique_ptr<FMAutoEmulator> AutoEmulator;	// set when the emulator gets picked by speed
 public:
 	ADLMIDIDevice(const ADLConfig *config);
 	~ADLMIDIDevice();
@@ -72,9 +76,11 @@ protected:
 	void HandleEvent(int status, int parm1, int parm2) override;
 	void HandleLongEvent(const uint8_t *data, int len) override;
 	void ComputeOutput(float *buffer, int len) override;
+	bool ServiceStream(void *buff, int numbytes) override;
 	
 private:
 	void initGain();
+	void SetEmulator(int emulator);
 	int LoadCustomBank(const ADLConfig *config);
 	void OP2_To_WOPL(const ADLConfig *config);
 };
@@ -91,6 +97,63 @@ enum
 	ME_PITCHWHEEL = 0xE0
 };
 
+static const ADLMIDI_AudioFormat audio_output_format =
+{
+	ADLMIDI_SampleType_F32,
+	sizeof(float),
+	2 * sizeof(float)
+};
+
+//==========================================================================
+//
+// ADLParallelFor
+//
+// Renders libADLMIDI's chips on the shared worker pool.
+//
+//==========================================================================
+
+static void ADLParallelFor(void *, int count, void (*job)(void *, int), void *jobdata)
+{
+	WorkerPool::Shared().Run(count, [=](int i) { job(jobdata, i); });
+}
+
+//==========================================================================
+//
+// ADLCalibration
+//
+// The OPL3 cores from most to least accurate. The OPL2 only cores cannot
+// play the 4-op and stereo parts of the banks and ESFMu emulates a
+// different chip, so automatic selection does not consider them.
+//
+//==========================================================================
+
+static const FMCalibration &ADLCalibration()
+{
+	static const int cores[] = { ADLMIDI_EMU_NUKED_OPL3_LLE, ADLMIDI_EMU_NUKED, ADLMIDI_EMU_NUKED_174, ADLMIDI_EMU_YMFM_OPL3, ADLMIDI_EMU_JAVA, ADLMIDI_EMU_DOSBOX, ADLMIDI_EMU_OPAL };
+	static const FMCalibration calibration("libADLMIDI", cores, int(sizeof(cores) / sizeof(cores[0])), [](int core)
+	{
+		ADL_MIDIPlayer *player = adl_init(44100);
+		double speed = 0;
+		if (player != nullptr && adl_switchEmulator(player, core) == 0)
+		{
+			adl_setNumChips(player, 1);
+			// Keep all voices busy. Idle chips do not get emulated at all.
+			for (int chan = 0; chan < 16; chan++)
+			{
+				adl_rt_patchChange(player, chan, chan * 8);
+				adl_rt_noteOn(player, chan, 48 + chan, 100);
+			}
+			speed = FMCalibration::Measure(44100, [=](float *buffer, int frames)
+			{
+				adl_generateFormat(player, frames * 2, reinterpret_cast<ADL_UInt8*>(buffer), reinterpret_cast<ADL_UInt8*>(buffer + 1), &audio_output_format);
+			});
+		}
+		if (player != nullptr) adl_close(player);
+		return speed;
+	});
+	return calibration;
+}
+
 //==========================================================================
 //
 // ADLMIDIDevice Constructor
@@ -105,7 +168,6 @@ ADLMIDIDevice::ADLMIDIDevice(const ADLConfig *config)
 	ConfigGainFactor = 1.0f;
 	if (Renderer != nullptr)
 	{
-		adl_switchEmulator(Renderer, config->adl_emulator_id);
 		adl_setRunAtPcmRate(Renderer, config->adl_run_at_pcm_rate);
 		last_bank = config->adl_bank;
 		use_genmidi = config->adl_use_genmidi;
@@ -114,10 +176,12 @@ ADLMIDIDevice::ADLMIDIDevice(const ADLConfig *config)
 		if (!LoadCustomBank(config))
 			adl_setBank(Renderer, config->adl_bank);
 		adl_setNumChips(Renderer, config->adl_chips_count);
+		SetEmulator(config->adl_emulator_id);	// after the chip count, which the automatic choice depends on
 		adl_setVolumeRangeModel(Renderer, config->adl_volume_model);
 		adl_setChannelAllocMode(Renderer, config->adl_chan_alloc);
 		adl_setSoftPanEnabled(Renderer, config->adl_fullpan);
 		adl_setAutoArpeggio(Renderer, (int)config->adl_auto_arpeggio);
+		adl_setParallelForHook(Renderer, ADLParallelFor, nullptr);
 		ConfigGainFactor = config->adl_gain;
 		initGain();
 	}
@@ -358,11 +422,16 @@ void ADLMIDIDevice::ChangeSettingInt(const char *setting, int value)
 	}
 	else if (strcmp(setting, "emulator") == 0)
 	{
-		adl_switchEmulator(Renderer, value);
+		SetEmulator(value);
 	}
 	else if (strcmp(setting, "numchips") == 0)
 	{
 		adl_setNumChips(Renderer, value);
+		int core = AutoEmulator != nullptr ? AutoEmulator->Select(adl_getNumChips(Renderer), currentContext->miscConfig.snd_fmrealtime) : -1;
+		if (core >= 0)
+		{
+			adl_switchEmulator(Renderer, core);
+		}
 	}
 	else if (strcmp(setting, "fullpan") == 0)
 	{
@@ -467,6 +536,32 @@ void ADLMIDIDevice::ChangeSettingString(const char *setting, const char *value)
 	}
 }
 
+//==========================================================================
+//
+// ADLMIDIDevice :: SetEmulator
+//
+// -1 picks the most accurate core that can render the current number of
+// chips fast enough. The cores get measured in the background the first
+// time, until then the device stays with the core it has.
+//
+//==========================================================================
+
+void ADLMIDIDevice::SetEmulator(int emulator)
+{
+	if (emulator < 0)
+	{
+		AutoEmulator.reset(new FMAutoEmulator(ADLCalibration()));
+		emulator = AutoEmulator->Select(adl_getNumChips(Renderer), currentContext->miscConfig.snd_fmrealtime);
+		// While the cores are still being measured the current one keeps playing.
+		if (emulator < 0) return;
+	}
+	else
+	{
+		AutoEmulator.reset();
+	}
+	adl_switchEmulator(Renderer, emulator);
+}
+
 //==========================================================================
 //
 // ADLMIDIDevice :: HandleEvent
@@ -521,13 +616,6 @@ void ADLMIDIDevice::HandleLongEvent(const uint8_t *data, int len)
 	adl_rt_systemExclusive(Renderer, data, len);
 }
 
-static const ADLMIDI_AudioFormat audio_output_format =
-{
-	ADLMIDI_SampleType_F32,
-	sizeof(float),
-	2 * sizeof(float)
-};
-
 //==========================================================================
 //
 // ADLMIDIDevice :: ComputeOutput
@@ -539,10 +627,39 @@ void ADLMIDIDevice::ComputeOutput(float *buffer, int len)
 	ADL_UInt8* left = reinterpret_cast<ADL_UInt8*>(buffer);
 	ADL_UInt8* right = reinterpret_cast<ADL_UInt8*>(buffer + 1);
 	auto result = adl_generateFormat(Renderer, len * 2, left, right, &audio_output_format);
-	for(int i=0; i < result; i++)
+	SIMD::ConvertSamples(buffer, SIMD::Sample_Float32, buffer, SIMD::Sample_Float32, result, OutputGainFactor, currentContext->miscConfig.snd_softclip);
+}
+
+//==========================================================================
+//
+// ADLMIDIDevice :: ServiceStream
+//
+// With an automatically picked core, switches to it once the measurements
+// are in and falls back to a cheaper one when rendering cannot keep up.
+//
+//==========================================================================
+
+bool ADLMIDIDevice::ServiceStream(void *buff, int numbytes)
+{
+	if (AutoEmulator == nullptr)
+	{
+		return SoftSynthMIDIDevice::ServiceStream(buff, numbytes);
+	}
+	int picked = AutoEmulator->Update();
+	if (picked >= 0)
+	{
+		adl_switchEmulator(Renderer, picked);
+	}
+	auto start = std::chrono::steady_clock::now();
+	bool ret = SoftSynthMIDIDevice::ServiceStream(buff, numbytes);
+	auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	int core = AutoEmulator->BlockRendered(time, numbytes / (2 * sizeof(float)), SampleRate);
+	if (core >= 0)
 	{
-		buffer[i] *= OutputGainFactor;
+		adl_switchEmulator(Renderer, core);
+		ZMusic_Printf(ZMUSIC_MSG_NOTIFY, "libADLMIDI cannot keep up, switching to %s.\n", adl_chipEmulatorName(Renderer));
 	}
+	return ret;
 }
 
 //==========================================================================
@@ -598,13 +715,11 @@ void ADLMIDIDevice::initGain()
 //
 //==========================================================================
 
-extern ADLConfig adlConfig;
-
 MIDIDevice *CreateADLMIDIDevice(const char *Args)
 {
-	ADLConfig config = adlConfig;
+	ADLConfig config = currentContext->adlConfig;
 
-	const char* bank = Args && *Args ? Args : adlConfig.adl_use_custom_bank ? adlConfig.adl_custom_bank.c_str() : nullptr;
+	const char* bank = Args && *Args ? Args : currentContext->adlConfig.adl_use_custom_bank ? currentContext->adlConfig.adl_custom_bank.c_str() : nullptr;
 	if (bank && *bank)
 	{
 		if (*bank >= '0' && *bank <= '9')
@@ -521,6 +521,6 @@ bool AlsaMIDIDevice::Update()
 
 MIDIDevice *CreateAlsaMIDIDevice(int mididevice)
 {
-	return new AlsaMIDIDevice(mididevice, miscConfig.snd_midiprecache);
+	return new AlsaMIDIDevice(mididevice, currentContext->miscConfig.snd_midiprecache);
 }
 #endif
@@ -108,6 +108,20 @@ bool MIDIDevice::FakeVolume()
 	return false;
 }
 
+//==========================================================================
+//
+// MIDIDevice :: FlushStream
+//
+// Drops all buffers that have been queued with StreamOut but not played
+// yet. Devices that hand their buffers to the system cannot do this.
+//
+//==========================================================================
+
+bool MIDIDevice::FlushStream()
+{
+	return false;
+}
+
 //==========================================================================
 //
 //
@@ -813,5 +813,5 @@ void CoreMIDIDevice::SendMIDIData(const uint8_t* data, size_t length, MIDITimeSt
 
 MIDIDevice* CreateCoreMIDIDevice(int mididevice)
 {
-	return new CoreMIDIDevice(mididevice, miscConfig.snd_midiprecache);
+	return new CoreMIDIDevice(mididevice, currentContext->miscConfig.snd_midiprecache);
 }
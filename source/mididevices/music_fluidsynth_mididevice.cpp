@@ -45,8 +45,6 @@
 
 // FluidSynth implementation of a MIDI device -------------------------------
 
-FluidConfig fluidConfig;
-
 #include "../thirdparty/fluidsynth/include/fluidsynth.h"
 
 class FluidSynthMIDIDevice : public SoftSynthMIDIDevice
@@ -57,6 +55,7 @@ public:
 	
 	int OpenRenderer() override;
 	std::string GetStats() override;
+	void GetPerfCounters(ZMusicPerfCounters &counters) override;
 	void ChangeSettingInt(const char *setting, int value) override;
 	void ChangeSettingNum(const char *setting, double value) override;
 	void ChangeSettingString(const char *setting, const char *value) override;
@@ -105,7 +104,7 @@ const char *BaseFileSearch(const char *file, const char *ext, bool lookfirstinpr
 //==========================================================================
 
 FluidSynthMIDIDevice::FluidSynthMIDIDevice(int samplerate, std::vector<std::string> &config)
-	: SoftSynthMIDIDevice(samplerate <= 0? fluidConfig.fluid_samplerate : samplerate, 22050, 96000)
+	: SoftSynthMIDIDevice(samplerate <= 0? currentContext->fluidConfig.fluid_samplerate : samplerate, 22050, 96000)
 {
 	StreamBlockSize = 4;
 
@@ -119,22 +118,22 @@ FluidSynthMIDIDevice::FluidSynthMIDIDevice(int samplerate, std::vector<std::stri
 	}
 	fluid_settings_setint(FluidSettings, "synth.dynamic-sample-loading", 1);
 	fluid_settings_setnum(FluidSettings, "synth.sample-rate", SampleRate);
-	fluid_settings_setnum(FluidSettings, "synth.gain", fluidConfig.fluid_gain);
-	fluid_settings_setint(FluidSettings, "synth.reverb.active", fluidConfig.fluid_reverb);
-	fluid_settings_setint(FluidSettings, "synth.chorus.active", fluidConfig.fluid_chorus);
-	fluid_settings_setint(FluidSettings, "synth.polyphony", fluidConfig.fluid_voices);
-	fluid_settings_setint(FluidSettings, "synth.cpu-cores", fluidConfig.fluid_threads);
+	fluid_settings_setnum(FluidSettings, "synth.gain", currentContext->fluidConfig.fluid_gain);
+	fluid_settings_setint(FluidSettings, "synth.reverb.active", currentContext->fluidConfig.fluid_reverb);
+	fluid_settings_setint(FluidSettings, "synth.chorus.active", currentContext->fluidConfig.fluid_chorus);
+	fluid_settings_setint(FluidSettings, "synth.polyphony", currentContext->fluidConfig.fluid_voices);
+	fluid_settings_setint(FluidSettings, "synth.cpu-cores", currentContext->fluidConfig.fluid_threads);
 	FluidSynth = new_fluid_synth(FluidSettings);
 	if (FluidSynth == NULL)
 	{
 		delete_fluid_settings(FluidSettings);
 		throw std::runtime_error("Failed to create FluidSynth.\n");
 	}
-	fluid_synth_set_interp_method(FluidSynth, -1, fluidConfig.fluid_interp);
-	fluid_synth_set_reverb(FluidSynth, fluidConfig.fluid_reverb_roomsize, fluidConfig.fluid_reverb_damping,
-		fluidConfig.fluid_reverb_width, fluidConfig.fluid_reverb_level);
-	fluid_synth_set_chorus(FluidSynth, fluidConfig.fluid_chorus_voices, fluidConfig.fluid_chorus_level,
-		fluidConfig.fluid_chorus_speed, fluidConfig.fluid_chorus_depth, fluidConfig.fluid_chorus_type);
+	fluid_synth_set_interp_method(FluidSynth, -1, currentContext->fluidConfig.fluid_interp);
+	fluid_synth_set_reverb(FluidSynth, currentContext->fluidConfig.fluid_reverb_roomsize, currentContext->fluidConfig.fluid_reverb_damping,
+		currentContext->fluidConfig.fluid_reverb_width, currentContext->fluidConfig.fluid_reverb_level);
+	fluid_synth_set_chorus(FluidSynth, currentContext->fluidConfig.fluid_chorus_voices, currentContext->fluidConfig.fluid_chorus_level,
+		currentContext->fluidConfig.fluid_chorus_speed, currentContext->fluidConfig.fluid_chorus_depth, currentContext->fluidConfig.fluid_chorus_type);
 
 	// try loading a patch set that got specified with $mididevice.
 
@@ -347,11 +346,11 @@ void FluidSynthMIDIDevice::ChangeSettingNum(const char *setting, double value)
 
 	if (strcmp(setting, "z.reverb") == 0)
 	{
-		fluid_synth_set_reverb(FluidSynth, fluidConfig.fluid_reverb_roomsize, fluidConfig.fluid_reverb_damping, fluidConfig.fluid_reverb_width, fluidConfig.fluid_reverb_level);
+		fluid_synth_set_reverb(FluidSynth, currentContext->fluidConfig.fluid_reverb_roomsize, currentContext->fluidConfig.fluid_reverb_damping, currentContext->fluidConfig.fluid_reverb_width, currentContext->fluidConfig.fluid_reverb_level);
 	}
 	else if (strcmp(setting, "z.chorus") == 0)
 	{
-		fluid_synth_set_chorus(FluidSynth, fluidConfig.fluid_chorus_voices, fluidConfig.fluid_chorus_level, fluidConfig.fluid_chorus_speed, fluidConfig.fluid_chorus_depth, fluidConfig.fluid_chorus_type);
+		fluid_synth_set_chorus(FluidSynth, currentContext->fluidConfig.fluid_chorus_voices, currentContext->fluidConfig.fluid_chorus_level, currentContext->fluidConfig.fluid_chorus_speed, currentContext->fluidConfig.fluid_chorus_depth, currentContext->fluidConfig.fluid_chorus_type);
 	}
 	else if (FluidSettingsResultFailed == fluid_settings_setnum(FluidSettings, setting, value))
 	{
@@ -409,6 +408,18 @@ std::string FluidSynthMIDIDevice::GetStats()
 	return out;
 }
 
+//==========================================================================
+//
+// FluidSynthMIDIDevice :: GetPerfCounters
+//
+//==========================================================================
+
+void FluidSynthMIDIDevice::GetPerfCounters(ZMusicPerfCounters &counters)
+{
+	SoftSynthMIDIDevice::GetPerfCounters(counters);
+	if (FluidSynth != nullptr) counters.mActiveVoices = fluid_synth_get_active_voice_count(FluidSynth);
+}
+
 //
 // sndfile
 //
@@ -422,7 +433,7 @@ extern "C" unsigned __stdcall GetSystemDirectoryA(char* lpBuffer, unsigned uSize
 
 void Fluid_SetupConfig(const char* patches, std::vector<std::string> &patch_paths, bool systemfallback)
 {
-	if (*patches == 0) patches = fluidConfig.fluid_patchset.c_str();
+	if (*patches == 0) patches = currentContext->fluidConfig.fluid_patchset.c_str();
 
 	//Resolve the paths here, the renderer will only get a final list of file names.
 
@@ -37,6 +37,9 @@
 
 #include <stdexcept>
 #include "zmusic/zmusic_internal.h"
+#include "zmusic/simd.h"
+#include "zmusic/threadpool.h"
+#include "zmusic/resampler.h"
 #include "mididevice.h"
 #include "zmusic/mus2midi.h"
 
@@ -56,19 +59,21 @@
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
-OPLConfig oplConfig;
-
 // OPL implementation of a MIDI output device -------------------------------
 
 class OPLMIDIDevice : public SoftSynthMIDIDevice, protected OPLmusicBlock
 {
 	float OutputGainFactor;
+	int OutputRate;
+	std::unique_ptr<StreamResampler> Resampler;
 public:
-	OPLMIDIDevice(int core);
+	OPLMIDIDevice(int core, int samplerate);
 	int OpenRenderer() override;
+	SoundStreamInfoEx GetStreamInfoEx() const override;
 	void Close() override;
 	int GetTechnology() const override;
 	std::string GetStats() override;
+	void GetPerfCounters(ZMusicPerfCounters &counters) override;
 
 protected:
 	void CalcTickRate() override;
@@ -92,13 +97,17 @@ protected:
 //
 //==========================================================================
 
-OPLMIDIDevice::OPLMIDIDevice(int core)
-	: SoftSynthMIDIDevice((int)OPL_SAMPLE_RATE), OPLmusicBlock(core, oplConfig.numchips)
+OPLMIDIDevice::OPLMIDIDevice(int core, int samplerate)
+	: SoftSynthMIDIDevice((int)OPL_SAMPLE_RATE), OPLmusicBlock(core, currentContext->oplConfig.numchips)
 {
-	FullPan = oplConfig.fullpan;
-	memcpy(OPLinstruments, oplConfig.OPLinstruments, sizeof(OPLinstruments));
-	OutputGainFactor = oplConfig.gain;
+	// The chips always run at their native rate, which is also what the tick timing is based on.
+	// With zmusic_opl_resample set the output gets converted to the requested rate right here.
+	OutputRate = currentContext->oplConfig.resample > 0 && samplerate > 0 ? samplerate : SampleRate;
+	FullPan = currentContext->oplConfig.fullpan;
+	memcpy(OPLinstruments, currentContext->oplConfig.OPLinstruments, sizeof(OPLinstruments));
+	OutputGainFactor = currentContext->oplConfig.gain;
 	StreamBlockSize = 14;
+	ParallelFor = [](int count, const std::function<void(int)> &job) { WorkerPool::Shared().Run(count, job); };
 }
 
 //==========================================================================
@@ -116,11 +125,35 @@ int OPLMIDIDevice::OpenRenderer()
 		return 1;
 	}
 	isMono = !FullPan && !io->IsOPL3;
+	Resampler.reset();
+	if (OutputRate != SampleRate)
+	{
+		Resampler.reset(new StreamResampler(SoftSynthMIDIDevice::GetStreamInfoEx(), OutputRate, currentContext->oplConfig.resample));
+	}
 	stopAllVoices();
 	resetAllControllers(100);
 	return 0;
 }
 
+//==========================================================================
+//
+// OPLMIDIDevice :: GetStreamInfoEx
+//
+//==========================================================================
+
+SoundStreamInfoEx OPLMIDIDevice::GetStreamInfoEx() const
+{
+	if (Resampler != nullptr)
+	{
+		return Resampler->GetFormat();
+	}
+	// Before the renderer is open only the rate is certain, but that is all the wave writer needs.
+	SoundStreamInfoEx info = SoftSynthMIDIDevice::GetStreamInfoEx();
+	info.mBufferSize = int(int64_t(info.mBufferSize) * OutputRate / SampleRate) & ~7;
+	info.mSampleRate = OutputRate;
+	return info;
+}
+
 //==========================================================================
 //
 // OPLMIDIDevice :: Close
@@ -287,13 +320,12 @@ void OPLMIDIDevice::ComputeOutput(float *buffer, int len)
 
 bool OPLMIDIDevice::ServiceStream(void *buff, int numbytes)
 {
-	float *samples = (float *)buff;
-	bool ret = OPLmusicBlock::ServiceStream(buff, numbytes);
-	int numsamples = numbytes / sizeof(float);
-	for(int i=0; i < numsamples; i++)
-	{
-		samples[i] *= OutputGainFactor;
-	}
+	uint64_t events = EventCount;
+	bool ret = Resampler != nullptr ?
+		Resampler->Fill(buff, numbytes, [this](void *data, int size) { return OPLmusicBlock::ServiceStream(data, size); }) :
+		OPLmusicBlock::ServiceStream(buff, numbytes);
+	LastBlockEvents = uint32_t(EventCount - events);
+	SIMD::ConvertSamples(buff, SIMD::Sample_Float32, buff, SIMD::Sample_Float32, numbytes / sizeof(float), OutputGainFactor, currentContext->miscConfig.snd_softclip);
 	return ret;
 }
 
@@ -352,17 +384,34 @@ std::string OPLMIDIDevice::GetStats()
 	return out;
 }
 
+//==========================================================================
+//
+// OPLMIDIDevice :: GetPerfCounters
+//
+//==========================================================================
+
+void OPLMIDIDevice::GetPerfCounters(ZMusicPerfCounters &counters)
+{
+	SoftSynthMIDIDevice::GetPerfCounters(counters);
+	int active = 0;
+	for (uint32_t i = 0; i < io->NumChannels; ++i)
+	{
+		if (voices[i].index != ~0u) active++;
+	}
+	counters.mActiveVoices = active;
+}
+
 
-MIDIDevice* CreateOplMIDIDevice(const char *Args)
+MIDIDevice* CreateOplMIDIDevice(const char *Args, int samplerate)
 {
-	if (!oplConfig.genmidiset) throw std::runtime_error("Cannot play OPL without GENMIDI data");
-	int core = oplConfig.core;
+	if (!currentContext->oplConfig.genmidiset) throw std::runtime_error("Cannot play OPL without GENMIDI data");
+	int core = currentContext->oplConfig.core;
 	if (Args != NULL && *Args >= '0' && *Args < '4') core = *Args - '0';
-	return new OPLMIDIDevice(core);
+	return new OPLMIDIDevice(core, samplerate);
 }
 
 #else
-MIDIDevice* CreateOplMIDIDevice(const char* Args)
+MIDIDevice* CreateOplMIDIDevice(const char* Args, int samplerate)
 {
 	throw std::runtime_error("OPL device not supported in this configuration");
 }
@@ -35,13 +35,16 @@
 // HEADER FILES ------------------------------------------------------------
 
 #include <stdexcept>
+#include <chrono>
+#include <memory>
 #include "mididevice.h"
+#include "fmcalibration.h"
 #include "zmusic/zmusic_internal.h"
+#include "zmusic/simd.h"
 
 #ifdef HAVE_OPN
 #include "opnmidi.h"
-
-OpnConfig opnConfig;
+#include "data/xg.h"
 
 class OPNMIDIDevice : public SoftSynthMIDIDevice
 {
@@ -50,6 +53,7 @@ class OPNMIDIDevice : public SoftSynthMIDIDevice
 	std::vector<uint8_t> default_bank;
 	std::string custom_bank;
 	bool use_custom_bank;
+	std::unique_ptr<FMAutoEmulator> AutoEmulator;	// set when the emulator gets picked by speed
 
 public:
 	OPNMIDIDevice(const OpnConfig *config);
@@ -65,8 +69,10 @@ protected:
 	void HandleEvent(int status, int parm1, int parm2) override;
 	void HandleLongEvent(const uint8_t *data, int len) override;
 	void ComputeOutput(float *buffer, int len) override;
+	bool ServiceStream(void *buff, int numbytes) override;
 	
 private:
+	void SetEmulator(int emulator);
 	int LoadCustomBank(const OpnConfig *config);
 	void LoadDefaultBank();
 };
@@ -83,13 +89,55 @@ enum
 	ME_PITCHWHEEL = 0xE0
 };
 
+static const OPNMIDI_AudioFormat audio_output_format =
+{
+	OPNMIDI_SampleType_F32,
+	sizeof(float),
+	2 * sizeof(float)
+};
+
+//==========================================================================
+//
+// OPNCalibration
+//
+// The OPN2 cores from most to least accurate. The OPNA cores are left out
+// because they emulate a different chip.
+//
+//==========================================================================
+
+static const FMCalibration &OPNCalibration()
+{
+	static const int cores[] = { OPNMIDI_EMU_NUKED_YM3438_LLE, OPNMIDI_EMU_NUKED_YM3438, OPNMIDI_EMU_YMFM_OPN2, OPNMIDI_EMU_MAME, OPNMIDI_EMU_GENS };
+	static const FMCalibration calibration("libOPNMIDI", cores, int(sizeof(cores) / sizeof(cores[0])), [](int core)
+	{
+		OPN2_MIDIPlayer *player = opn2_init(44100);
+		double speed = 0;
+		if (player != nullptr && opn2_switchEmulator(player, core) == 0 && opn2_openBankData(player, xg_default, sizeof(xg_default)) == 0)
+		{
+			opn2_setNumChips(player, 1);
+			// Keep all voices busy. Idle chips do not get emulated at all.
+			for (int chan = 0; chan < 16; chan++)
+			{
+				opn2_rt_patchChange(player, chan, chan * 8);
+				opn2_rt_noteOn(player, chan, 48 + chan, 100);
+			}
+			speed = FMCalibration::Measure(44100, [=](float *buffer, int frames)
+			{
+				opn2_generateFormat(player, frames * 2, reinterpret_cast<OPN2_UInt8*>(buffer), reinterpret_cast<OPN2_UInt8*>(buffer + 1), &audio_output_format);
+			});
+		}
+		if (player != nullptr) opn2_close(player);
+		return speed;
+	});
+	return calibration;
+}
+
 
 //==========================================================================
 //
 // OPNMIDIDevice Constructor
 //
 //==========================================================================
-#include "data/xg.h"
 
 OPNMIDIDevice::OPNMIDIDevice(const OpnConfig *config)
 	:SoftSynthMIDIDevice(44100)
@@ -106,9 +154,9 @@ OPNMIDIDevice::OPNMIDIDevice(const OpnConfig *config)
 
 		OutputGainFactor *= config->opn_gain;
 
-		opn2_switchEmulator(Renderer, (int)config->opn_emulator_id);
 		opn2_setRunAtPcmRate(Renderer, (int)config->opn_run_at_pcm_rate);
 		opn2_setNumChips(Renderer, config->opn_chips_count);
+		SetEmulator((int)config->opn_emulator_id);	// after the chip count, which the automatic choice depends on
 		opn2_setVolumeRangeModel(Renderer, config->opn_volume_model);
 		opn2_setChannelAllocMode(Renderer, config->opn_chan_alloc);
 		opn2_setSoftPanEnabled(Renderer, (int)config->opn_fullpan);
@@ -223,11 +271,16 @@ void OPNMIDIDevice::ChangeSettingInt(const char *setting, int value)
 	}
 	else if (strcmp(setting, "emulator") == 0)
 	{
-		opn2_switchEmulator(Renderer, value);
+		SetEmulator(value);
 	}
 	else if (strcmp(setting, "numchips") == 0)
 	{
 		opn2_setNumChips(Renderer, value);
+		int core = AutoEmulator != nullptr ? AutoEmulator->Select(opn2_getNumChips(Renderer), currentContext->miscConfig.snd_fmrealtime) : -1;
+		if (core >= 0)
+		{
+			opn2_switchEmulator(Renderer, core);
+		}
 	}
 	else if (strcmp(setting, "fullpan") == 0)
 	{
@@ -303,6 +356,32 @@ void OPNMIDIDevice::ChangeSettingString(const char *setting, const char *value)
 	}
 }
 
+//==========================================================================
+//
+// OPNMIDIDevice :: SetEmulator
+//
+// -1 picks the most accurate core that can render the current number of
+// chips fast enough. The cores get measured in the background the first
+// time, until then the device stays with the core it has.
+//
+//==========================================================================
+
+void OPNMIDIDevice::SetEmulator(int emulator)
+{
+	if (emulator < 0)
+	{
+		AutoEmulator.reset(new FMAutoEmulator(OPNCalibration()));
+		emulator = AutoEmulator->Select(opn2_getNumChips(Renderer), currentContext->miscConfig.snd_fmrealtime);
+		// While the cores are still being measured the current one keeps playing.
+		if (emulator < 0) return;
+	}
+	else
+	{
+		AutoEmulator.reset();
+	}
+	opn2_switchEmulator(Renderer, emulator);
+}
+
 //==========================================================================
 //
 // OPNMIDIDevice :: HandleEvent
@@ -357,13 +436,6 @@ void OPNMIDIDevice::HandleLongEvent(const uint8_t *data, int len)
 	opn2_rt_systemExclusive(Renderer, data, len);
 }
 
-static const OPNMIDI_AudioFormat audio_output_format =
-{
-	OPNMIDI_SampleType_F32,
-	sizeof(float),
-	2 * sizeof(float)
-};
-
 //==========================================================================
 //
 // OPNMIDIDevice :: ComputeOutput
@@ -375,10 +447,39 @@ void OPNMIDIDevice::ComputeOutput(float *buffer, int len)
 	OPN2_UInt8* left = reinterpret_cast<OPN2_UInt8*>(buffer);
 	OPN2_UInt8* right = reinterpret_cast<OPN2_UInt8*>(buffer + 1);
 	auto result = opn2_generateFormat(Renderer, len * 2, left, right, &audio_output_format);
-	for(int i=0; i < result; i++)
+	SIMD::ConvertSamples(buffer, SIMD::Sample_Float32, buffer, SIMD::Sample_Float32, result, OutputGainFactor, currentContext->miscConfig.snd_softclip);
+}
+
+//==========================================================================
+//
+// OPNMIDIDevice :: ServiceStream
+//
+// With an automatically picked core, switches to it once the measurements
+// are in and falls back to a cheaper one when rendering cannot keep up.
+//
+//==========================================================================
+
+bool OPNMIDIDevice::ServiceStream(void *buff, int numbytes)
+{
+	if (AutoEmulator == nullptr)
+	{
+		return SoftSynthMIDIDevice::ServiceStream(buff, numbytes);
+	}
+	int picked = AutoEmulator->Update();
+	if (picked >= 0)
+	{
+		opn2_switchEmulator(Renderer, picked);
+	}
+	auto start = std::chrono::steady_clock::now();
+	bool ret = SoftSynthMIDIDevice::ServiceStream(buff, numbytes);
+	auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	int core = AutoEmulator->BlockRendered(time, numbytes / (2 * sizeof(float)), SampleRate);
+	if (core >= 0)
 	{
-		buffer[i] *= OutputGainFactor;
+		opn2_switchEmulator(Renderer, core);
+		ZMusic_Printf(ZMUSIC_MSG_NOTIFY, "libOPNMIDI cannot keep up, switching to %s.\n", opn2_chipEmulatorName(Renderer));
 	}
+	return ret;
 }
 
 //==========================================================================
@@ -389,9 +490,9 @@ void OPNMIDIDevice::ComputeOutput(float *buffer, int len)
 
 MIDIDevice *CreateOPNMIDIDevice(const char *Args)
 {
-	OpnConfig config = opnConfig;
+	OpnConfig config = currentContext->opnConfig;
 
-	const char* bank = Args && *Args ? Args : opnConfig.opn_use_custom_bank ? opnConfig.opn_custom_bank.c_str() : nullptr;
+	const char* bank = Args && *Args ? Args : currentContext->opnConfig.opn_use_custom_bank ? currentContext->opnConfig.opn_custom_bank.c_str() : nullptr;
 	if (bank && *bank)
 	{
 		const char* info;
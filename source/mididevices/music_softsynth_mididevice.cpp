@@ -268,6 +268,20 @@ bool SoftSynthMIDIDevice::Pause(bool paused)
 	return true;
 }
 
+//==========================================================================
+//
+// SoftSynthMIDIDevice :: FlushStream
+//
+//==========================================================================
+
+bool SoftSynthMIDIDevice::FlushStream()
+{
+	Events = NULL;
+	Position = 0;
+	NextTickIn = 0;
+	return true;
+}
+
 //==========================================================================
 //
 // SoftSynthMIDIDevice :: PlayTick
@@ -292,6 +306,7 @@ int SoftSynthMIDIDevice::PlayTick()
 		else if (MEVENT_EVENTTYPE(event[2]) == MEVENT_LONGMSG)
 		{
 			HandleLongEvent((uint8_t *)&event[3], MEVENT_EVENTPARM(event[2]));
+			EventCount++;
 		}
 		else if (MEVENT_EVENTTYPE(event[2]) == 0)
 		{ // Short MIDI event
@@ -299,6 +314,7 @@ int SoftSynthMIDIDevice::PlayTick()
 			int parm1 = (event[2] >> 8) & 0x7f;
 			int parm2 = (event[2] >> 16) & 0x7f;
 			HandleEvent(status, parm1, parm2);
+			EventCount++;
 
 #if 0
 			if (synth_watch)
@@ -362,6 +378,11 @@ int SoftSynthMIDIDevice::PlayTick()
 //
 // SoftSynthMIDIDevice :: ServiceStream
 //
+// Normally the synth renders up to the next tick with events, which can be
+// only a few samples at high tempos. With snd_midiquantum set it renders
+// blocks of that size instead and the events that are due inside a block
+// get played at its start.
+//
 //==========================================================================
 
 bool SoftSynthMIDIDevice::ServiceStream (void *buff, int numbytes)
@@ -370,10 +391,33 @@ bool SoftSynthMIDIDevice::ServiceStream (void *buff, int numbytes)
 	float *samples1;
 	int numsamples = numbytes / sizeof(float) / 2;
 	bool res = true;
+	uint64_t events = EventCount;
+	int quantum = currentContext->miscConfig.snd_midiquantum;
 
 	samples1 = samples;
 	memset(buff, 0, numbytes);
 
+	while (quantum > 0 && Events != NULL && numsamples > 0)
+	{
+		int blocksize = std::min(numsamples, quantum);
+		while (Events != NULL && NextTickIn < blocksize)
+		{
+			int next = PlayTick();
+			assert(next >= 0);
+			if (next == 0)
+			{ // end of song
+				ComputeOutput(samples1, numsamples);
+				LastBlockEvents = uint32_t(EventCount - events);
+				return false;
+			}
+			NextTickIn += SamplesPerTick * next;
+		}
+		ComputeOutput(samples1, blocksize);
+		NextTickIn -= blocksize;
+		numsamples -= blocksize;
+		samples1 += blocksize * 2;
+	}
+
 	while (Events != NULL && numsamples > 0)
 	{
 		double ticky = NextTickIn;
@@ -415,5 +459,20 @@ bool SoftSynthMIDIDevice::ServiceStream (void *buff, int numbytes)
 	{
 		res = false;
 	}
+	LastBlockEvents = uint32_t(EventCount - events);
 	return res;
 }
+
+//==========================================================================
+//
+// SoftSynthMIDIDevice :: GetPerfCounters
+//
+// Devices that know their voices override this and call it first.
+//
+//==========================================================================
+
+void SoftSynthMIDIDevice::GetPerfCounters(ZMusicPerfCounters &counters)
+{
+	counters.mEvents = EventCount;
+	counters.mLastBlockEvents = LastBlockEvents;
+}
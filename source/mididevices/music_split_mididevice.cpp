@@ -0,0 +1,336 @@
+/*
+** music_split_mididevice.cpp
+** Spreads the MIDI channels over several instances of a software synth
+** which render in parallel.
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+// HEADER FILES ------------------------------------------------------------
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <string.h>
+#include "zmusic/zmusic_internal.h"
+#include "zmusic/threadpool.h"
+#include "mididevice.h"
+
+// Channel split wrapper around a software synth ----------------------------
+//
+// Every instance gets the channels c with c % count == its index. System
+// and SysEx messages go to all of them so that resets and global settings
+// stay in sync. The outer device does the event timing as usual, only
+// ComputeOutput fans out to the pool.
+
+class SplitMIDIDevice : public SoftSynthMIDIDevice
+{
+public:
+	SplitMIDIDevice(std::vector<std::unique_ptr<SoftSynthMIDIDevice>> &&devices);
+	~SplitMIDIDevice();
+
+	void Close() override;
+	void PrecacheInstruments(const uint16_t *instruments, int count) override;
+	void ChangeSettingInt(const char *setting, int value) override;
+	void ChangeSettingNum(const char *setting, double value) override;
+	void ChangeSettingString(const char *setting, const char *value) override;
+	std::string GetStats() override;
+	void GetPerfCounters(ZMusicPerfCounters &counters) override;
+	int GetDeviceType() const override { return Devices[0]->GetDeviceType(); }
+	bool CanHandleSysex() const override { return Devices[0]->CanHandleSysex(); }
+
+protected:
+	int OpenRenderer() override;
+	void HandleEvent(int status, int parm1, int parm2) override;
+	void HandleLongEvent(const uint8_t *data, int len) override;
+	void ComputeOutput(float *buffer, int len) override;
+
+	// Below this many samples waking the workers costs more than it saves.
+	enum { MinParallelSamples = 64 };
+
+	std::vector<std::unique_ptr<SoftSynthMIDIDevice>> Devices;
+	std::vector<std::vector<float>> Buffers;
+	WorkerPool Pool;
+};
+
+//==========================================================================
+//
+// SplitMIDIDevice Constructor
+//
+//==========================================================================
+
+SplitMIDIDevice::SplitMIDIDevice(std::vector<std::unique_ptr<SoftSynthMIDIDevice>> &&devices)
+	: SoftSynthMIDIDevice(devices[0]->GetSampleRate()), Devices(std::move(devices)), Buffers(Devices.size()), Pool((int)Devices.size())
+{
+	StreamBlockSize = Devices[0]->StreamBlockSize;
+	isMono = Devices[0]->isMono;
+}
+
+//==========================================================================
+//
+// SplitMIDIDevice Destructor
+//
+//==========================================================================
+
+SplitMIDIDevice::~SplitMIDIDevice()
+{
+	Close();
+}
+
+//==========================================================================
+//
+// SplitMIDIDevice :: OpenRenderer
+//
+//==========================================================================
+
+int SplitMIDIDevice::OpenRenderer()
+{
+	for (auto &dev : Devices)
+	{
+		int ret = dev->Open();
+		if (ret != 0) return ret;
+	}
+	return 0;
+}
+
+//==========================================================================
+//
+// SplitMIDIDevice :: Close
+//
+//==========================================================================
+
+void SplitMIDIDevice::Close()
+{
+	for (auto &dev : Devices)
+	{
+		dev->Close();
+	}
+	SoftSynthMIDIDevice::Close();
+}
+
+//==========================================================================
+//
+// SplitMIDIDevice :: HandleEvent
+//
+//==========================================================================
+
+void SplitMIDIDevice::HandleEvent(int status, int parm1, int parm2)
+{
+	if (status >= 0xF0)
+	{
+		for (auto &dev : Devices)
+		{
+			dev->HandleEvent(status, parm1, parm2);
+		}
+	}
+	else
+	{
+		Devices[(status & 15) % Devices.size()]->HandleEvent(status, parm1, parm2);
+	}
+}
+
+//==========================================================================
+//
+// SplitMIDIDevice :: HandleLongEvent
+//
+// Channel specific SysEx messages are harmless for the instances that do
+// not play the channel, so everything gets broadcast.
+//
+//==========================================================================
+
+void SplitMIDIDevice::HandleLongEvent(const uint8_t *data, int len)
+{
+	for (auto &dev : Devices)
+	{
+		dev->HandleLongEvent(data, len);
+	}
+}
+
+//==========================================================================
+//
+// SplitMIDIDevice :: ComputeOutput
+//
+// The first instance renders straight into the output buffer, the others
+// into their own buffers which get mixed in afterward.
+//
+//==========================================================================
+
+void SplitMIDIDevice::ComputeOutput(float *buffer, int len)
+{
+	auto ctx = currentContext;
+	auto render = [&](int i)
+	{
+		ZMusicContextScope scope(ctx);
+		if (i == 0)
+		{
+			Devices[0]->ComputeOutput(buffer, len);
+			return;
+		}
+		auto &out = Buffers[i];
+		if (out.size() < size_t(len) * 2) out.resize(len * 2);
+		memset(out.data(), 0, len * 2 * sizeof(float));
+		Devices[i]->ComputeOutput(out.data(), len);
+	};
+
+	if (len >= MinParallelSamples)
+	{
+		Pool.Run((int)Devices.size(), render);
+	}
+	else
+	{
+		for (int i = 0; i < (int)Devices.size(); i++) render(i);
+	}
+
+	for (size_t i = 1; i < Devices.size(); i++)
+	{
+		const float *in = Buffers[i].data();
+		for (int j = 0; j < len * 2; j++)
+		{
+			buffer[j] += in[j];
+		}
+	}
+}
+
+//==========================================================================
+//
+// SplitMIDIDevice :: PrecacheInstruments
+//
+//==========================================================================
+
+void SplitMIDIDevice::PrecacheInstruments(const uint16_t *instruments, int count)
+{
+	for (auto &dev : Devices)
+	{
+		dev->PrecacheInstruments(instruments, count);
+	}
+}
+
+//==========================================================================
+//
+// SplitMIDIDevice :: ChangeSettingInt
+//
+//==========================================================================
+
+void SplitMIDIDevice::ChangeSettingInt(const char *setting, int value)
+{
+	for (auto &dev : Devices)
+	{
+		dev->ChangeSettingInt(setting, value);
+	}
+}
+
+//==========================================================================
+//
+// SplitMIDIDevice :: ChangeSettingNum
+//
+//==========================================================================
+
+void SplitMIDIDevice::ChangeSettingNum(const char *setting, double value)
+{
+	for (auto &dev : Devices)
+	{
+		dev->ChangeSettingNum(setting, value);
+	}
+}
+
+//==========================================================================
+//
+// SplitMIDIDevice :: ChangeSettingString
+//
+//==========================================================================
+
+void SplitMIDIDevice::ChangeSettingString(const char *setting, const char *value)
+{
+	for (auto &dev : Devices)
+	{
+		dev->ChangeSettingString(setting, value);
+	}
+}
+
+//==========================================================================
+//
+// SplitMIDIDevice :: GetStats
+//
+//==========================================================================
+
+std::string SplitMIDIDevice::GetStats()
+{
+	std::string out;
+	for (size_t i = 0; i < Devices.size(); i++)
+	{
+		if (i > 0) out += "\n";
+		out += Devices[i]->GetStats();
+	}
+	return out;
+}
+
+//==========================================================================
+//
+// SplitMIDIDevice :: GetPerfCounters
+//
+//==========================================================================
+
+void SplitMIDIDevice::GetPerfCounters(ZMusicPerfCounters &counters)
+{
+	SoftSynthMIDIDevice::GetPerfCounters(counters);
+	int voices = 0;
+	for (auto &dev : Devices)
+	{
+		ZMusicPerfCounters sub = {};
+		sub.mActiveVoices = -1;
+		dev->GetPerfCounters(sub);
+		if (sub.mActiveVoices < 0) return;
+		voices += sub.mActiveVoices;
+	}
+	counters.mActiveVoices = voices;
+}
+
+//==========================================================================
+//
+// CreateSplitMIDIDevice
+//
+// Without snd_midisplit this just returns what the factory creates.
+//
+//==========================================================================
+
+MIDIDevice *CreateSplitMIDIDevice(const std::function<MIDIDevice *()> &factory)
+{
+	int count = currentContext->miscConfig.snd_midisplit;
+	if (count <= 1) return factory();
+
+	std::vector<std::unique_ptr<SoftSynthMIDIDevice>> devices;
+	for (int i = 0; i < count; i++)
+	{
+		auto dev = static_cast<SoftSynthMIDIDevice *>(factory());
+		if (dev == nullptr) throw std::runtime_error("Unable to create the MIDI device");
+		devices.emplace_back(dev);
+	}
+	return new SplitMIDIDevice(std::move(devices));
+}
@@ -38,6 +38,7 @@
 #include <stdlib.h>
 #include "mididevice.h"
 #include "zmusic/zmusic_internal.h"
+#include "zmusic/simd.h"
 
 #ifdef HAVE_GUS
 
@@ -60,8 +61,6 @@
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
-GUSConfig gusConfig;
-
 //==========================================================================
 //
 // The actual device.
@@ -80,6 +79,7 @@ public:
 	int OpenRenderer() override;
 	void PrecacheInstruments(const uint16_t *instruments, int count) override;
 	int GetDeviceType() const override { return MDEV_GUS; }
+	void GetPerfCounters(ZMusicPerfCounters &counters) override;
 	
 protected:
 	Timidity::Renderer *Renderer;
@@ -95,7 +95,7 @@ protected:
 
 void TimidityMIDIDevice::LoadInstruments()
 {
-	if (gusConfig.reader)
+	if (currentContext->gusConfig.reader)
 	{
 		// Check if we got some GUS data before using it.
 		std::string ultradir;
@@ -105,41 +105,41 @@ void TimidityMIDIDevice::LoadInstruments()
 		if (ultradir.length())
 		{
 			ultradir += "/midi";
-			gusConfig.reader->add_search_path(ultradir.c_str());
+			currentContext->gusConfig.reader->add_search_path(ultradir.c_str());
 		}
 		// Load DMXGUS lump and patches from gus_patchdir
-		if (gusConfig.gus_patchdir.length() != 0) gusConfig.reader->add_search_path(gusConfig.gus_patchdir.c_str());
+		if (currentContext->gusConfig.gus_patchdir.length() != 0) currentContext->gusConfig.reader->add_search_path(currentContext->gusConfig.gus_patchdir.c_str());
 		
-		gusConfig.instruments.reset(new Timidity::Instruments(gusConfig.reader));
-		gusConfig.loadedConfig = gusConfig.readerName;
+		currentContext->gusConfig.instruments.reset(new Timidity::Instruments(currentContext->gusConfig.reader));
+		currentContext->gusConfig.loadedConfig = currentContext->gusConfig.readerName;
 	}
 
-	if (gusConfig.instruments == nullptr)
+	if (currentContext->gusConfig.instruments == nullptr)
 	{
 		throw std::runtime_error("No instruments set for GUS device");
 	}
 
-	if (gusConfig.gus_dmxgus && gusConfig.dmxgus.size())
+	if (currentContext->gusConfig.gus_dmxgus && currentContext->gusConfig.dmxgus.size())
 	{
-		bool success = gusConfig.instruments->LoadDMXGUS(gusConfig.gus_memsize, (const char*)gusConfig.dmxgus.data(), gusConfig.dmxgus.size()) >= 0;
-		gusConfig.reader = nullptr;
+		bool success = currentContext->gusConfig.instruments->LoadDMXGUS(currentContext->gusConfig.gus_memsize, (const char*)currentContext->gusConfig.dmxgus.data(), currentContext->gusConfig.dmxgus.size()) >= 0;
+		currentContext->gusConfig.reader = nullptr;
 
 		if (!success)
 		{
-			gusConfig.instruments.reset();
-			gusConfig.loadedConfig = "";
+			currentContext->gusConfig.instruments.reset();
+			currentContext->gusConfig.loadedConfig = "";
 			throw std::runtime_error("Unable to initialize DMXGUS for GUS MIDI device");
 		}
 	}
 	else
 	{
-		bool err = gusConfig.instruments->LoadConfig() < 0;
-		gusConfig.reader = nullptr;
+		bool err = currentContext->gusConfig.instruments->LoadConfig() < 0;
+		currentContext->gusConfig.reader = nullptr;
 		
 		if (err)
 		{
-			gusConfig.instruments.reset();
-			gusConfig.loadedConfig = "";
+			currentContext->gusConfig.instruments.reset();
+			currentContext->gusConfig.loadedConfig = "";
 			throw std::runtime_error("Unable to initialize instruments for GUS MIDI device");
 		}
 	}
@@ -155,7 +155,7 @@ TimidityMIDIDevice::TimidityMIDIDevice(int samplerate)
 	: SoftSynthMIDIDevice(samplerate, 11025, 65535)
 {
 	LoadInstruments();
-	Renderer = new Timidity::Renderer((float)SampleRate, gusConfig.midi_voices, gusConfig.instruments.get());
+	Renderer = new Timidity::Renderer((float)SampleRate, currentContext->gusConfig.midi_voices, currentContext->gusConfig.instruments.get());
 }
 
 //==========================================================================
@@ -238,7 +238,24 @@ void TimidityMIDIDevice::HandleLongEvent(const uint8_t *data, int len)
 void TimidityMIDIDevice::ComputeOutput(float *buffer, int len)
 {
 	Renderer->ComputeOutput(buffer, len);
-	for (int i = 0; i < len * 2; i++) buffer[i] *= 0.7f;
+	SIMD::ConvertSamples(buffer, SIMD::Sample_Float32, buffer, SIMD::Sample_Float32, len * 2, 0.7f, currentContext->miscConfig.snd_softclip);
+}
+
+//==========================================================================
+//
+// TimidityMIDIDevice :: GetPerfCounters
+//
+//==========================================================================
+
+void TimidityMIDIDevice::GetPerfCounters(ZMusicPerfCounters &counters)
+{
+	SoftSynthMIDIDevice::GetPerfCounters(counters);
+	int active = 0;
+	for (int i = 0; i < Renderer->voices; i++)
+	{
+		if (Renderer->voice[i].status & Timidity::VOICE_RUNNING) active++;
+	}
+	counters.mActiveVoices = active;
 }
 
 //==========================================================================
@@ -256,9 +273,9 @@ void TimidityMIDIDevice::ComputeOutput(float *buffer, int len)
 
 bool GUS_SetupConfig(const char* args)
 {
-	if (*args == 0) args = gusConfig.gus_config.c_str();
-	if (gusConfig.gus_dmxgus && *args == 0) args = "DMXGUS";
-	//if (stricmp(gusConfig.loadedConfig.c_str(), args) == 0) return false; // aleady loaded
+	if (*args == 0) args = currentContext->gusConfig.gus_config.c_str();
+	if (currentContext->gusConfig.gus_dmxgus && *args == 0) args = "DMXGUS";
+	//if (stricmp(currentContext->gusConfig.loadedConfig.c_str(), args) == 0) return false; // aleady loaded
 
 	MusicIO::SoundFontReaderInterface* reader = MusicIO::ClientOpenSoundFont(args, SF_GUS);
 	if (!reader && MusicIO::fileExists(args))
@@ -285,7 +302,7 @@ bool GUS_SetupConfig(const char* args)
 		if (!reader) reader = new MusicIO::FileSystemSoundFontReader(args, true);
 	}
 
-	if (!reader && gusConfig.gus_dmxgus)
+	if (!reader && currentContext->gusConfig.gus_dmxgus)
 	{
 		reader = new MusicIO::FileSystemSoundFontReader(args, true);
 	}
@@ -296,8 +313,8 @@ bool GUS_SetupConfig(const char* args)
 		snprintf(error, 80, "GUS: %s: Unable to load sound font\n", args);
 		throw std::runtime_error(error);
 	}
-	gusConfig.reader = reader;
-	gusConfig.readerName = args;
+	currentContext->gusConfig.reader = reader;
+	currentContext->gusConfig.readerName = args;
 	return true;
 }
 
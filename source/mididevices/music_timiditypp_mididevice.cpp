@@ -35,6 +35,7 @@
 #include <stdexcept>
 #include "mididevice.h"
 #include "zmusic/zmusic_internal.h"
+#include "zmusic/simd.h"
 
 #ifdef HAVE_TIMIDITY
 
@@ -43,8 +44,6 @@
 #include "timiditypp/playmidi.h"
 
 
-TimidityConfig timidityConfig;
-
 class TimidityPPMIDIDevice : public SoftSynthMIDIDevice
 {
 	std::shared_ptr<TimidityPlus::Instruments> instruments;
@@ -76,25 +75,25 @@ protected:
 
 void TimidityPPMIDIDevice::LoadInstruments()
 {
-	if (timidityConfig.reader)
+	if (currentContext->timidityConfig.reader)
 	{
-		timidityConfig.loadedConfig = timidityConfig.readerName;
-		timidityConfig.instruments.reset(new TimidityPlus::Instruments());
-		bool success = timidityConfig.instruments->load(timidityConfig.reader);
-		timidityConfig.reader = nullptr;
+		currentContext->timidityConfig.loadedConfig = currentContext->timidityConfig.readerName;
+		currentContext->timidityConfig.instruments.reset(new TimidityPlus::Instruments());
+		bool success = currentContext->timidityConfig.instruments->load(currentContext->timidityConfig.reader);
+		currentContext->timidityConfig.reader = nullptr;
 
 		if (!success)
 		{
-			timidityConfig.instruments.reset();
-			timidityConfig.loadedConfig = "";
+			currentContext->timidityConfig.instruments.reset();
+			currentContext->timidityConfig.loadedConfig = "";
 			throw std::runtime_error("Unable to initialize instruments for Timidity++ MIDI device");
 		}
 	}
-	else if (timidityConfig.instruments == nullptr)
+	else if (currentContext->timidityConfig.instruments == nullptr)
 	{
 		throw std::runtime_error("No instruments set for Timidity++ device");
 	}
-	instruments = timidityConfig.instruments;
+	instruments = currentContext->timidityConfig.instruments;
 }
 
 //==========================================================================
@@ -188,7 +187,10 @@ void TimidityPPMIDIDevice::HandleLongEvent(const uint8_t *data, int len)
 void TimidityPPMIDIDevice::ComputeOutput(float *buffer, int len)
 {
 	if (Renderer != nullptr)
-		Renderer->compute_data(buffer, len);
+	{
+		Renderer->compute_data((int32_t *)buffer, len);
+		SIMD::ConvertSamples(buffer, SIMD::Sample_Float32, buffer, SIMD::Sample_Int32, len * 2, 5.f, currentContext->miscConfig.snd_softclip);
+	}
 }
 
 //==========================================================================
@@ -199,8 +201,8 @@ void TimidityPPMIDIDevice::ComputeOutput(float *buffer, int len)
 
 bool Timidity_SetupConfig(const char* args)
 {
-	if (*args == 0) args = timidityConfig.timidity_config.c_str();
-	if (stricmp(timidityConfig.loadedConfig.c_str(), args) == 0) return false; // aleady loaded
+	if (*args == 0) args = currentContext->timidityConfig.timidity_config.c_str();
+	if (stricmp(currentContext->timidityConfig.loadedConfig.c_str(), args) == 0) return false; // aleady loaded
 
 	MusicIO::SoundFontReaderInterface* reader = MusicIO::ClientOpenSoundFont(args, SF_GUS | SF_SF2);
 	if (!reader && MusicIO::fileExists(args))
@@ -233,8 +235,8 @@ bool Timidity_SetupConfig(const char* args)
 		snprintf(error, 80, "Timidity++: %s: Unable to load sound font\n", args);
 		throw std::runtime_error(error);
 	}
-	timidityConfig.reader = reader;
-	timidityConfig.readerName = args;
+	currentContext->timidityConfig.reader = reader;
+	currentContext->timidityConfig.readerName = args;
 	return true;
 }
 
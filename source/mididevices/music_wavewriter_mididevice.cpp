@@ -39,6 +39,9 @@
 #include "zmusic/m_swap.h"
 #include "fileio.h"
 #include <stdexcept>
+#include <future>
+#include <vector>
+#include <math.h>
 #include <errno.h>
 
 // MACROS ------------------------------------------------------------------
@@ -89,9 +92,13 @@ MIDIWaveWriter::MIDIWaveWriter(const char *filename, SoftSynthMIDIDevice *playde
 {
 	File = MusicIO::utf8_fopen(filename, "wb");
 	playDevice = playdevice;
+	BitsPerSample = currentContext->miscConfig.snd_wavebits;
 	if (File != nullptr)
 	{ // Write wave header
 		FmtChunk fmt;
+		int framesize = BitsPerSample / 8 * 2;
+		// The device may resample its output, so the file's rate can differ from the one the timing runs at.
+		int outrate = playDevice->GetStreamInfoEx().mSampleRate;
 
 		if (fwrite("RIFF\0\0\0\0WAVEfmt ", 1, 16, File) != 16) goto fail;
 
@@ -99,14 +106,15 @@ MIDIWaveWriter::MIDIWaveWriter(const char *filename, SoftSynthMIDIDevice *playde
 		fmt.ChunkLen = LittleLong(uint32_t(sizeof(fmt) - 4));
 		fmt.FormatTag = LittleShort((uint16_t)0xFFFE);		// WAVE_FORMAT_EXTENSIBLE
 		fmt.Channels = LittleShort((uint16_t)2);
-		fmt.SamplesPerSec = LittleLong(SampleRate);
-		fmt.AvgBytesPerSec = LittleLong(SampleRate * 8);
-		fmt.BlockAlign = LittleShort((uint16_t)8);
-		fmt.BitsPerSample = LittleShort((uint16_t)32);
+		fmt.SamplesPerSec = LittleLong(outrate);
+		fmt.AvgBytesPerSec = LittleLong(outrate * framesize);
+		fmt.BlockAlign = LittleShort((uint16_t)framesize);
+		fmt.BitsPerSample = LittleShort((uint16_t)BitsPerSample);
 		fmt.ExtensionSize = LittleShort((uint16_t)(2 + 4 + 16));
-		fmt.ValidBitsPerSample = LittleShort((uint16_t)32);
+		fmt.ValidBitsPerSample = LittleShort((uint16_t)BitsPerSample);
 		fmt.ChannelMask = LittleLong(3);
-		fmt.SubFormatA = LittleLong(0x00000003);	// Set subformat to KSDATAFORMAT_SUBTYPE_IEEE_FLOAT
+		// Set subformat to KSDATAFORMAT_SUBTYPE_IEEE_FLOAT or KSDATAFORMAT_SUBTYPE_PCM
+		fmt.SubFormatA = LittleLong(BitsPerSample == 32 ? 0x00000003 : 0x00000001);
 		fmt.SubFormatB = 0x0000;
 		fmt.SubFormatC = LittleShort((uint16_t)0x0010);
 		fmt.SubFormatD[0] = 0x80;
@@ -168,26 +176,99 @@ bool MIDIWaveWriter::CloseFile()
 	return false;
 }
 
+//==========================================================================
+//
+// MIDIWaveWriter :: WriteSamples
+//
+// Runs on the writer thread. Returns 0 or the errno of the failed write.
+// The integer formats get TPDF dither of one LSB.
+//
+//==========================================================================
+
+int MIDIWaveWriter::WriteSamples(const float *samples, size_t count)
+{
+	if (BitsPerSample == 32)
+	{
+		if (fwrite(samples, sizeof(float), count, File) != count) return errno;
+		return 0;
+	}
+
+	const int bytes = BitsPerSample / 8;
+	const double scale = BitsPerSample == 16 ? 32767. : 8388607.;
+	Converted.resize(count * bytes);
+	uint8_t *out = Converted.data();
+	for (size_t i = 0; i < count; i++)
+	{
+		DitherSeed = DitherSeed * 1664525 + 1013904223;
+		double r1 = (DitherSeed >> 8) * (1. / 16777216.);
+		DitherSeed = DitherSeed * 1664525 + 1013904223;
+		double r2 = (DitherSeed >> 8) * (1. / 16777216.);
+
+		double v = floor(samples[i] * scale + r1 - r2 + 0.5);
+		if (v > scale) v = scale;
+		else if (v < -scale - 1) v = -scale - 1;
+		int32_t s = (int32_t)v;
+		for (int b = 0; b < bytes; b++)
+		{
+			*out++ = uint8_t(s >> (b * 8));
+		}
+	}
+	if (fwrite(Converted.data(), 1, Converted.size(), File) != Converted.size()) return errno;
+	return 0;
+}
+
 //==========================================================================
 //
 // MIDIWaveWriter :: Resume
 //
+// Renders into one buffer while the other one is being written so that
+// the disk does not hold up the synth. A chunk on which the song ends is
+// not written, same as with direct writing.
+//
 //==========================================================================
 
 int MIDIWaveWriter::Resume()
 {
-	float writebuffer[4096];
+	const size_t chunksize = 4096;
+	std::vector<float> buffers[2];
+	std::future<int> pending;
+	int current = 0;
+	bool playing = true;
 
-	while (ServiceStream(writebuffer, sizeof(writebuffer)))
+	while (playing)
 	{
-		if (fwrite(writebuffer, 1, sizeof(writebuffer), File) != sizeof(writebuffer))
+		auto &buf = buffers[current];
+		buf.resize(chunksize * WriteBufferChunks);
+		size_t filled = 0;
+		while (filled < buf.size())
+		{
+			if (!ServiceStream(&buf[filled], chunksize * sizeof(float)))
+			{
+				playing = false;
+				break;
+			}
+			filled += chunksize;
+		}
+
+		int error = pending.valid() ? pending.get() : 0;
+		if (error == 0 && filled > 0)
+		{
+			const float *data = buf.data();
+			pending = std::async(std::launch::async, [this, data, filled]() { return WriteSamples(data, filled); });
+		}
+		if (error == 0 && !playing && pending.valid())
+		{
+			error = pending.get();
+		}
+		if (error != 0)
 		{
 			fclose(File);
 			File = nullptr;
 			char buffer[80];
-			snprintf(buffer, 80, "Could not write entire wave file: %s\n", strerror(errno));
+			snprintf(buffer, 80, "Could not write entire wave file: %s\n", strerror(error));
 			throw std::runtime_error(buffer);
 		}
+		current ^= 1;
 	}
 	return 0;
 }
@@ -37,6 +37,7 @@
 #include <stdexcept>
 #include "mididevice.h"
 #include "zmusic/zmusic_internal.h"
+#include "zmusic/simd.h"
 
 #ifdef HAVE_WILDMIDI
 
@@ -46,8 +47,6 @@
 
 // TYPES -------------------------------------------------------------------
 
-WildMidiConfig wildMidiConfig;
-
 // WildMidi implementation of a MIDI device ---------------------------------
 
 class WildMIDIDevice : public SoftSynthMIDIDevice
@@ -59,6 +58,7 @@ public:
 	int OpenRenderer() override;
 	void PrecacheInstruments(const uint16_t *instruments, int count) override;
 	std::string GetStats() override;
+	void GetPerfCounters(ZMusicPerfCounters &counters) override;
 	int GetDeviceType() const override { return MDEV_WILDMIDI; }
 	
 protected:
@@ -84,21 +84,21 @@ protected:
 
 void WildMIDIDevice::LoadInstruments()
 {
-	if (wildMidiConfig.reader)
+	if (currentContext->wildMidiConfig.reader)
 	{
-		wildMidiConfig.loadedConfig = wildMidiConfig.readerName;
-		wildMidiConfig.instruments.reset(new WildMidi::Instruments(wildMidiConfig.reader, SampleRate));
-		wildMidiConfig.reader = nullptr;
+		currentContext->wildMidiConfig.loadedConfig = currentContext->wildMidiConfig.readerName;
+		currentContext->wildMidiConfig.instruments.reset(new WildMidi::Instruments(currentContext->wildMidiConfig.reader, SampleRate));
+		currentContext->wildMidiConfig.reader = nullptr;
 	}
-	else if (wildMidiConfig.instruments == nullptr)
+	else if (currentContext->wildMidiConfig.instruments == nullptr)
 	{
 		throw std::runtime_error("No instruments set for WildMidi device");
 	}
-	instruments = wildMidiConfig.instruments;
+	instruments = currentContext->wildMidiConfig.instruments;
 	if (instruments->LoadConfig(nullptr) < 0)
 	{
-		wildMidiConfig.instruments.reset();
-		wildMidiConfig.loadedConfig = "";
+		currentContext->wildMidiConfig.instruments.reset();
+		currentContext->wildMidiConfig.loadedConfig = "";
 		throw std::runtime_error("Unable to initialize instruments for WildMidi device");
 	}
 }
@@ -117,8 +117,8 @@ WildMIDIDevice::WildMIDIDevice(int samplerate)
 
 	Renderer = new WildMidi::Renderer(instruments.get());
 	int flags = 0;
-	if (wildMidiConfig.enhanced_resampling) flags |= WildMidi::WM_MO_ENHANCED_RESAMPLING;
-	if (wildMidiConfig.reverb) flags |= WildMidi::WM_MO_REVERB;
+	if (currentContext->wildMidiConfig.enhanced_resampling) flags |= WildMidi::WM_MO_ENHANCED_RESAMPLING;
+	if (currentContext->wildMidiConfig.reverb) flags |= WildMidi::WM_MO_REVERB;
 	Renderer->SetOption(WildMidi::WM_MO_ENHANCED_RESAMPLING | WildMidi::WM_MO_REVERB, flags);
 }
 
@@ -200,7 +200,9 @@ void WildMIDIDevice::HandleLongEvent(const uint8_t *data, int len)
 
 void WildMIDIDevice::ComputeOutput(float *buffer, int len)
 {
-	Renderer->ComputeOutput(buffer, len);
+	// The renderer leaves its 32 bit mix in the buffer. It gets a volume boost because Wildmidi is far more quiet than the other synths and therefore hard to balance.
+	Renderer->ComputeOutput((int *)buffer, len);
+	SIMD::ConvertSamples(buffer, SIMD::Sample_Float32, buffer, SIMD::Sample_Int32, len * 2, 1.3f * 65536.f, currentContext->miscConfig.snd_softclip);
 }
 
 //==========================================================================
@@ -216,6 +218,18 @@ std::string WildMIDIDevice::GetStats()
 	return out;
 }
 
+//==========================================================================
+//
+// WildMIDIDevice :: GetPerfCounters
+//
+//==========================================================================
+
+void WildMIDIDevice::GetPerfCounters(ZMusicPerfCounters &counters)
+{
+	SoftSynthMIDIDevice::GetPerfCounters(counters);
+	counters.mActiveVoices = Renderer->GetVoiceCount();
+}
+
 //==========================================================================
 //
 // WildMIDIDevice :: ChangeSettingInt
@@ -240,8 +254,8 @@ void WildMIDIDevice::ChangeSettingInt(const char *opt, int set)
 
 bool WildMidi_SetupConfig(const char* args)
 {
-	if (*args == 0) args = wildMidiConfig.config.c_str();
-	if (stricmp(wildMidiConfig.loadedConfig.c_str(), args) == 0) return false; // aleady loaded
+	if (*args == 0) args = currentContext->wildMidiConfig.config.c_str();
+	if (stricmp(currentContext->wildMidiConfig.loadedConfig.c_str(), args) == 0) return false; // aleady loaded
 
 	MusicIO::SoundFontReaderInterface* reader = MusicIO::ClientOpenSoundFont(args, SF_GUS);
 	if (!reader && MusicIO::fileExists(args))
@@ -273,8 +287,8 @@ bool WildMidi_SetupConfig(const char* args)
 		throw std::runtime_error(error);
 	}
 
-	wildMidiConfig.reader = reader;
-	wildMidiConfig.readerName = args;
+	currentContext->wildMidiConfig.reader = reader;
+	currentContext->wildMidiConfig.readerName = args;
 	return true;
 }
 
@@ -689,7 +689,7 @@ static bool IgnoreMIDIVolume(UINT id)
 
 MIDIDevice *CreateWinMIDIDevice(int mididevice)
 {
-	return new WinMIDIDevice(mididevice, miscConfig.snd_midiprecache);
+	return new WinMIDIDevice(mididevice, currentContext->miscConfig.snd_midiprecache);
 }
 #endif
 
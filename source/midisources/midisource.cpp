@@ -33,6 +33,7 @@
  **
  */
 
+#include <map>
 #include "zmusic_internal.h"
 #include "midisource.h"
 
@@ -217,6 +218,323 @@ std::vector<uint16_t> MIDISource::PrecacheData()
 	return packed;
 }
 
+//==========================================================================
+//
+// MIDISource :: EventSize
+//
+// Returns the number of words an event in a stream buffer occupies.
+//
+//==========================================================================
+
+static size_t EventSize(const uint32_t *event)
+{
+	if (event[2] < 0x80000000)
+	{ // short message
+		return 3;
+	}
+	// long message
+	return 3 + ((MEVENT_EVENTPARM(event[2]) + 3) >> 2);
+}
+
+//==========================================================================
+//
+// Chase state for seeking
+//
+// Keeps only the part of the event stream that still has an effect at
+// the seek target: the last value of every controller, the last program,
+// pitch bend and channel pressure, RPN/NRPN values per parameter, and all
+// SysEx messages since the last GM/GS/XG reset. Notes are dropped.
+//
+//==========================================================================
+
+namespace
+{
+	struct ChaseState
+	{
+		enum
+		{
+			CC_BankSelect = 0,
+			CC_DataEntry = 6,
+			CC_BankSelectLSB = 32,
+			CC_DataEntryLSB = 38,
+			CC_NRPN_LSB = 98,
+			CC_NRPN_MSB = 99,
+			CC_RPN_LSB = 100,
+			CC_RPN_MSB = 101,
+			CC_ResetAll = 121,
+		};
+
+		struct Channel
+		{
+			int16_t Controllers[128];
+			int16_t Program;
+			int16_t PitchBend;
+			int16_t Pressure;
+			bool NRPN;	// whether data entry goes to the NRPN or RPN selected by the controllers
+			std::map<int, std::pair<int16_t, int16_t>> Parameters;
+		};
+
+		Channel Channels[16];
+		std::vector<uint32_t> SysEx;
+		int Tempo;
+
+		ChaseState(int tempo) : Tempo(tempo)
+		{
+			for (auto &chan : Channels)
+			{
+				for (auto &c : chan.Controllers) c = -1;
+				chan.Program = chan.PitchBend = chan.Pressure = -1;
+				chan.NRPN = false;
+			}
+		}
+
+		void ResetControllers(Channel &chan)
+		{
+			// Everything but bank, volume, pan and the parameter values survives a controller reset.
+			for (int i = 1; i < 120; i++)
+			{
+				if (i != CC_BankSelectLSB && i != 7 && i != 10 && i != CC_DataEntry && i != CC_DataEntryLSB) chan.Controllers[i] = -1;
+			}
+			chan.PitchBend = chan.Pressure = -1;
+		}
+
+		void Reset()
+		{
+			for (auto &chan : Channels)
+			{
+				for (auto &c : chan.Controllers) c = -1;
+				chan.Program = chan.PitchBend = chan.Pressure = -1;
+				chan.Parameters.clear();
+			}
+			SysEx.clear();
+		}
+
+		static bool IsReset(const uint8_t *data, uint32_t len)
+		{
+			static const uint8_t gm[] = { 0xf0, 0x7e, 0x7f, 0x09, 0x01, 0xf7 };
+			static const uint8_t gs[] = { 0xf0, 0x41, 0x00, 0x42, 0x12, 0x40, 0x00, 0x7f, 0x00, 0x41, 0xf7 };
+			static const uint8_t xg[] = { 0xf0, 0x43, 0x10, 0x4c, 0x00, 0x00, 0x7e, 0x00, 0xf7 };
+			// Ignore the device IDs.
+			if (len == sizeof(gm) && data[1] == gm[1] && !memcmp(data + 3, gm + 3, sizeof(gm) - 3)) return true;
+			if (len == sizeof(gs) && data[1] == gs[1] && !memcmp(data + 3, gs + 3, sizeof(gs) - 3)) return true;
+			if (len == sizeof(xg) && data[1] == xg[1] && (data[2] & 0xf0) == 0x10 && !memcmp(data + 3, xg + 3, sizeof(xg) - 3)) return true;
+			return false;
+		}
+
+		void Add(const uint32_t *event)
+		{
+			int type = MEVENT_EVENTTYPE(event[2]);
+			if (type == MEVENT_TEMPO)
+			{
+				Tempo = MEVENT_EVENTPARM(event[2]);
+			}
+			else if (type == MEVENT_LONGMSG)
+			{
+				if (IsReset((const uint8_t *)&event[3], MEVENT_EVENTPARM(event[2])))
+				{
+					Reset();
+				}
+				size_t pos = SysEx.size();
+				SysEx.insert(SysEx.end(), event, event + EventSize(event));
+				SysEx[pos] = 0;	// delay
+			}
+			else if (type == 0)
+			{
+				int command = event[2] & 0xf0;
+				Channel &chan = Channels[event[2] & 0x0f];
+				int data1 = (event[2] >> 8) & 0x7f;
+				int data2 = (event[2] >> 16) & 0x7f;
+
+				switch (command)
+				{
+				case MIDI_PRGMCHANGE:
+					chan.Program = data1;
+					break;
+
+				case MIDI_PITCHBEND:
+					chan.PitchBend = data1 | (data2 << 7);
+					break;
+
+				case MIDI_CHANPRESS:
+					chan.Pressure = data1;
+					break;
+
+				case MIDI_CTRLCHANGE:
+					if (data1 == CC_ResetAll)
+					{
+						ResetControllers(chan);
+					}
+					else if (data1 < 120)
+					{
+						chan.Controllers[data1] = data2;
+						if (data1 == CC_NRPN_LSB || data1 == CC_NRPN_MSB) chan.NRPN = true;
+						else if (data1 == CC_RPN_LSB || data1 == CC_RPN_MSB) chan.NRPN = false;
+						else if (data1 == CC_DataEntry || data1 == CC_DataEntryLSB)
+						{
+							int msb = chan.Controllers[chan.NRPN ? CC_NRPN_MSB : CC_RPN_MSB];
+							int lsb = chan.Controllers[chan.NRPN ? CC_NRPN_LSB : CC_RPN_LSB];
+							auto &param = chan.Parameters.emplace(std::make_pair((chan.NRPN << 14) | ((msb & 0x7f) << 7) | (lsb & 0x7f), std::make_pair(int16_t(-1), int16_t(-1)))).first->second;
+							(data1 == CC_DataEntry ? param.first : param.second) = data2;
+						}
+					}
+					break;
+				}
+			}
+		}
+
+		static void Push(std::vector<uint32_t> &events, uint32_t event)
+		{
+			events.push_back(0);
+			events.push_back(0);
+			events.push_back(event);
+		}
+
+		void Write(std::vector<uint32_t> &events)
+		{
+			Push(events, (MEVENT_TEMPO << 24) | Tempo);
+			events.insert(events.end(), SysEx.begin(), SysEx.end());
+
+			for (int i = 0; i < 16; i++)
+			{
+				Channel &chan = Channels[i];
+				auto cc = [&](int num, int val) { if (val >= 0) Push(events, MIDI_CTRLCHANGE | i | (num << 8) | (val << 16)); };
+
+				cc(CC_BankSelect, chan.Controllers[CC_BankSelect]);
+				cc(CC_BankSelectLSB, chan.Controllers[CC_BankSelectLSB]);
+				if (chan.Program >= 0) Push(events, MIDI_PRGMCHANGE | i | (chan.Program << 8));
+
+				for (int c = 1; c < 120; c++)
+				{
+					if (c == CC_BankSelectLSB || c == CC_DataEntry || c == CC_DataEntryLSB || (c >= CC_NRPN_LSB && c <= CC_RPN_MSB)) continue;
+					cc(c, chan.Controllers[c]);
+				}
+				for (auto &param : chan.Parameters)
+				{
+					bool nrpn = param.first >> 14;
+					cc(nrpn ? CC_NRPN_MSB : CC_RPN_MSB, (param.first >> 7) & 0x7f);
+					cc(nrpn ? CC_NRPN_LSB : CC_RPN_LSB, param.first & 0x7f);
+					cc(CC_DataEntry, param.second.first);
+					cc(CC_DataEntryLSB, param.second.second);
+				}
+				// Restore the parameter selection the song left behind.
+				cc(CC_NRPN_MSB, chan.Controllers[CC_NRPN_MSB]);
+				cc(CC_NRPN_LSB, chan.Controllers[CC_NRPN_LSB]);
+				cc(CC_RPN_MSB, chan.Controllers[CC_RPN_MSB]);
+				cc(CC_RPN_LSB, chan.Controllers[CC_RPN_LSB]);
+
+				if (chan.PitchBend >= 0) Push(events, MIDI_PITCHBEND | i | ((chan.PitchBend & 0x7f) << 8) | ((chan.PitchBend >> 7) << 16));
+				if (chan.Pressure >= 0) Push(events, MIDI_CHANPRESS | i | (chan.Pressure << 8));
+			}
+		}
+	};
+}
+
+//==========================================================================
+//
+// MIDISource :: Seek
+//
+// Restarts the song and scans forward to the given time without playing
+// anything. Only MakeEvents gets called, so this is very fast. 'events'
+// receives a stream that restores the channel state at the target
+// position, followed by the already parsed events that come after it,
+// with the first one's delay shortened accordingly.
+//
+// Returns false if the song ends before the target position is reached.
+//
+//==========================================================================
+
+bool MIDISource::Seek(uint32_t ms, std::vector<uint32_t> &events)
+{
+	uint32_t Events[MAX_MIDI_EVENTS*3];
+	const double target = ms * 1000.;
+	double time = 0;	// in microseconds
+	double passstart = 0;
+
+	events.clear();
+	DoRestart();
+	Tempo = InitialTempo;
+	ChaseState state(InitialTempo);
+
+	for (;;)
+	{
+		if (CheckDone())
+		{
+			// A looping song starts over, just like MIDIStreamer would do it. Songs without any length would make this hang.
+			if (!isLooping || time <= passstart)
+			{
+				state.Write(events);
+				return false;
+			}
+			passstart = time;
+			DoRestart();
+			Tempo = InitialTempo;
+			state.Tempo = InitialTempo;
+			for (auto &chan : state.Channels) state.ResetControllers(chan);
+			continue;
+		}
+
+		uint32_t *event_end = MakeEvents(Events, &Events[MAX_MIDI_EVENTS*3], 100000);
+		for (uint32_t *event = Events; event < event_end; event += EventSize(event))
+		{
+			double eventtime = time + double(event[0]) * state.Tempo / Division;
+			if (eventtime >= target)
+			{
+				state.Write(events);
+				size_t restpos = events.size();
+				events.insert(events.end(), event, event_end);
+				events[restpos] = uint32_t((eventtime - target) * Division / state.Tempo + 0.5);
+				return true;
+			}
+			time = eventtime;
+			state.Add(event);
+		}
+	}
+}
+
+//==========================================================================
+//
+// MIDISource :: Analyze
+//
+// Runs through the song once, the same way as for precaching, to get its
+// length and all tempo changes. Loops inside the song are played once.
+//
+//==========================================================================
+
+void MIDISource::Analyze(SongAnalysis &info)
+{
+	uint32_t Events[MAX_MIDI_EVENTS*3];
+	double time = 0;	// in microseconds
+	bool looping = isLooping;
+	int looplimit = LoopLimit;
+
+	DoRestart();
+	StartPlayback(false, 1);
+	int tempo = InitialTempo;
+	info.TempoMap.clear();
+	info.TempoMap.push_back({ 0, uint32_t(InitialTempo) });
+
+	while (!CheckDone())
+	{
+		uint32_t *event_end = MakeEvents(Events, &Events[MAX_MIDI_EVENTS*3], 1000000*600);
+		for (uint32_t *event = Events; event < event_end; event += EventSize(event))
+		{
+			time += double(event[0]) * tempo / Division;
+			if (MEVENT_EVENTTYPE(event[2]) == MEVENT_TEMPO && (int)MEVENT_EVENTPARM(event[2]) != tempo)
+			{
+				tempo = MEVENT_EVENTPARM(event[2]);
+				ZMusicTempoChange change = { uint32_t(time / 1000), uint32_t(tempo) };
+				// Several changes at the same time only need the last one.
+				if (info.TempoMap.back().mTime == change.mTime) info.TempoMap.back() = change;
+				else info.TempoMap.push_back(change);
+			}
+		}
+	}
+	info.Info.mDuration = uint32_t(time / 1000 + 0.5);
+	info.Info.mTempoChanges = (int32_t)info.TempoMap.size();
+
+	StartPlayback(looping, looplimit);
+}
+
 //==========================================================================
 //
 // MIDISource :: CheckCaps
@@ -19,6 +19,8 @@
 extern const unsigned char MIDI_EventLengths[7];
 extern const unsigned char MIDI_CommonLengths[15];
 
+struct SongAnalysis;
+
 
 // base class for the different MIDI sources --------------------------------------
 
@@ -77,6 +79,8 @@ public:
 	}
 	
 	void CreateSMF(std::vector<uint8_t> &file, int looplimit);
+	bool Seek(uint32_t ms, std::vector<uint32_t> &events);
+	void Analyze(SongAnalysis &info);
 
 };
 
@@ -40,6 +40,7 @@
 #include <assert.h>
 #include "zmusic/zmusic_internal.h"
 #include "zmusic/musinfo.h"
+#include "zmusic/resampler.h"
 #include "mididevices/mididevice.h"
 #include "midisources/midisource.h"
 #include "critsec.h"
@@ -82,6 +83,7 @@ public:
 	bool SetSubsong(int subsong) override;
 	void Update() override;
 	std::string GetStats() override;
+	void GetPerfCounters(ZMusicPerfCounters &counters) override;
 	void ChangeSettingInt(const char* setting, int value) override;
 	void ChangeSettingNum(const char* setting, double value) override;
 	void ChangeSettingString(const char* setting, const char* value) override;
@@ -89,6 +91,8 @@ public:
 	void SetMIDISource(MIDISource* _source);
 	bool ServiceStream(void* buff, int len) override;
 	SoundStreamInfoEx GetStreamInfoEx() const override;
+	bool SetPosition(unsigned int ms) override;
+	bool Analyze(int subsong, SongAnalysis &info) override;
 
 	int GetDeviceType() const override;
 
@@ -124,6 +128,7 @@ protected:
 	};
 
 	std::unique_ptr<MIDIDevice> MIDI;
+	std::unique_ptr<StreamResampler> Resampler;
 	uint32_t Events[2][MAX_MIDI_EVENTS * 3];
 	MidiHeader Buffer[2];
 	int BufferNum;
@@ -138,6 +143,8 @@ protected:
 	int LoopLimit;
 	std::string Args;
 	std::unique_ptr<MIDISource> source;
+	std::vector<uint32_t> SeekEvents;	// queued by SetPosition, played before anything else from the source
+	size_t SeekPos = 0;
 };
 
 
@@ -224,7 +231,7 @@ EMidiDevice MIDIStreamer::SelectMIDIDevice(EMidiDevice device)
 	{
 		return device;
 	}
-	switch (miscConfig.snd_mididevice)
+	switch (currentContext->miscConfig.snd_mididevice)
 	{
 	case -1:		return MDEV_SNDSYS;
 	case -2:		return MDEV_TIMIDITY;
@@ -281,25 +288,26 @@ MIDIDevice *MIDIStreamer::CreateMIDIDevice(EMidiDevice devtype, int samplerate)
 
 #ifdef HAVE_SYSTEM_MIDI
 #ifdef _WIN32
-				dev = CreateWinMIDIDevice(std::max(0, miscConfig.snd_mididevice));
+				dev = CreateWinMIDIDevice(std::max(0, currentContext->miscConfig.snd_mididevice));
 #elif __linux__
-                dev = CreateAlsaMIDIDevice(std::max(0, miscConfig.snd_mididevice));
+                dev = CreateAlsaMIDIDevice(std::max(0, currentContext->miscConfig.snd_mididevice));
 #elif __APPLE__
-				dev = CreateCoreMIDIDevice(std::max(0, miscConfig.snd_mididevice));
+				dev = CreateCoreMIDIDevice(std::max(0, currentContext->miscConfig.snd_mididevice));
 #endif
 				break;
 #endif
 				// Intentional fall-through for systems without standard midi support
 
 			case MDEV_FLUIDSYNTH:
-				dev = CreateFluidSynthMIDIDevice(samplerate, Args.c_str());
+				dev = CreateSplitMIDIDevice([&]() { return CreateFluidSynthMIDIDevice(samplerate, Args.c_str()); });
 				break;
 
 			case MDEV_OPL:
-				dev = CreateOplMIDIDevice(Args.c_str());
+				dev = CreateOplMIDIDevice(Args.c_str(), samplerate);
 				break;
 
 			case MDEV_TIMIDITY:
+				// Not split, Timidity++ instances share the instrument data and the memory block pool so they cannot render in parallel.
 				dev = CreateTimidityPPMIDIDevice(Args.c_str(), samplerate);
 				break;
 
@@ -372,8 +380,12 @@ void MIDIStreamer::Play(bool looping, int subsong)
 	m_Looping = looping;
 	source->SetMIDISubsong(subsong);
 	devtype = SelectMIDIDevice(DeviceType);
-	MIDI.reset(CreateMIDIDevice(devtype, miscConfig.snd_outputrate));
-	InitPlayback();
+	MIDI.reset(CreateMIDIDevice(devtype, currentContext->miscConfig.snd_outputrate));
+	if (InitPlayback())
+	{
+		// Some synths can only run at their own rate. Those get resampled to the output rate if the client asked for it.
+		Resampler.reset(StreamResampler::Create(MIDI->GetStreamInfoEx()));
+	}
 }
 
 //==========================================================================
@@ -451,7 +463,8 @@ bool MIDIStreamer::InitPlayback()
 
 SoundStreamInfoEx MIDIStreamer::GetStreamInfoEx() const
 {
-	if (MIDI) return MIDI->GetStreamInfoEx();
+	if (Resampler) return Resampler->GetFormat();
+	else if (MIDI) return MIDI->GetStreamInfoEx();
 	else return {};
 }
 
@@ -573,6 +586,9 @@ void MIDIStreamer::Stop()
 	{
 		MIDI.reset();
 	}
+	Resampler.reset();
+	SeekEvents.clear();
+	SeekPos = 0;
 	m_Status = STATE_Stopped;
 }
 
@@ -584,15 +600,10 @@ void MIDIStreamer::Stop()
 
 bool MIDIStreamer::IsPlaying()
 {
-	if (m_Status != STATE_Stopped && (MIDI == NULL || (EndQueued != 0 && EndQueued < 4)))
-	{
-		std::lock_guard<FCriticalSection> lock(CritSec);
-		Stop();
-	}
-	if (m_Status != STATE_Stopped && !MIDI->IsOpen())
+	if (m_Status != STATE_Stopped && (MIDI == NULL || (EndQueued != 0 && EndQueued < 4) || !MIDI->IsOpen()))
 	{
-		std::lock_guard<FCriticalSection> lock(CritSec);
-		Stop();
+		// If the audio thread is busy with the song it stops it after the current block.
+		Post([this] { Stop(); });
 	}
 	return m_Status != STATE_Stopped;
 }
@@ -610,7 +621,7 @@ void MIDIStreamer::MusicVolumeChanged()
 {
 	if (MIDI != NULL && MIDI->FakeVolume())
 	{
-		float realvolume = miscConfig.snd_musicvolume * miscConfig.relative_volume * miscConfig.snd_mastervolume;
+		float realvolume = currentContext->miscConfig.snd_musicvolume * currentContext->miscConfig.relative_volume * currentContext->miscConfig.snd_mastervolume;
 		if (realvolume < 0 || realvolume > 1) realvolume = 1;
 		Volume = (uint32_t)(realvolume * 65535.f);
 	}
@@ -715,8 +726,7 @@ void MIDIStreamer::Update()
 {
 	if (MIDI != nullptr && !MIDI->Update())
 	{
-		std::lock_guard<FCriticalSection> lock(CritSec);
-		Stop();
+		Post([this] { Stop(); });
 	}
 }
 
@@ -784,6 +794,81 @@ fill:
 	return 0;
 }
 
+//==========================================================================
+//
+// MIDIStreamer :: SetPosition
+//
+// Jumps to the given time in ms. The source scans ahead to that point
+// without synthesizing anything and the device gets the resulting channel
+// state before playback continues. Only works with devices that can
+// discard what has already been queued, i.e. the software synths.
+//
+//==========================================================================
+
+bool MIDIStreamer::SetPosition(unsigned int ms)
+{
+	if (MIDI == nullptr || source == nullptr || m_Status == STATE_Stopped || !MIDI->FlushStream())
+	{
+		return false;
+	}
+	MIDI->UnprepareHeader(&Buffer[0]);
+	MIDI->UnprepareHeader(&Buffer[1]);
+
+	std::vector<uint32_t> chase;
+	bool res = source->Seek(ms, chase);
+
+	SeekEvents.resize(16 * 6);
+	WriteStopNotes(SeekEvents.data());
+	// All sound off too, so that release tails from the old position do not carry over.
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		SeekEvents.insert(SeekEvents.end(), { 0, 0, MIDI_CTRLCHANGE | i | (120 << 8) });
+	}
+	SeekEvents.insert(SeekEvents.end(), chase.begin(), chase.end());
+	SeekPos = 0;
+	// Nothing from before the seek may stay in the resampler's history either.
+	if (Resampler) Resampler->Reset();
+	Restarting = false;
+	EndQueued = 0;
+
+	// Refill both buffers from the new position.
+	BufferNum = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		if (ServiceEvent() != 0)
+		{
+			Stop();
+			return false;
+		}
+	}
+	return res;
+}
+
+//==========================================================================
+//
+// MIDIStreamer :: Analyze
+//
+// A looping MIDI always starts over from the beginning.
+//
+//==========================================================================
+
+bool MIDIStreamer::Analyze(int subsong, SongAnalysis &info)
+{
+	if (source == nullptr || !source->SetMIDISubsong(subsong))
+	{
+		return false;
+	}
+	int count = 1;
+	while (count < 256 && source->SetMIDISubsong(count)) count++;
+	source->SetMIDISubsong(subsong);
+
+	source->Analyze(info);
+	info.Info.mSubsongCount = count;
+	info.Info.mLoopStart = 0;
+	info.Info.mLoopEnd = info.Info.mDuration;
+	return true;
+}
+
 //==========================================================================
 //
 // MIDIStreamer :: FillBuffer
@@ -802,7 +887,7 @@ fill:
 
 int MIDIStreamer::FillBuffer(int buffer_num, int max_events, uint32_t max_time)
 {
-	if (!Restarting && source->CheckDone())
+	if (!Restarting && SeekPos >= SeekEvents.size() && source->CheckDone())
 	{
 		return SONG_DONE;
 	}
@@ -885,7 +970,25 @@ int MIDIStreamer::FillBuffer(int buffer_num, int max_events, uint32_t max_time)
 			events = WriteStopNotes(events);
 			source->DoRestart();
 		}
-		events = source->MakeEvents(events, max_event_p, max_time);
+		// After seeking, the chased state and the events behind the seek position need to go out first.
+		while (SeekPos < SeekEvents.size())
+		{
+			uint32_t *event = &SeekEvents[SeekPos];
+			size_t size = event[2] < 0x80000000 ? 3 : 3 + ((MEVENT_EVENTPARM(event[2]) + 3) >> 2);
+			if (events + size > max_event_p)
+			{
+				break;
+			}
+			memcpy(events, event, size * sizeof(uint32_t));
+			events += size;
+			SeekPos += size;
+		}
+		if (SeekPos >= SeekEvents.size())
+		{
+			SeekEvents.clear();
+			SeekPos = 0;
+			events = source->MakeEvents(events, max_event_p, max_time);
+		}
 	}
 	memset(&Buffer[buffer_num], 0, sizeof(MidiHeader));
 	Buffer[buffer_num].lpData = (uint8_t *)Events[buffer_num];
@@ -963,7 +1066,7 @@ uint32_t *MIDIStreamer::WriteStopNotes(uint32_t *events)
 void MIDIStreamer::SetMIDISource(MIDISource *_source)
 {
 	source.reset(_source);
-	source->setTempoCallback([=](int tempo) { return !!MIDI->SetTempo(tempo); } );
+	source->setTempoCallback([=](int tempo) { return MIDI != nullptr && !!MIDI->SetTempo(tempo); } );	// there is no device yet when analyzing the song.
 }
 
 int MIDIStreamer::GetDeviceType() const 
@@ -988,6 +1091,17 @@ std::string MIDIStreamer::GetStats()
 	return MIDI->GetStats();
 }
 
+//==========================================================================
+//
+// MIDIStreamer :: GetPerfCounters
+//
+//==========================================================================
+
+void MIDIStreamer::GetPerfCounters(ZMusicPerfCounters &counters)
+{
+	if (MIDI != nullptr) MIDI->GetPerfCounters(counters);
+}
+
 //==========================================================================
 //
 // MIDIStreamer :: SetSubsong
@@ -1016,7 +1130,9 @@ bool MIDIStreamer::SetSubsong(int subsong)
 bool MIDIStreamer::ServiceStream(void* buff, int len)
 {
 	if (!MIDI) return false;
-	return static_cast<SoftSynthMIDIDevice*>(MIDI.get())->ServiceStream(buff, len);
+	auto device = static_cast<SoftSynthMIDIDevice*>(MIDI.get());
+	if (Resampler) return Resampler->Fill(buff, len, [=](void *data, int size) { return device->ServiceStream(data, size); });
+	return device->ServiceStream(buff, len);
 }
 
 //==========================================================================
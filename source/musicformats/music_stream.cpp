@@ -34,6 +34,7 @@
 
 #include "zmusic/musinfo.h"
 #include "zmusic/zmusic_internal.h"
+#include "zmusic/resampler.h"
 #include "streamsources/streamsource.h"
 
 class StreamSong : public MusInfo
@@ -50,16 +51,19 @@ public:
 	bool SetPosition (unsigned int pos) override;
 	bool SetSubsong (int subsong) override;
 	std::string GetStats() override;
+	void GetPerfCounters(ZMusicPerfCounters &counters) override;
 	void ChangeSettingInt(const char *name, int value) override { if (m_Source) m_Source->ChangeSettingInt(name, value); }
 	void ChangeSettingNum(const char *name, double value) override { if (m_Source) m_Source->ChangeSettingNum(name, value); }
 	void ChangeSettingString(const char *name, const char *value) override { if(m_Source) m_Source->ChangeSettingString(name, value); }
 	bool ServiceStream(void* buff, int len) override;
-	SoundStreamInfoEx GetStreamInfoEx() const override { return m_Source->GetFormatEx(); }
+	SoundStreamInfoEx GetStreamInfoEx() const override { return m_Resampler ? m_Resampler->GetFormat() : m_Source->GetFormatEx(); }
+	bool Analyze(int subsong, SongAnalysis &info) override { return m_Source && m_Source->Analyze(subsong, info); }
 
 	
 protected:
 	
 	StreamSource *m_Source = nullptr;
+	std::unique_ptr<StreamResampler> m_Resampler;
 };
 
 
@@ -75,6 +79,7 @@ void StreamSong::Play (bool looping, int subsong)
 		m_Source->SetSubsong(subsong);
 		if (m_Source->Start())
 		{
+			m_Resampler.reset(StreamResampler::Create(m_Source->GetFormatEx()));
 			m_Status = STATE_Playing;
 		}
 	}
@@ -128,6 +133,7 @@ bool StreamSong::SetPosition(unsigned int pos)
 {
 	if (m_Source != nullptr)
 	{
+		if (m_Resampler) m_Resampler->Reset();
 		return m_Source->SetPosition(pos);
 	}
 	else
@@ -138,6 +144,7 @@ bool StreamSong::SetPosition(unsigned int pos)
 
 bool StreamSong::SetSubsong(int subsong)
 {
+	if (m_Resampler) m_Resampler->Reset();
 	return m_Source->SetSubsong(subsong);
 }
 
@@ -155,9 +162,16 @@ std::string StreamSong::GetStats()
 	return s1 + "\n" + s2;
 }
 
+void StreamSong::GetPerfCounters(ZMusicPerfCounters &counters)
+{
+	if (m_Source != nullptr) m_Source->GetPerfCounters(counters);
+}
+
 bool StreamSong::ServiceStream (void *buff, int len)
 {
-	bool written = m_Source->GetData(buff, len);
+	bool written = m_Resampler ?
+		m_Resampler->Fill(buff, len, [this](void *data, int size) { return m_Source->GetData(data, size); }) :
+		m_Source->GetData(buff, len);
 	if (!written)
 	{
 		m_Status = STATE_Stopped;
@@ -48,14 +48,14 @@
 #include "zmusic/m_swap.h"
 #include "zmusic/mididefs.h"
 #include "zmusic/midiconfig.h"
+#include "zmusic/simd.h"
+#include "zmusic/songcache.h"
 #include "fileio.h"
 
 // MACROS ------------------------------------------------------------------
 
 // TYPES -------------------------------------------------------------------
 
-DumbConfig dumbConfig;
-
 class DumbSong : public StreamSource
 {
 public:
@@ -67,6 +67,8 @@ public:
 	SoundStreamInfoEx GetFormatEx() override;
 	void ChangeSettingNum(const char* setting, double val) override;
 	std::string GetStats() override;
+	void GetPerfCounters(ZMusicPerfCounters &counters) override;
+	bool Analyze(int subsong, SongAnalysis &info) override;
 
 	std::string Codec;
 	std::string TrackerVersion;
@@ -75,6 +77,7 @@ public:
 	int NumPatterns;
 	int NumOrders;
 	float MasterVolume;
+	std::shared_ptr<DUH> SharedDuh;	// set if the DUH comes from the song cache. It then must not be unloaded here.
 
 protected:
 	int srate, interp, volramp;
@@ -549,6 +552,8 @@ DUMBFILE *dumb_read_allfile(dumbfile_mem_status *filestate, uint8_t *start, Musi
 	filestate->offset = 0;
 	if (lenhave >= lenfull)
 		filestate->ptr = (uint8_t *)start;
+	else if (reader->memory() != nullptr)
+		filestate->ptr = reader->memory();	// owned by the reader, so this must not be freed.
     else
     {
         uint8_t *mem = new uint8_t[lenfull];
@@ -574,10 +579,10 @@ DUMBFILE *dumb_read_allfile(dumbfile_mem_status *filestate, uint8_t *start, Musi
 
 static void MOD_SetAutoChip(DUH *duh)
 {
-	int size_force = dumbConfig.mod_autochip_size_force;
-	int size_scan = dumbConfig.mod_autochip_size_scan;
-	int scan_threshold_8 = ((dumbConfig.mod_autochip_scan_threshold * 0x100) + 50) / 100;
-	int scan_threshold_16 = ((dumbConfig.mod_autochip_scan_threshold * 0x10000) + 50) / 100;
+	int size_force = currentContext->dumbConfig.mod_autochip_size_force;
+	int size_scan = currentContext->dumbConfig.mod_autochip_size_scan;
+	int scan_threshold_8 = ((currentContext->dumbConfig.mod_autochip_scan_threshold * 0x100) + 50) / 100;
+	int scan_threshold_16 = ((currentContext->dumbConfig.mod_autochip_scan_threshold * 0x10000) + 50) / 100;
 	DUMB_IT_SIGDATA * itsd = duh_get_it_sigdata(duh);
 
 	if (itsd)
@@ -754,59 +759,36 @@ static void MOD_SetAutoChip(DUH *duh)
 
 //==========================================================================
 //
-// MOD_OpenSong
+// IdentifyDUMB
+//
+// Finds the loader for a module by its signature. 'size' is the file's
+// length, but 'start' only needs to contain the first 64 bytes of it.
+// Plain MODs are not included here because they get special treatment.
 //
 //==========================================================================
 
-StreamSource* MOD_OpenSong(MusicIO::FileInterface *reader, int samplerate)
-{
-	DUH *duh = 0;
-	int headsize;
-	union
-	{
-		uint8_t start[64];
-		uint32_t dstart[64/4];
-	};
-	dumbfile_mem_status filestate;
-	DUMBFILE *f = NULL;
-	DumbSong *state = NULL;
-
-	bool is_it = false;
-	bool is_dos = true;
-
-	auto fpos = reader->tell();
-    int size = (int)reader->filelength();
+typedef DUH *(DUMBEXPORT *DumbLoader)(DUMBFILE *f);
 
-	filestate.ptr = start;
-	filestate.offset = 0;
-	headsize = MIN((int)sizeof(start), size);
+static DUH *DUMBEXPORT dumb_read_psm_start_quick(DUMBFILE *f)
+{
+	return dumb_read_psm_quick(f, 0/*start_order*/);
+}
 
-    if (headsize != reader->read(start, headsize))
-    {
-        return NULL;
-    }
+static DumbLoader IdentifyDUMB(const uint8_t *start, int size)
+{
+	auto id = [=](int ofs) { return MAKE_ID(start[ofs], start[ofs + 1], start[ofs + 2], start[ofs + 3]); };
 
-	if (size >= 4 && dstart[0] == MAKE_ID('I','M','P','M'))
+	if (size >= 4 && id(0) == MAKE_ID('I','M','P','M'))
 	{
-		is_it = true;
-		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
-		{
-			duh = dumb_read_it_quick(f);
-		}
+		return dumb_read_it_quick;
 	}
 	else if (size >= 17 && !memcmp(start, "Extended Module: ", 17))
 	{
-		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
-		{
-			duh = dumb_read_xm_quick(f);
-		}
+		return dumb_read_xm_quick;
 	}
-	else if (size >= 0x30 && dstart[11] == MAKE_ID('S','C','R','M'))
+	else if (size >= 0x30 && id(44) == MAKE_ID('S','C','R','M'))
 	{
-		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
-		{
-			duh = dumb_read_s3m_quick(f);
-		}
+		return dumb_read_s3m_quick;
 	}
 	else if (size >= 1168 &&
 		/*start[28] == 0x1A &&*/ start[29] == 2 &&
@@ -814,87 +796,243 @@ StreamSource* MOD_OpenSong(MusicIO::FileInterface *reader, int samplerate)
 		  !memcmp( &start[20], "BMOD2STM", 8 ) ||
 		  !memcmp( &start[20], "WUZAMOD!", 8 ) ) )
 	{
-		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
-		{
-			duh = dumb_read_stm_quick(f);
-		}
+		return dumb_read_stm_quick;
 	}
 	else if (size >= 2 &&
 		((start[0] == 0x69 && start[1] == 0x66) ||
 		 (start[0] == 0x4A && start[1] == 0x4E)))
 	{
-		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
-		{
-			duh = dumb_read_669_quick(f);
-		}
+		return dumb_read_669_quick;
 	}
-	else if (size >= 0x30 && dstart[11] == MAKE_ID('P','T','M','F'))
+	else if (size >= 0x30 && id(44) == MAKE_ID('P','T','M','F'))
 	{
-		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
-		{
-			duh = dumb_read_ptm_quick(f);
-		}
+		return dumb_read_ptm_quick;
 	}
-	else if (size >= 4 && dstart[0] == MAKE_ID('P','S','M',' '))
+	else if (size >= 4 && id(0) == MAKE_ID('P','S','M',' '))
 	{
-		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
-		{
-			duh = dumb_read_psm_quick(f, 0/*start_order*/);
-			/*start_order = 0;*/
-		}
+		return dumb_read_psm_start_quick;
 	}
-	else if (size >= 4 && dstart[0] == (uint32_t)MAKE_ID('P','S','M',254))
+	else if (size >= 4 && id(0) == (uint32_t)MAKE_ID('P','S','M',254))
 	{
-		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
-		{
-			duh = dumb_read_old_psm_quick(f);
-		}
+		return dumb_read_old_psm_quick;
 	}
 	else if (size >= 3 && start[0] == 'M' && start[1] == 'T' && start[2] == 'M')
 	{
-		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
-		{
-			duh = dumb_read_mtm_quick(f);
-		}
+		return dumb_read_mtm_quick;
 	}
-	else if (size >= 12 && dstart[0] == MAKE_ID('R','I','F','F') &&
-		(dstart[2] == MAKE_ID('D','S','M','F') ||
-		 dstart[2] == MAKE_ID('A','M',' ',' ') ||
-		 dstart[2] == MAKE_ID('A','M','F','F')))
+	else if (size >= 12 && id(0) == MAKE_ID('R','I','F','F') &&
+		(id(8) == MAKE_ID('D','S','M','F') ||
+		 id(8) == MAKE_ID('A','M',' ',' ') ||
+		 id(8) == MAKE_ID('A','M','F','F')))
 	{
-		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
-		{
-			duh = dumb_read_riff_quick(f);
-		}
+		return dumb_read_riff_quick;
 	}
 	else if (size >= 32 &&
 		!memcmp( start, "ASYLUM Music Format", 19 ) &&
 		!memcmp( start + 19, " V1.0", 5 ) )
 	{
-		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
+		return dumb_read_asy_quick;
+	}
+	else if (size >= 8 &&
+		id(0) == MAKE_ID('O','K','T','A') &&
+		id(4) == MAKE_ID('S','O','N','G'))
+	{
+		return dumb_read_okt_quick;
+	}
+	else if (size >= 4 &&
+		 (id(0) == MAKE_ID('A','M','F','\xa') ||
+		 id(0) == MAKE_ID('A','M','F','\xb') ||
+		 id(0) == MAKE_ID('A','M','F','\xc') ||
+		 id(0) == MAKE_ID('A','M','F','\xd') ||
+		 id(0) == MAKE_ID('A','M','F','\xe')))
+	{
+		return dumb_read_amf_quick;
+	}
+	return nullptr;
+}
+
+//==========================================================================
+//
+// IsMODSignature
+//
+// The signatures of 31 instrument MODs. 15 instrument MODs have none.
+//
+//==========================================================================
+
+static bool IsMODSignature(const uint8_t *sig)
+{
+	static const char *const fixed[] = { "M.K.", "M!K!", "M&K!", "N.T.", "NSMS", "FLT4", "FLT8", "CD81", "OCTA", "OKTA", "16CN", "32CN" };
+	for (auto f : fixed)
+	{
+		if (!memcmp(sig, f, 4)) return true;
+	}
+	auto digit = [](uint8_t c) { return c >= '0' && c <= '9'; };
+	if (sig[1] == 0 && sig[2] == 0 && sig[3] == 0 && (sig[0] == 'M' || sig[0] == '8')) return true;
+	if (sig[2] == 'C' && sig[3] == 'H' && sig[0] >= '1' && sig[0] <= '3' && digit(sig[1])) return true;
+	if (sig[1] == 'C' && sig[2] == 'H' && sig[3] == 'N' && sig[0] >= '1' && sig[0] <= '9') return true;
+	if (sig[0] == 'T' && sig[1] == 'D' && sig[2] == 'Z' && sig[3] >= '1' && sig[3] <= '9') return true;
+	return false;
+}
+
+//==========================================================================
+//
+// IsMPTM
+//
+// OpenMPT's extensions to IT are stored in a chunk at the end of the file.
+//
+//==========================================================================
+
+static bool IsMPTM(const SongHeader &header)
+{
+	bool ret = false;
+	if (header.size >= 4 && !memcmp(header.data, "IMPM", 4))
+	{
+		auto reader = header.reader;
+		int chki = -1;
+		char chk[8] = "";
+		auto pos = reader->tell();
+		reader->seek(-4, SEEK_END);
+		reader->read(&chki, 4);
+		chki = LittleLong(chki);
+		if (chki >= 4 && chki < header.filelength - 4)
 		{
-			duh = dumb_read_asy_quick(f);
+			reader->seek(chki, SEEK_SET);
+			reader->read(chk, 8);
+			ret = !memcmp(chk, "228\4mptm", 8);
 		}
+		reader->seek(pos, SEEK_SET);
 	}
-	else if (size >= 8 &&
-		dstart[0] == MAKE_ID('O','K','T','A') &&
-		dstart[1] == MAKE_ID('S','O','N','G'))
+	return ret;
+}
+
+//==========================================================================
+//
+// MOD_Probe
+//
+// Everything DUMB plays has a signature, apart from 15 instrument MODs,
+// which are left to XMP.
+//
+//==========================================================================
+
+int MOD_Probe(const SongHeader &header)
+{
+	if (IdentifyDUMB(header.data, (int)header.filelength) != nullptr ||
+		(header.size >= 1084 && IsMODSignature(header.data + 1080)))
 	{
-		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
+		return PROBE_MAGIC;
+	}
+	return PROBE_NO;
+}
+
+//==========================================================================
+//
+// MOD_IsPreferred
+//
+// Formats XMP does not support, or does not play right, even though it
+// may accept them.
+//
+//==========================================================================
+
+bool MOD_IsPreferred(const SongHeader &header)
+{
+	return (header.size >= 12 && !memcmp(header.data, "RIFF", 4) && !memcmp(header.data + 8, "DSMF", 4)) || IsMPTM(header);
+}
+
+//==========================================================================
+//
+// CachedDUH
+//
+// What the song cache keeps of a module so that it only gets loaded once.
+// Every song playing it has its own renderer, which only reads from it.
+//
+//==========================================================================
+
+struct CachedDUH
+{
+	DUH *duh;
+	bool is_it;
+	bool is_dos;
+
+	~CachedDUH() { unload_duh(duh); }
+};
+
+static size_t DUHSize(DUH *duh)
+{
+	size_t size = 0;
+	DUMB_IT_SIGDATA *itsd = duh_get_it_sigdata(duh);
+	if (itsd != nullptr)
+	{
+		for (int i = 0; i < itsd->n_samples; i++)
 		{
-			duh = dumb_read_okt_quick(f);
+			auto &sample = itsd->sample[i];
+			size += size_t(sample.length) * (sample.flags & IT_SAMPLE_16BIT ? 2 : 1) * (sample.flags & IT_SAMPLE_STEREO ? 2 : 1);
+		}
+		for (int i = 0; i < itsd->n_patterns; i++)
+		{
+			size += itsd->pattern[i].n_entries * sizeof(IT_ENTRY);
 		}
 	}
-	else if (size >= 4 &&
-		 (dstart[0] == MAKE_ID('A','M','F','\xa') ||
-		 dstart[0] == MAKE_ID('A','M','F','\xb') ||
-		 dstart[0] == MAKE_ID('A','M','F','\xc') ||
-		 dstart[0] == MAKE_ID('A','M','F','\xd') ||
-		 dstart[0] == MAKE_ID('A','M','F','\xe')))
+	return size;
+}
+
+//==========================================================================
+//
+// MOD_OpenSong
+//
+//==========================================================================
+
+StreamSource* MOD_OpenSong(MusicIO::FileInterface *reader, int samplerate, CachedSong *cache)
+{
+	DUH *duh = 0;
+	int headsize;
+	uint8_t start[64];
+	dumbfile_mem_status filestate;
+	DUMBFILE *f = NULL;
+	DumbSong *state = NULL;
+
+	bool is_it = false;
+	bool is_dos = true;
+
+	auto fpos = reader->tell();
+    int size = (int)reader->filelength();
+
+	filestate.ptr = start;
+	filestate.offset = 0;
+	headsize = MIN((int)sizeof(start), size);
+
+    if (headsize != reader->read(start, headsize))
+    {
+        return NULL;
+    }
+
+	// Autochip modifies the samples, depending on the current settings.
+	if (cache != nullptr && currentContext->dumbConfig.mod_autochip)
+	{
+		cache = nullptr;
+	}
+	if (cache != nullptr)
+	{
+		std::shared_ptr<CachedDUH> parsed;
+		{
+			std::lock_guard<std::mutex> lock(cache->ParsedMutex);
+			parsed = std::static_pointer_cast<CachedDUH>(cache->Parsed);
+		}
+		if (parsed != nullptr)
+		{
+			state = new DumbSong(parsed->duh, samplerate);
+			state->SharedDuh = std::shared_ptr<DUH>(parsed, parsed->duh);
+			if (parsed->is_it) ReadIT(cache->Data.data(), (unsigned)cache->Data.size(), state, false);
+			else ReadDUH(parsed->duh, state, false, parsed->is_dos);
+			return state;
+		}
+	}
+
+	if (auto loader = IdentifyDUMB(start, size))
 	{
+		is_it = loader == dumb_read_it_quick;
 		if ((f = dumb_read_allfile(&filestate, start, reader, headsize, size)))
 		{
-			duh = dumb_read_amf_quick(f);
+			duh = loader(f);
 		}
 	}
 
@@ -927,7 +1065,7 @@ StreamSource* MOD_OpenSong(MusicIO::FileInterface *reader, int samplerate)
 	}
 	if ( duh )
 	{
-		if (dumbConfig.mod_autochip)
+		if (currentContext->dumbConfig.mod_autochip)
 		{
 			MOD_SetAutoChip(duh);
 		}
@@ -935,13 +1073,35 @@ StreamSource* MOD_OpenSong(MusicIO::FileInterface *reader, int samplerate)
 
 		if (is_it) ReadIT(filestate.ptr, size, state, false);
 		else ReadDUH(duh, state, false, is_dos);
+
+		if (cache != nullptr)
+		{
+			// DUMB finishes setting up the samples when the first renderer starts. Do that now, so that the songs sharing this only read from it.
+			duh_end_sigrenderer(duh_start_sigrenderer(duh, 0, 2, 0));
+
+			auto parsed = std::make_shared<CachedDUH>();
+			parsed->duh = duh;
+			parsed->is_it = is_it;
+			parsed->is_dos = is_dos;
+			state->SharedDuh = std::shared_ptr<DUH>(parsed, duh);
+
+			{
+				std::lock_guard<std::mutex> lock(cache->ParsedMutex);
+				if (cache->Parsed == nullptr)
+				{
+					cache->Parsed = parsed;
+					cache->ParsedSize = DUHSize(duh);
+				}
+			}
+			SongCache::Trim();
+		}
 	}
 	else
 	{
 		// Reposition file pointer for other codecs to do their checks.
         reader->seek(fpos, SEEK_SET);
 	}
-	if (filestate.ptr != (uint8_t *)start)
+	if (filestate.ptr != (uint8_t *)start && filestate.ptr != reader->memory())
 	{
 		delete[] const_cast<uint8_t *>(filestate.ptr);
 	}
@@ -976,11 +1136,8 @@ bool DumbSong::GetData(void *buffer, size_t sizebytes)
 		}
 		else
 		{
-			// Convert to float
-			for (int i = 0; i < written * 2; ++i)
-			{
-				((float *)buffer)[i] = (((int *)buffer)[i] / (float)(1 << 24)) * MasterVolume;
-			}
+			// Convert to float. DUMB's mix is 8.24 fixed point.
+			SIMD::ConvertSamples(buffer, SIMD::Sample_Float32, buffer, SIMD::Sample_Int32, written * 2, MasterVolume * 128, currentContext->miscConfig.snd_softclip);
 		}
 		buffer = (uint8_t *)buffer + written * 8;
 		sizebytes -= written * 8;
@@ -1011,15 +1168,15 @@ DumbSong::DumbSong(DUH* myduh, int samplerate)
 	duh = myduh;
 	sr = NULL;
 	eof = false;
-	interp = dumbConfig.mod_interp;
-	volramp = dumbConfig.mod_volramp;
+	interp = currentContext->dumbConfig.mod_interp;
+	volramp = currentContext->dumbConfig.mod_volramp;
 	written = 0;
 	length = 0;
 	start_order = 0;
-	MasterVolume = (float)dumbConfig.mod_dumb_mastervolume * 4;
-	if (dumbConfig.mod_samplerate != 0)
+	MasterVolume = (float)currentContext->dumbConfig.mod_dumb_mastervolume * 4;
+	if (currentContext->dumbConfig.mod_samplerate != 0)
 	{
-		srate = dumbConfig.mod_samplerate;
+		srate = currentContext->dumbConfig.mod_samplerate;
 	}
 	else
 	{
@@ -1037,7 +1194,7 @@ DumbSong::DumbSong(DUH* myduh, int samplerate)
 DumbSong::~DumbSong()
 {
 	if (sr) duh_end_sigrenderer(sr);
-	if (duh) unload_duh(duh);
+	if (duh && !SharedDuh) unload_duh(duh);
 }
 
 //==========================================================================
@@ -1063,6 +1220,43 @@ bool DumbSong::Start()
 	return started;
 }
 
+//==========================================================================
+//
+// DumbSong :: Analyze
+//
+// Uses DUMB's own subsong scanner, which runs the player without mixing
+// anything. Every start order it reports is a subsong.
+//
+//==========================================================================
+
+bool DumbSong::Analyze(int order, SongAnalysis &info)
+{
+	struct ScanResult
+	{
+		int order;
+		int count;
+		int32_t length;
+	} scan = { order, 0, -1 };
+
+	DUMB_IT_SIGDATA *itsd = duh_get_it_sigdata(duh);
+	if (itsd == nullptr) return false;
+
+	auto callback = [](void *data, int startorder, int32 length) -> int
+	{
+		auto scan = (ScanResult *)data;
+		scan->count++;
+		if (startorder == scan->order) scan->length = length;
+		return 0;
+	};
+	if (dumb_it_scan_for_playable_orders(itsd, callback, &scan) < 0 || scan.length < 0)
+	{
+		return false;
+	}
+	info.Info.mSubsongCount = scan.count;
+	info.Info.mDuration = uint32_t(int64_t(scan.length) * 1000 / 65536);
+	return true;
+}
+
 //==========================================================================
 //
 // DumbSong :: SetSubsong
@@ -1189,16 +1383,15 @@ retry:
 
 //==========================================================================
 //
-// DumbSong :: GetStats
+// CountChannels
+//
+// Counts the channels that are currently producing sound, including the
+// ones kept alive by new note actions.
 //
 //==========================================================================
 
-std::string DumbSong::GetStats()
+static int CountChannels(DUMB_IT_SIGRENDERER *itsr)
 {
-	//return StreamSong::GetStats();
-	DUMB_IT_SIGRENDERER *itsr = duh_get_it_sigrenderer(sr);
-	DUMB_IT_SIGDATA *itsd = duh_get_it_sigdata(duh);
-
 	int channels = 0;
 	for (int i = 0; i < DUMB_IT_N_CHANNELS; i++)
 	{
@@ -1209,6 +1402,20 @@ std::string DumbSong::GetStats()
 	{
 		if (itsr->playing[i]) channels++;
 	}
+	return channels;
+}
+
+//==========================================================================
+//
+// DumbSong :: GetStats
+//
+//==========================================================================
+
+std::string DumbSong::GetStats()
+{
+	//return StreamSong::GetStats();
+	DUMB_IT_SIGRENDERER *itsr = duh_get_it_sigrenderer(sr);
+	DUMB_IT_SIGDATA *itsd = duh_get_it_sigdata(duh);
 
 	if (itsr == NULL || itsd == NULL)
 	{
@@ -1216,6 +1423,7 @@ std::string DumbSong::GetStats()
 	}
 	else
 	{
+		int channels = CountChannels(itsr);
 		char out[120];
 		snprintf(out, 120, "%s, Order:%3d/%d Patt:%2d/%d Row:%2d/%2d Chan:%2d/%2d Speed:%2d Tempo:%3d",
 			Codec.c_str(),
@@ -1230,3 +1438,15 @@ std::string DumbSong::GetStats()
 	}
 }
 
+//==========================================================================
+//
+// DumbSong :: GetPerfCounters
+//
+//==========================================================================
+
+void DumbSong::GetPerfCounters(ZMusicPerfCounters &counters)
+{
+	DUMB_IT_SIGRENDERER *itsr = duh_get_it_sigrenderer(sr);
+	if (itsr != NULL) counters.mActiveVoices = CountChannels(itsr);
+}
+
@@ -60,6 +60,7 @@ public:
 	std::string GetStats() override;
 	bool GetData(void *buffer, size_t len) override;
 	SoundStreamInfoEx GetFormatEx() override;
+	bool Analyze(int subsong, SongAnalysis &info) override;
 
 protected:
 	Music_Emu *Emu;
@@ -91,13 +92,38 @@ protected:
 
 //==========================================================================
 //
-// GME_CheckFormat
+// GME_Format
+//
+// Returns the name GME knows the format by, from either the signature or
+// the file name's extension, or nullptr if it isn't one of GME's.
+//
+//==========================================================================
+
+const char *GME_Format(const SongHeader &header)
+{
+	if (header.size >= 4)
+	{
+		auto fmt = gme_identify_header(header.data);
+		if (fmt != nullptr && fmt[0] != '\0') return fmt;
+	}
+	if (header.ext[0] != '\0' && gme_identify_extension(header.ext) != nullptr)
+	{
+		return header.ext;
+	}
+	return nullptr;
+}
+
+//==========================================================================
+//
+// GME_Probe
 //
 //==========================================================================
 
-const char *GME_CheckFormat(uint32_t id)
+int GME_Probe(const SongHeader &header)
 {
-	return gme_identify_header(&id);
+	auto fmt = GME_Format(header);
+	if (fmt == nullptr) return PROBE_NO;
+	return fmt == header.ext ? PROBE_EXTENSION : PROBE_MAGIC;
 }
 
 //==========================================================================
@@ -127,24 +153,32 @@ StreamSource *GME_OpenSong(MusicIO::FileInterface *reader, const char *fmt, int
     auto fpos = reader->tell();
 	auto len = reader->filelength();
 
-	song = new uint8_t[len];
-    if (reader->read(song, len) != len)
-    {
-        delete[] song;
-        gme_delete(emu);
-        reader->seek(fpos, SEEK_SET);
-        return nullptr;
-    }
+	// GME copies the data itself so a memory based reader can be used directly.
+	if (auto mem = reader->memory())
+	{
+		err = gme_load_data(emu, mem, (long)len);
+	}
+	else
+	{
+		song = new uint8_t[len];
+		if (reader->read(song, len) != len)
+		{
+			delete[] song;
+			gme_delete(emu);
+			reader->seek(fpos, SEEK_SET);
+			return nullptr;
+		}
 
-	err = gme_load_data(emu, song, (long)len);
-    delete[] song;
+		err = gme_load_data(emu, song, (long)len);
+		delete[] song;
+	}
 
 	if (err != nullptr)
 	{
 		gme_delete(emu);
 		throw std::runtime_error(err);
 	}
-	gme_set_stereo_depth(emu, std::min(std::max(miscConfig.gme_stereodepth, 0.f), 1.f));
+	gme_set_stereo_depth(emu, std::min(std::max(currentContext->miscConfig.gme_stereodepth, 0.f), 1.f));
 	gme_set_fade(emu, -1); // Enable infinite loop
 
 #if GME_VERSION >= 0x602
@@ -347,6 +381,36 @@ int GMESong::CalcSongLength()
 	return 150000;
 }
 
+//==========================================================================
+//
+// GMESong :: Analyze
+//
+// GME only knows what the file's tags say. Tracks without any length
+// information get the same default as non-looped playback fades out at.
+//
+//==========================================================================
+
+bool GMESong::Analyze(int subsong, SongAnalysis &info)
+{
+	gme_info_t *trackinfo;
+
+	if (gme_track_info(Emu, &trackinfo, subsong) != NULL)
+	{
+		return false;
+	}
+	info.Info.mSubsongCount = gme_track_count(Emu);
+	if (trackinfo->loop_length > 0)
+	{
+		info.Info.mLoopStart = std::max(trackinfo->intro_length, 0);
+		info.Info.mLoopEnd = info.Info.mLoopStart + trackinfo->loop_length;
+	}
+	if (trackinfo->length > 0) info.Info.mDuration = trackinfo->length;
+	else if (trackinfo->loop_length > 0) info.Info.mDuration = info.Info.mLoopEnd;
+	else info.Info.mDuration = 150000;
+	gme_free_info(trackinfo);
+	return true;
+}
+
 //==========================================================================
 //
 // GMESong :: Read													STATIC
@@ -36,6 +36,7 @@
 
 #include <mutex>
 #include <algorithm>
+#include <string.h>
 #include "zmusic_internal.h"
 #include "streamsource.h"
 #include "zmusic/sounddecoder.h"
@@ -50,17 +51,26 @@ public:
 	SndFileSong(SoundDecoder *decoder, uint32_t loop_start, uint32_t loop_end, bool startass, bool endass);
 	~SndFileSong();
 	std::string GetStats() override;
+	void GetPerfCounters(ZMusicPerfCounters &counters) override;
 	SoundStreamInfoEx GetFormatEx() override;
 	bool GetData(void *buffer, size_t len) override;
+	bool Analyze(int subsong, SongAnalysis &info) override;
 	
 protected:
 	SoundDecoder *Decoder;
 	unsigned int FrameSize;
+	uint64_t BytesDecoded = 0;
 
 	uint32_t Loop_Start;
 	uint32_t Loop_End;
 
 	int CalcSongLength();
+	size_t Decode(char *buff, size_t len)
+	{
+		size_t got = Decoder->read(buff, len);
+		BytesDecoded += got;
+		return got;
+	}
 };
 
 // EXTERNAL FUNCTION PROTOTYPES --------------------------------------------
@@ -400,6 +410,35 @@ DLL_EXPORT void FindLoopTags(const uint8_t* data, size_t size, uint32_t* start,
 	reader->close();
 }
 
+//==========================================================================
+//
+// SndFile_Probe
+//
+// libsndfile reads a lot of obscure formats, so this is only a guess for
+// anything that isn't one of the common ones. It's tried last anyway.
+//
+//==========================================================================
+
+int SndFile_Probe(const SongHeader &header)
+{
+	static const char *const extensions[] = { "wav", "ogg", "oga", "flac", "aif", "aiff", "aifc", "mp3", "mp2", "opus", "au", "snd", "voc", "w64", "caf" };
+
+	auto data = header.data;
+	if (header.size >= 12 &&
+		((!memcmp(data, "RIFF", 4) && !memcmp(data + 8, "WAVE", 4)) ||
+		 (!memcmp(data, "FORM", 4) && (!memcmp(data + 8, "AIFF", 4) || !memcmp(data + 8, "AIFC", 4))) ||
+		 !memcmp(data, "OggS", 4) || !memcmp(data, "fLaC", 4) || !memcmp(data, "ID3", 3) ||
+		 (data[0] == 0xff && (data[1] & 0xe0) == 0xe0)))	// MPEG frame sync
+	{
+		return PROBE_MAGIC;
+	}
+	for (auto ext : extensions)
+	{
+		if (!strcmp(header.ext, ext)) return PROBE_EXTENSION;
+	}
+	return PROBE_MAYBE;
+}
+
 //==========================================================================
 //
 // SndFile_OpenSong
@@ -499,6 +538,43 @@ std::string SndFileSong::GetStats()
 	return out;
 }
 
+//==========================================================================
+//
+// SndFileSong :: GetPerfCounters
+//
+//==========================================================================
+
+void SndFileSong::GetPerfCounters(ZMusicPerfCounters &counters)
+{
+	counters.mBytesDecoded = BytesDecoded;
+}
+
+//==========================================================================
+//
+// SndFileSong :: Analyze
+//
+// All that's needed is the decoder's sample count and the loop tags.
+//
+//==========================================================================
+
+bool SndFileSong::Analyze(int subsong, SongAnalysis &info)
+{
+	ChannelConfig chanconf;
+	SampleType stype;
+	int srate;
+	Decoder->getInfo(&srate, &chanconf, &stype);
+
+	const uint32_t sampleLength = (uint32_t)Decoder->getSampleLength();
+	if (subsong != 0 || sampleLength == 0 || srate <= 0)
+	{
+		return false;
+	}
+	info.Info.mDuration = Scale(sampleLength, 1000, srate);
+	info.Info.mLoopStart = Scale(std::min(Loop_Start, sampleLength), 1000, srate);
+	info.Info.mLoopEnd = Scale(std::min(Loop_End, sampleLength), 1000, srate);
+	return true;
+}
+
 //==========================================================================
 //
 // SndFileSong :: Read													STATIC
@@ -522,12 +598,12 @@ bool SndFileSong::GetData(void *vbuff, size_t len)
 		}
 		if (currentpos + framestoread > maxpos)
 		{
-			size_t got = Decoder->read(buff, (maxpos - currentpos) * FrameSize);
+			size_t got = Decode(buff, (maxpos - currentpos) * FrameSize);
 			memset(buff + got, 0, len - got);
 		}
 		else
 		{
-			size_t got = Decoder->read(buff, len);
+			size_t got = Decode(buff, len);
 			err = (got != len);
 		}
 	}
@@ -540,7 +616,7 @@ bool SndFileSong::GetData(void *vbuff, size_t len)
 			if (currentpos < Loop_End)
 			{
 				size_t endblock = (Loop_End - currentpos) * FrameSize;
-				size_t endlen = Decoder->read(buff, endblock);
+				size_t endlen = Decode(buff, endblock);
 
 				// Even if zero bytes was read give it a chance to start from the beginning
 				buff += endlen;
@@ -551,7 +627,7 @@ bool SndFileSong::GetData(void *vbuff, size_t len)
 		}
 		while (len > 0)
 		{
-			size_t readlen = Decoder->read(buff, len);
+			size_t readlen = Decode(buff, len);
 			if (readlen == 0)
 			{
 				return false;
@@ -44,10 +44,9 @@
 #include "zmusic/m_swap.h"
 #include "zmusic/mididefs.h"
 #include "zmusic/midiconfig.h"
+#include "zmusic/simd.h"
 #include "fileio.h"
 
-extern DumbConfig dumbConfig;
-
 static unsigned long xmp_read(void *dest, unsigned long len, unsigned long nmemb, void *priv)
 {
 	if (len == 0 || nmemb == 0)
@@ -90,6 +89,8 @@ public:
 	bool SetSubsong(int subsong) override;
 	bool Start() override;
 	SoundStreamInfoEx GetFormatEx() override;
+	bool Analyze(int subsong, SongAnalysis &info) override;
+	void GetPerfCounters(ZMusicPerfCounters &counters) override;
 
 protected:
 	bool GetData(void *buffer, size_t len) override;
@@ -98,9 +99,9 @@ protected:
 XMPSong::XMPSong(xmp_context ctx, int rate)
 {
 	context = ctx;
-	samplerate = (dumbConfig.mod_samplerate != 0) ? dumbConfig.mod_samplerate : rate;
+	samplerate = (currentContext->dumbConfig.mod_samplerate != 0) ? currentContext->dumbConfig.mod_samplerate : rate;
 	xmp_set_player(context, XMP_PLAYER_VOLUME, 100);
-	xmp_set_player(context, XMP_PLAYER_INTERP, dumbConfig.mod_interp);
+	xmp_set_player(context, XMP_PLAYER_INTERP, currentContext->dumbConfig.mod_interp);
 
 	int16_buffer.reserve(16 * 1024);
 }
@@ -124,21 +125,45 @@ bool XMPSong::SetSubsong(int subsong)
 	return true;
 }
 
+// libxmp already scans all sequences for their length when loading. Subsongs are start orders here.
+bool XMPSong::Analyze(int subsong, SongAnalysis &info)
+{
+	xmp_module_info mi;
+	xmp_get_module_info(context, &mi);
+	if (mi.num_sequences <= 0 || mi.seq_data == nullptr) return false;
+
+	// Subsongs are addressed by the order position they start at, anything else is not a subsong.
+	for (int i = 0; i < mi.num_sequences; i++)
+	{
+		if (mi.seq_data[i].entry_point == subsong)
+		{
+			info.Info.mSubsongCount = mi.num_sequences;
+			info.Info.mDuration = mi.seq_data[i].duration;
+			return true;
+		}
+	}
+	return false;
+}
+
+void XMPSong::GetPerfCounters(ZMusicPerfCounters &counters)
+{
+	if (xmp_get_player(context, XMP_PLAYER_STATE) < XMP_STATE_PLAYING) return;
+	xmp_frame_info fi;
+	xmp_get_frame_info(context, &fi);
+	counters.mActiveVoices = fi.virt_used;
+}
+
 bool XMPSong::GetData(void *buffer, size_t len)
 {
 	if ((len / 4) > int16_buffer.size())
 		int16_buffer.resize(len / 4);
 
 	int ret = xmp_play_buffer(context, (void*)int16_buffer.data(), len / 2, m_Looping? INT_MAX : 0);
-	xmp_set_player(context, XMP_PLAYER_INTERP, dumbConfig.mod_interp);
+	xmp_set_player(context, XMP_PLAYER_INTERP, currentContext->dumbConfig.mod_interp);
 
 	if (ret >= 0)
 	{
-		float* soundbuffer = (float*)buffer;
-		for (unsigned int i = 0; i < len / 4; i++)
-		{
-			soundbuffer[i] = ((int16_buffer[i] < 0.) ? (int16_buffer[i] / 32768.) : (int16_buffer[i] / 32767.)) * dumbConfig.mod_dumb_mastervolume;
-		}
+		SIMD::ConvertSamples(buffer, SIMD::Sample_Float32, int16_buffer.data(), SIMD::Sample_Int16, int(len / 4), currentContext->dumbConfig.mod_dumb_mastervolume, currentContext->miscConfig.snd_softclip);
 	}
 
 	if (ret < 0 && m_Looping)
@@ -159,6 +184,13 @@ bool XMPSong::Start()
 	return ret >= 0;
 }
 
+// XMP supports a lot of formats without any signature to speak of, so anything DUMB can't identify is worth a try.
+int XMP_Probe(const SongHeader &header)
+{
+	if (MOD_IsPreferred(header)) return PROBE_NO;
+	return MOD_Probe(header) == PROBE_MAGIC ? PROBE_MAGIC : PROBE_MAYBE;
+}
+
 StreamSource* XMP_OpenSong(MusicIO::FileInterface* reader, int samplerate)
 {
 	if (xmp_test_module_from_callbacks((void*)reader, callbacks, nullptr) < 0)
@@ -36,12 +36,15 @@
 #ifdef HAVE_OPL
 
 #include <stdexcept>
+#include <string.h>
 
 #include "streamsource.h"
 #include "oplsynth/opl.h"
 #include "oplsynth/opl_mus_player.h"
 #include "fileio.h"
 #include "zmusic/midiconfig.h"
+#include "zmusic/threadpool.h"
+#include "zmusic/resampler.h"
 
 //==========================================================================
 //
@@ -63,6 +66,7 @@ protected:
 
 	OPLmusicFile *Music;
 	int current_opl_core;
+	std::unique_ptr<StreamResampler> Resampler;
 };
 
 
@@ -86,7 +90,14 @@ OPLMUSSong::OPLMUSSong(MusicIO::FileInterface* reader, OPLConfig* config)
 		delete Music;
 		throw std::runtime_error(error);
 	}
+	Music->ParallelFor = [](int count, const std::function<void(int)> &job) { WorkerPool::Shared().Run(count, job); };
 	current_opl_core = config->core;
+
+	int outrate = currentContext->miscConfig.snd_outputrate;
+	if (config->resample > 0 && outrate > 0 && outrate != int(OPL_SAMPLE_RATE))
+	{
+		Resampler.reset(new StreamResampler(GetFormatEx(), outrate, config->resample));
+	}
 }
 
 //==========================================================================
@@ -97,6 +108,10 @@ OPLMUSSong::OPLMUSSong(MusicIO::FileInterface* reader, OPLConfig* config)
 
 SoundStreamInfoEx OPLMUSSong::GetFormatEx()
 {
+	if (Resampler != nullptr)
+	{
+		return Resampler->GetFormat();
+	}
 	int samples = int(OPL_SAMPLE_RATE / 14);
 	return { samples * 4, int(OPL_SAMPLE_RATE), SampleType_Float32,
 		current_opl_core == 0? ChannelConfig_Mono:ChannelConfig_Stereo };
@@ -138,6 +153,7 @@ bool OPLMUSSong::Start()
 {
 	Music->SetLooping (m_Looping);
 	Music->Restart ();
+	if (Resampler != nullptr) Resampler->Reset();
 	return true;
 }
 
@@ -149,9 +165,26 @@ bool OPLMUSSong::Start()
 
 bool OPLMUSSong::GetData(void *buffer, size_t len)
 {
+	if (Resampler != nullptr)
+	{
+		return Resampler->Fill(buffer, int(len), [this](void *data, int size) { return Music->ServiceStream(data, size); });
+	}
 	return Music->ServiceStream(buffer, int(len)) ? len : 0;
 }
 
+int OPL_Probe(const SongHeader &header)
+{
+	auto data = header.data;
+	if (header.size >= 8 &&
+		(!memcmp(data, "RAWADATA", 8) ||						// Rdos Raw OPL
+		 !memcmp(data, "DBRAWOPL", 8) ||						// DosBox Raw OPL
+		 (!memcmp(data, "ADLI", 4) && data[4] == 'B')))		// Martin Fernandez's modified IMF
+	{
+		return PROBE_MAGIC;
+	}
+	return PROBE_NO;
+}
+
 StreamSource *OPL_OpenSong(MusicIO::FileInterface* reader, OPLConfig *config)
 {
 	return new OPLMUSSong(reader, config);
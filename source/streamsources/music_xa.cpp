@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <string.h>
 #include "streamsource.h"
 #include "fileio.h"
 
@@ -341,6 +342,18 @@ bool XASong::GetData(void *vbuff, size_t len)
 	return !xad.finished;
 } 
 
+//==========================================================================
+//
+// XA_Probe
+//
+//==========================================================================
+
+int XA_Probe(const SongHeader &header)
+{
+	bool isxa = header.size >= 12 && !memcmp(header.data, "RIFF", 4) && !memcmp(header.data + 8, "CDXA", 4);
+	return isxa ? PROBE_MAGIC : PROBE_NO;
+}
+
 //==========================================================================
 //
 // XA_OpenSong
@@ -22,7 +22,9 @@ public:
 	virtual bool SetSubsong(int subsong) { return false; }
 	virtual bool GetData(void *buffer, size_t len) = 0;
 	virtual SoundStreamInfoEx GetFormatEx() = 0;
+	virtual bool Analyze(int subsong, SongAnalysis &info) { return false; }
 	virtual std::string GetStats() { return ""; }
+	virtual void GetPerfCounters(ZMusicPerfCounters &counters) {}
 	virtual void ChangeSettingInt(const char *name, int value) {  }
 	virtual void ChangeSettingNum(const char *name, double value) {  }
 	virtual void ChangeSettingString(const char *name, const char *value) {  }
@@ -32,7 +34,36 @@ protected:
 };
 
 
-StreamSource *MOD_OpenSong(MusicIO::FileInterface* reader, int samplerate);
+// Format detection. Every player rates how likely it can play a file by looking at its start, then they get tried best match first.
+
+enum EProbeResult
+{
+	PROBE_NO,			// definitely not this format.
+	PROBE_MAYBE,		// formats without a reliable signature, which can only be found out by loading the file.
+	PROBE_EXTENSION,	// only the file name's extension matches.
+	PROBE_MAGIC,		// the format's signature matches.
+};
+
+struct SongHeader
+{
+	const uint8_t *data;		// start of the file
+	size_t size;				// less than requested for short files.
+	long filelength;
+	const char *ext;			// lower case, without the dot. Empty if there's no file name.
+	MusicIO::FileInterface *reader;	// for probes that need to look elsewhere in the file. They must not change the position.
+	struct CachedSong *cache;	// the song cache's entry for this file, if it is enabled.
+};
+
+int MOD_Probe(const SongHeader &header);
+bool MOD_IsPreferred(const SongHeader &header);
+int XMP_Probe(const SongHeader &header);
+int GME_Probe(const SongHeader &header);
+int SndFile_Probe(const SongHeader &header);
+int XA_Probe(const SongHeader &header);
+int OPL_Probe(const SongHeader &header);
+const char *GME_Format(const SongHeader &header);
+
+StreamSource *MOD_OpenSong(MusicIO::FileInterface* reader, int samplerate, struct CachedSong *cache);
 StreamSource *XMP_OpenSong(MusicIO::FileInterface* reader, int samplerate);
 StreamSource* GME_OpenSong(MusicIO::FileInterface* reader, const char* fmt, int sample_rate);
 StreamSource *SndFile_OpenSong(MusicIO::FileInterface* fr);
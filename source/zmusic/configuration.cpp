@@ -43,6 +43,7 @@
 #include "zmusic_internal.h"
 #include "musinfo.h"
 #include "midiconfig.h"
+#include "songcache.h"
 #include "mididevices/music_alsa_state.h"
 
 #ifdef __APPLE__
@@ -68,8 +69,9 @@ struct Dummy
 #define devType() ((currSong)? (currSong)->GetDeviceType() : MDEV_DEFAULT)
 
 
-MiscConfig miscConfig;
 ZMusicCallbacks musicCallbacks;
+ZMusicContext defaultContext;
+thread_local ZMusicContext *currentContext = &defaultContext;
 
 class SoundFontWrapperInterface : public MusicIO::SoundFontReaderInterface
 {
@@ -144,28 +146,28 @@ DLL_EXPORT void ZMusic_SetCallbacks(const ZMusicCallbacks* cb)
 DLL_EXPORT void ZMusic_SetGenMidi(const uint8_t* data)
 {
 #ifdef HAVE_OPL
-	memcpy(oplConfig.OPLinstruments, data, 175 * 36);
-	oplConfig.genmidiset = true;
+	memcpy(currentContext->oplConfig.OPLinstruments, data, 175 * 36);
+	currentContext->oplConfig.genmidiset = true;
 #endif
 #ifdef HAVE_ADL
-	memcpy(adlConfig.adl_genmidi_bank, data, 175 * 36);
-	adlConfig.adl_genmidi_set = true;
+	memcpy(currentContext->adlConfig.adl_genmidi_bank, data, 175 * 36);
+	currentContext->adlConfig.adl_genmidi_set = true;
 #endif
 }
 
 DLL_EXPORT void ZMusic_SetWgOpn(const void* data, unsigned len)
 {
 #ifdef HAVE_OPN
-	opnConfig.default_bank.resize(len);
-	memcpy(opnConfig.default_bank.data(), data, len);
+	currentContext->opnConfig.default_bank.resize(len);
+	memcpy(currentContext->opnConfig.default_bank.data(), data, len);
 #endif
 }
 
 DLL_EXPORT void ZMusic_SetDmxGus(const void* data, unsigned len)
 {
 #ifdef HAVE_GUS
-	gusConfig.dmxgus.resize(len);
-	memcpy(gusConfig.dmxgus.data(), data, len);
+	currentContext->gusConfig.dmxgus.resize(len);
+	memcpy(currentContext->gusConfig.dmxgus.data(), data, len);
 #endif
 }
 
@@ -358,7 +360,7 @@ static void TimidityPlus_SetReverb()
 //
 //==========================================================================
 
-DLL_EXPORT zmusic_bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSong, int value, int *pRealValue)
+static bool ChangeSettingInt(EIntConfigKey key, MusInfo *currSong, int value, int *pRealValue)
 {
 	switch (key)
 	{
@@ -369,101 +371,91 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSon
 		case zmusic_adl_chips_count: 
 			if (currSong != NULL && devType() == MDEV_ADL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libadl.numchips", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libadl.numchips", value); });
 			}
 
-			ChangeAndReturn(adlConfig.adl_chips_count, value, pRealValue);
+			ChangeAndReturn(currentContext->adlConfig.adl_chips_count, value, pRealValue);
 			return false;
 
 		case zmusic_adl_emulator_id: 
 			if (currSong != NULL && devType() == MDEV_ADL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libadl.emulator", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libadl.emulator", value); });
 			}
 
-			ChangeAndReturn(adlConfig.adl_emulator_id, value, pRealValue);
+			ChangeAndReturn(currentContext->adlConfig.adl_emulator_id, value, pRealValue);
 			return false;
 
 		case zmusic_adl_run_at_pcm_rate:
 			if (currSong != NULL && devType() == MDEV_ADL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libadl.runatpcmrate", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libadl.runatpcmrate", value); });
 			}
 
-			ChangeAndReturn(adlConfig.adl_run_at_pcm_rate, value, pRealValue);
+			ChangeAndReturn(currentContext->adlConfig.adl_run_at_pcm_rate, value, pRealValue);
 			return false;
 
 		case zmusic_adl_fullpan: 
 			if (currSong != NULL && devType() == MDEV_ADL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libadl.fullpan", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libadl.fullpan", value); });
 			}
 
-			ChangeAndReturn(adlConfig.adl_fullpan, value, pRealValue);
+			ChangeAndReturn(currentContext->adlConfig.adl_fullpan, value, pRealValue);
 			return false;
 
 		case zmusic_adl_bank: 
 			if (currSong != NULL && devType() == MDEV_ADL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libadl.banknum", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libadl.banknum", value); });
 			}
 
-			ChangeAndReturn(adlConfig.adl_bank, value, pRealValue);
+			ChangeAndReturn(currentContext->adlConfig.adl_bank, value, pRealValue);
 			return false;
 
 		case zmusic_adl_use_custom_bank: 
 			if (currSong != NULL && devType() == MDEV_ADL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libadl.usecustombank", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libadl.usecustombank", value); });
 			}
 
-			ChangeAndReturn(adlConfig.adl_use_custom_bank, value, pRealValue);
+			ChangeAndReturn(currentContext->adlConfig.adl_use_custom_bank, value, pRealValue);
 			return false;
 
 		case zmusic_adl_use_genmidi:
 			if (currSong != NULL && devType() == MDEV_ADL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libadl.usegenmidi", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libadl.usegenmidi", value); });
 			}
 
-			ChangeAndReturn(adlConfig.adl_use_genmidi, value, pRealValue);
+			ChangeAndReturn(currentContext->adlConfig.adl_use_genmidi, value, pRealValue);
 			return false;
 
 		case zmusic_adl_volume_model: 
 			if (currSong != NULL && devType() == MDEV_ADL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libadl.volumemodel", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libadl.volumemodel", value); });
 			}
 
-			ChangeAndReturn(adlConfig.adl_volume_model, value, pRealValue);
+			ChangeAndReturn(currentContext->adlConfig.adl_volume_model, value, pRealValue);
 			return false;
 
 		case zmusic_adl_chan_alloc:
 			if (currSong != NULL && devType() == MDEV_ADL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libadl.chanalloc", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libadl.chanalloc", value); });
 			}
 
-			ChangeAndReturn(adlConfig.adl_chan_alloc, value, pRealValue);
+			ChangeAndReturn(currentContext->adlConfig.adl_chan_alloc, value, pRealValue);
 			return false;
 
 		case zmusic_adl_auto_arpeggio:
 			if (currSong != NULL && devType() == MDEV_ADL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libadl.autoarpeggio", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libadl.autoarpeggio", value); });
 			}
 
-			ChangeAndReturn(adlConfig.adl_auto_arpeggio, value, pRealValue);
+			ChangeAndReturn(currentContext->adlConfig.adl_auto_arpeggio, value, pRealValue);
 			return false;
 #endif
 
@@ -471,14 +463,14 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSon
 			if (currSong != NULL)
 				currSong->ChangeSettingInt("fluidsynth.synth.reverb.active", value);
 
-			ChangeAndReturn(fluidConfig.fluid_reverb, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_reverb, value, pRealValue);
 			return false;
 
 		case zmusic_fluid_chorus: 
 			if (currSong != NULL)
 				currSong->ChangeSettingInt("fluidsynth.synth.chorus.active", value);
 
-			ChangeAndReturn(fluidConfig.fluid_chorus, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_chorus, value, pRealValue);
 			return false;
 
 		case zmusic_fluid_voices: 
@@ -490,7 +482,7 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSon
 			if (currSong != NULL)
 				currSong->ChangeSettingInt("fluidsynth.synth.polyphony", value);
 
-			ChangeAndReturn(fluidConfig.fluid_voices, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_voices, value, pRealValue);
 			return false;
 			
 		case zmusic_fluid_interp:
@@ -512,12 +504,12 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSon
 			if (currSong != NULL)
 				currSong->ChangeSettingInt("fluidsynth.synth.interpolation", value);
 
-			ChangeAndReturn(fluidConfig.fluid_interp, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_interp, value, pRealValue);
 			return false;
 
 		case zmusic_fluid_samplerate:
 			// This will only take effect for the next song. (Q: Is this even needed?)
-			ChangeAndReturn(fluidConfig.fluid_samplerate, std::max<int>(value, 0), pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_samplerate, std::max<int>(value, 0), pRealValue);
 			return false;
 
 		// I don't know if this setting even matters for us, since we aren't letting
@@ -528,7 +520,7 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSon
 			else if (value > 256)
 				value = 256;
 
-			ChangeAndReturn(fluidConfig.fluid_threads, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_threads, value, pRealValue);
 			return false;
 			
 		case zmusic_fluid_chorus_voices:
@@ -540,7 +532,7 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSon
 			if (currSong != NULL)
 				currSong->ChangeSettingNum("fluidsynth.z.chorus", value);
 
-			ChangeAndReturn(fluidConfig.fluid_chorus_voices, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_chorus_voices, value, pRealValue);
 			return false;
 			
 		case zmusic_fluid_chorus_type:
@@ -550,7 +542,7 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSon
 			if (currSong != NULL)
 				currSong->ChangeSettingNum("fluidsynth.z.chorus", value); // Uses float to simplify the checking code in the renderer.
 
-			ChangeAndReturn(fluidConfig.fluid_chorus_type, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_chorus_type, value, pRealValue);
 			return false;
 			
 #ifdef HAVE_OPL
@@ -563,111 +555,109 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSon
 			if (currSong != NULL && devType() == MDEV_OPL)
 				currSong->ChangeSettingInt("opl.numchips", value);
 
-			ChangeAndReturn(oplConfig.numchips, value, pRealValue);
+			ChangeAndReturn(currentContext->oplConfig.numchips, value, pRealValue);
 			return false;
 
 		case zmusic_opl_core:
 			if (value < 0) value = 0;
 			else if (value > 3) value = 3;
-			ChangeAndReturn(oplConfig.core, value, pRealValue);
+			ChangeAndReturn(currentContext->oplConfig.core, value, pRealValue);
 			return devType() == MDEV_OPL;
 
 		case zmusic_opl_fullpan:
-			ChangeAndReturn(oplConfig.fullpan, value, pRealValue);
+			ChangeAndReturn(currentContext->oplConfig.fullpan, value, pRealValue);
 			return false;
+
+		case zmusic_opl_resample:
+			if (value < 0) value = 0;
+			else if (value > 3) value = 3;
+			ChangeAndReturn(currentContext->oplConfig.resample, value, pRealValue);
+			return devType() == MDEV_OPL;
 #endif
 #ifdef HAVE_OPN
 		case zmusic_opn_chips_count:
 			if (currSong != NULL && devType() == MDEV_OPN)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libopn.numchips", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libopn.numchips", value); });
 			}
 
-			ChangeAndReturn(opnConfig.opn_chips_count, value, pRealValue);
+			ChangeAndReturn(currentContext->opnConfig.opn_chips_count, value, pRealValue);
 			return false;
 
 		case zmusic_opn_emulator_id:
 			if (currSong != NULL && devType() == MDEV_OPN)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libopn.emulator", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libopn.emulator", value); });
 			}
 
-			ChangeAndReturn(opnConfig.opn_emulator_id, value, pRealValue);
+			ChangeAndReturn(currentContext->opnConfig.opn_emulator_id, value, pRealValue);
 			return false;
 
 		case zmusic_opn_run_at_pcm_rate:
 			if (currSong != NULL && devType() == MDEV_OPN)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libopn.runatpcmrate", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libopn.runatpcmrate", value); });
 			}
 
-			ChangeAndReturn(opnConfig.opn_run_at_pcm_rate, value, pRealValue);
+			ChangeAndReturn(currentContext->opnConfig.opn_run_at_pcm_rate, value, pRealValue);
 			return false;
 
 		case zmusic_opn_fullpan:
 			if (currSong != NULL && devType() == MDEV_OPN)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libopn.fullpan", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libopn.fullpan", value); });
 			}
 
-			ChangeAndReturn(opnConfig.opn_fullpan, value, pRealValue);
+			ChangeAndReturn(currentContext->opnConfig.opn_fullpan, value, pRealValue);
 			return false;
 
 		case zmusic_opn_use_custom_bank:
 			if (currSong != NULL && devType() == MDEV_OPN)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libopn.usecustombank", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libopn.usecustombank", value); });
 			}
 
-			ChangeAndReturn(opnConfig.opn_use_custom_bank, value, pRealValue);
+			ChangeAndReturn(currentContext->opnConfig.opn_use_custom_bank, value, pRealValue);
 			return false;
 
 		case zmusic_opn_volume_model:
 			if (currSong != NULL && devType() == MDEV_OPN)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libopn.volumemodel", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libopn.volumemodel", value); });
 			}
 
-			ChangeAndReturn(opnConfig.opn_volume_model, value, pRealValue);
+			ChangeAndReturn(currentContext->opnConfig.opn_volume_model, value, pRealValue);
 			return false;
 
 		case zmusic_opn_chan_alloc:
 			if (currSong != NULL && devType() == MDEV_OPN)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libopn.chanalloc", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libopn.chanalloc", value); });
 			}
 
-			ChangeAndReturn(opnConfig.opn_chan_alloc, value, pRealValue);
+			ChangeAndReturn(currentContext->opnConfig.opn_chan_alloc, value, pRealValue);
 			return false;
 
 		case zmusic_opn_auto_arpeggio:
 			if (currSong != NULL && devType() == MDEV_OPN)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingInt("libopn.autoarpeggio", value);
+				currSong->Post([=] { currSong->ChangeSettingInt("libopn.autoarpeggio", value); });
 			}
 
-			ChangeAndReturn(opnConfig.opn_auto_arpeggio, value, pRealValue);
+			ChangeAndReturn(currentContext->opnConfig.opn_auto_arpeggio, value, pRealValue);
 			return false;
 #endif
 #ifdef HAVE_GUS
 		case zmusic_gus_dmxgus:
-			ChangeAndReturn(gusConfig.gus_dmxgus, value, pRealValue);
+			ChangeAndReturn(currentContext->gusConfig.gus_dmxgus, value, pRealValue);
 			return devType() == MDEV_GUS;
 
 		case zmusic_gus_midi_voices:
-			ChangeAndReturn(gusConfig.midi_voices, value, pRealValue);
+			ChangeAndReturn(currentContext->gusConfig.midi_voices, value, pRealValue);
 			return devType() == MDEV_GUS;
 		
 		case zmusic_gus_memsize:
-			ChangeAndReturn(gusConfig.gus_memsize, value, pRealValue);
+			ChangeAndReturn(currentContext->gusConfig.gus_memsize, value, pRealValue);
 			return devType() == MDEV_GUS;
 #endif
 #ifdef HAVE_TIMIDITY
@@ -751,19 +741,19 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSon
 		case zmusic_wildmidi_reverb:
 			if (currSong != NULL)
 				currSong->ChangeSettingInt("wildmidi.reverb", value);
-			wildMidiConfig.reverb = value;
+			currentContext->wildMidiConfig.reverb = value;
 			if (pRealValue) *pRealValue = value;
 			return false;
 
 		case zmusic_wildmidi_enhanced_resampling:
 			if (currSong != NULL)
 				currSong->ChangeSettingInt("wildmidi.resampling", value);
-			wildMidiConfig.enhanced_resampling = value;
+			currentContext->wildMidiConfig.enhanced_resampling = value;
 			if (pRealValue) *pRealValue = value;
 			return false;
 #endif
 		case zmusic_snd_midiprecache:
-			ChangeAndReturn(miscConfig.snd_midiprecache, value, pRealValue);
+			ChangeAndReturn(currentContext->miscConfig.snd_midiprecache, value, pRealValue);
 			return false;
 
 		case zmusic_snd_streambuffersize:
@@ -775,57 +765,90 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSon
 			{
 				value = 1024;
 			}
-			ChangeAndReturn(miscConfig.snd_streambuffersize, value, pRealValue);
+			ChangeAndReturn(currentContext->miscConfig.snd_streambuffersize, value, pRealValue);
 			return false;
 
 		case zmusic_mod_samplerate:
-			ChangeAndReturn(dumbConfig.mod_samplerate, value, pRealValue);
+			ChangeAndReturn(currentContext->dumbConfig.mod_samplerate, value, pRealValue);
 			return false;
 
 		case zmusic_mod_volramp:
-			ChangeAndReturn(dumbConfig.mod_volramp, value, pRealValue);
+			ChangeAndReturn(currentContext->dumbConfig.mod_volramp, value, pRealValue);
 			return false;
 
 		case zmusic_mod_interp:
-			ChangeAndReturn(dumbConfig.mod_interp, value, pRealValue);
+			ChangeAndReturn(currentContext->dumbConfig.mod_interp, value, pRealValue);
 			return false;
 
 		case zmusic_mod_autochip:
-			ChangeAndReturn(dumbConfig.mod_autochip, value, pRealValue);
+			ChangeAndReturn(currentContext->dumbConfig.mod_autochip, value, pRealValue);
 			return false;
 
 		case zmusic_mod_autochip_size_force:
-			ChangeAndReturn(dumbConfig.mod_autochip_size_force, value, pRealValue);
+			ChangeAndReturn(currentContext->dumbConfig.mod_autochip_size_force, value, pRealValue);
 			return false;
 
 		case zmusic_mod_autochip_size_scan:
-			ChangeAndReturn(dumbConfig.mod_autochip_size_scan, value, pRealValue);
+			ChangeAndReturn(currentContext->dumbConfig.mod_autochip_size_scan, value, pRealValue);
 			return false;
 
 		case zmusic_mod_autochip_scan_threshold:
-			ChangeAndReturn(dumbConfig.mod_autochip_scan_threshold, value, pRealValue);
+			ChangeAndReturn(currentContext->dumbConfig.mod_autochip_scan_threshold, value, pRealValue);
 			return false;
 
 		case zmusic_snd_mididevice:
 		{
-			bool change = miscConfig.snd_mididevice != value;
-			miscConfig.snd_mididevice = value;
+			bool change = currentContext->miscConfig.snd_mididevice != value;
+			currentContext->miscConfig.snd_mididevice = value;
 			return change;
 		}
 
 		case zmusic_snd_outputrate:
-			miscConfig.snd_outputrate = value;
+			currentContext->miscConfig.snd_outputrate = value;
 			return false;
 
 		case zmusic_mod_preferredplayer:
-			dumbConfig.mod_preferred_player = value;
+			currentContext->dumbConfig.mod_preferred_player = value;
+			return false;
+
+		case zmusic_snd_resampler_quality:
+			if (value < 0) value = 0;
+			else if (value > 3) value = 3;
+			ChangeAndReturn(currentContext->miscConfig.snd_resampler_quality, value, pRealValue);
+			return true;
+
+		case zmusic_snd_softclip:
+			ChangeAndReturn(currentContext->miscConfig.snd_softclip, value, pRealValue);
+			return false;
+
+		case zmusic_snd_midiquantum:
+			if (value < 0) value = 0;
+			else if (value > 4096) value = 4096;
+			ChangeAndReturn(currentContext->miscConfig.snd_midiquantum, value, pRealValue);
+			return false;
+
+		case zmusic_snd_midisplit:
+			if (value < 0) value = 0;
+			else if (value > 16) value = 16;
+			ChangeAndReturn(currentContext->miscConfig.snd_midisplit, value, pRealValue);
+			return false;
+
+		case zmusic_snd_wavebits:
+			if (value != 16 && value != 24) value = 32;
+			ChangeAndReturn(currentContext->miscConfig.snd_wavebits, value, pRealValue);
+			return false;
+
+		case zmusic_snd_songcache:
+			if (value < 0) value = 0;
+			SongCache::SetBudget(size_t(value) * 1024);
+			if (pRealValue) *pRealValue = value;
 			return false;
 
 	}
 	return false;
 }
 
-DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* currSong, float value, float *pRealValue)
+static bool ChangeSettingFloat(EFloatConfigKey key, MusInfo* currSong, float value, float *pRealValue)
 {
 	switch (key)
 	{
@@ -841,7 +864,7 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* cur
 			if (currSong != NULL)
 				currSong->ChangeSettingNum("fluidsynth.synth.gain", value);
 		
-			ChangeAndReturn(fluidConfig.fluid_gain, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_gain, value, pRealValue);
 			return false;
 
 		case zmusic_fluid_reverb_roomsize:
@@ -853,7 +876,7 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* cur
 			if (currSong != NULL)
 				currSong->ChangeSettingNum("fluidsynth.z.reverb", value);
 
-			ChangeAndReturn(fluidConfig.fluid_reverb_roomsize, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_reverb_roomsize, value, pRealValue);
 			return false;
 
 		case zmusic_fluid_reverb_damping:
@@ -865,7 +888,7 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* cur
 			if (currSong != NULL)
 				currSong->ChangeSettingNum("fluidsynth.z.reverb", value);
 
-			ChangeAndReturn(fluidConfig.fluid_reverb_damping, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_reverb_damping, value, pRealValue);
 			return false;
 
 		case zmusic_fluid_reverb_width:
@@ -877,7 +900,7 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* cur
 			if (currSong != NULL)
 				currSong->ChangeSettingNum("fluidsynth.z.reverb", value);
 
-			ChangeAndReturn(fluidConfig.fluid_reverb_width, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_reverb_width, value, pRealValue);
 			return false;
 
 		case zmusic_fluid_reverb_level:
@@ -889,7 +912,7 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* cur
 			if (currSong != NULL)
 				currSong->ChangeSettingNum("fluidsynth.z.reverb", value);
 
-			ChangeAndReturn(fluidConfig.fluid_reverb_level, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_reverb_level, value, pRealValue);
 			return false;
 
 		case zmusic_fluid_chorus_level:
@@ -901,7 +924,7 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* cur
 			if (currSong != NULL)
 				currSong->ChangeSettingNum("fluidsynth.z.chorus", value);
 
-			ChangeAndReturn(fluidConfig.fluid_chorus_level, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_chorus_level, value, pRealValue);
 			return false;
 
 		case zmusic_fluid_chorus_speed:
@@ -913,7 +936,7 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* cur
 			if (currSong != NULL)
 				currSong->ChangeSettingNum("fluidsynth.z.chorus", value);
 
-			ChangeAndReturn(fluidConfig.fluid_chorus_speed, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_chorus_speed, value, pRealValue);
 			return false;
 
 		// depth is in ms and actual maximum depends on the sample rate
@@ -926,7 +949,7 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* cur
 			if (currSong != NULL)
 				currSong->ChangeSettingNum("fluidsynth.z.chorus", value);
 
-			ChangeAndReturn(fluidConfig.fluid_chorus_depth, value, pRealValue);
+			ChangeAndReturn(currentContext->fluidConfig.fluid_chorus_depth, value, pRealValue);
 			return false;
 
 #ifdef HAVE_TIMIDITY
@@ -960,11 +983,10 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* cur
 
 			if (currSong != NULL && devType() == MDEV_OPL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingNum("oplemu.gain", value);
+				currSong->Post([=] { currSong->ChangeSettingNum("oplemu.gain", value); });
 			}
 
-			ChangeAndReturn(oplConfig.gain, value, pRealValue);
+			ChangeAndReturn(currentContext->oplConfig.gain, value, pRealValue);
 			return false;
 #endif
 #ifdef HAVE_ADL
@@ -976,11 +998,10 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* cur
 
 			if (currSong != NULL && devType() == MDEV_ADL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingNum("libadl.gain", value);
+				currSong->Post([=] { currSong->ChangeSettingNum("libadl.gain", value); });
 			}
 
-			ChangeAndReturn(adlConfig.adl_gain, value, pRealValue);
+			ChangeAndReturn(currentContext->adlConfig.adl_gain, value, pRealValue);
 			return false;
 #endif
 
@@ -993,42 +1014,46 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* cur
 
 			if (currSong != NULL && devType() == MDEV_OPN)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
-				currSong->ChangeSettingNum("libopn.gain", value);
+				currSong->Post([=] { currSong->ChangeSettingNum("libopn.gain", value); });
 			}
 
-			ChangeAndReturn(opnConfig.opn_gain, value, pRealValue);
+			ChangeAndReturn(currentContext->opnConfig.opn_gain, value, pRealValue);
 			return false;
 #endif
 
 		case zmusic_gme_stereodepth:
 			if (currSong != nullptr)
 				currSong->ChangeSettingNum("GME.stereodepth", value);
-			ChangeAndReturn(miscConfig.gme_stereodepth, value, pRealValue);
+			ChangeAndReturn(currentContext->miscConfig.gme_stereodepth, value, pRealValue);
+			return false;
+
+		case zmusic_snd_fmrealtime:
+			if (value < 0.5f) value = 0.5f;
+			ChangeAndReturn(currentContext->miscConfig.snd_fmrealtime, value, pRealValue);
 			return false;
 
 		case zmusic_mod_dumb_mastervolume:
 			if (value < 0) value = 0;
-			ChangeAndReturn(dumbConfig.mod_dumb_mastervolume, value, pRealValue);
+			ChangeAndReturn(currentContext->dumbConfig.mod_dumb_mastervolume, value, pRealValue);
 			return false;
 
 		case zmusic_snd_musicvolume:
-			miscConfig.snd_musicvolume = value;
+			currentContext->miscConfig.snd_musicvolume = value;
 			return false;
 
 		case zmusic_relative_volume:
-			miscConfig.relative_volume = value;
+			currentContext->miscConfig.relative_volume = value;
 			return false;
 
 		case zmusic_snd_mastervolume:
-			miscConfig.snd_mastervolume = value;
+			currentContext->miscConfig.snd_mastervolume = value;
 			return false;
 
 	}
 	return false;
 }
 
-DLL_EXPORT zmusic_bool ChangeMusicSettingString(EStringConfigKey key, MusInfo* currSong, const char *value)
+static bool ChangeSettingString(EStringConfigKey key, MusInfo* currSong, const char *value)
 {
 	switch (key)
 	{
@@ -1039,7 +1064,6 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingString(EStringConfigKey key, MusInfo* c
 		case zmusic_adl_custom_bank: 
 			if (currSong != nullptr && devType() == MDEV_ADL)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
 				const char* info;
 				if (musicCallbacks.PathForSoundfont)
 				{
@@ -1055,20 +1079,21 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingString(EStringConfigKey key, MusInfo* c
 					info = "";
 				}
 
-				currSong->ChangeSettingString("libadl.custombank", info);
+				std::string bank = info;
+				currSong->Post([=] { currSong->ChangeSettingString("libadl.custombank", bank.c_str()); });
 			}
 
-			adlConfig.adl_custom_bank = value;
+			currentContext->adlConfig.adl_custom_bank = value;
 			return false;
 #endif
 		case zmusic_fluid_lib: 
-			fluidConfig.fluid_lib = value;
+			currentContext->fluidConfig.fluid_lib = value;
 			return false; // only takes effect for next song.
 
 		case zmusic_fluid_patchset: 
-			fluidConfig.fluid_patchset = value;
+			currentContext->fluidConfig.fluid_patchset = value;
 #ifdef HAVE_TIMIDITY
-			if (timidityConfig.timidity_config.empty()) timidityConfig.timidity_config = value; // Also use for Timidity++ if nothing has been set.
+			if (currentContext->timidityConfig.timidity_config.empty()) currentContext->timidityConfig.timidity_config = value; // Also use for Timidity++ if nothing has been set.
 #endif
 			return devType() == MDEV_FLUIDSYNTH;
 
@@ -1076,7 +1101,6 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingString(EStringConfigKey key, MusInfo* c
 		case zmusic_opn_custom_bank: 
 			if (currSong != nullptr && devType() == MDEV_OPN)
 			{
-				std::lock_guard<FCriticalSection> lock(currSong->CritSec);
 				const char* info;
 				if (musicCallbacks.PathForSoundfont)
 				{
@@ -1092,30 +1116,31 @@ DLL_EXPORT zmusic_bool ChangeMusicSettingString(EStringConfigKey key, MusInfo* c
 					info = "";
 				}
 
-				currSong->ChangeSettingString("libopn.custombank", info);
+				std::string bank = info;
+				currSong->Post([=] { currSong->ChangeSettingString("libopn.custombank", bank.c_str()); });
 			}
 
-			opnConfig.opn_custom_bank = value;
+			currentContext->opnConfig.opn_custom_bank = value;
 			return false;
 #endif
 #ifdef HAVE_GUS
 		case zmusic_gus_config:
-			gusConfig.gus_config = value;
+			currentContext->gusConfig.gus_config = value;
 			return devType() == MDEV_GUS;
 #endif
 #ifdef HAVE_GUS
 		case zmusic_gus_patchdir:
-			gusConfig.gus_patchdir = value;
-			return devType() == MDEV_GUS && gusConfig.gus_dmxgus;
+			currentContext->gusConfig.gus_patchdir = value;
+			return devType() == MDEV_GUS && currentContext->gusConfig.gus_dmxgus;
 #endif
 #ifdef HAVE_TIMIDITY
 		case zmusic_timidity_config:
-			timidityConfig.timidity_config = value;
+			currentContext->timidityConfig.timidity_config = value;
 			return devType() == MDEV_TIMIDITY;
 #endif
 #ifdef HAVE_WILDMIDI
 		case zmusic_wildmidi_config:
-			wildMidiConfig.config = value;
+			currentContext->wildMidiConfig.config = value;
 			return devType() == MDEV_WILDMIDI;
 #endif
 	}
@@ -1155,6 +1180,7 @@ static ZMusicConfigurationSetting config[] = {
 	{"zmusic_opl_numchips", zmusic_opl_numchips, ZMUSIC_VAR_INT, 2},
 	{"zmusic_opl_core", zmusic_opl_core, ZMUSIC_VAR_INT, 0},
 	{"zmusic_opl_fullpan", zmusic_opl_fullpan, ZMUSIC_VAR_BOOL, 1},
+	{"zmusic_opl_resample", zmusic_opl_resample, ZMUSIC_VAR_INT, 0},
 #endif
 #ifdef HAVE_OPN
 	{"zmusic_opn_chips_count", zmusic_opn_chips_count, ZMUSIC_VAR_INT, 8},
@@ -1213,6 +1239,13 @@ static ZMusicConfigurationSetting config[] = {
 	{"zmusic_snd_streambuffersize", zmusic_snd_streambuffersize, ZMUSIC_VAR_INT, 64},
 	{"zmusic_snd_mididevice", zmusic_snd_mididevice, ZMUSIC_VAR_INT, 0},
 	{"zmusic_snd_outputrate", zmusic_snd_outputrate, ZMUSIC_VAR_INT, 44100},
+	{"zmusic_snd_resampler_quality", zmusic_snd_resampler_quality, ZMUSIC_VAR_INT, 0},
+	{"zmusic_snd_softclip", zmusic_snd_softclip, ZMUSIC_VAR_BOOL, 0},
+	{"zmusic_snd_songcache", zmusic_snd_songcache, ZMUSIC_VAR_INT, 0},
+	{"zmusic_snd_midiquantum", zmusic_snd_midiquantum, ZMUSIC_VAR_INT, 0},
+	{"zmusic_snd_midisplit", zmusic_snd_midisplit, ZMUSIC_VAR_INT, 0},
+	{"zmusic_snd_wavebits", zmusic_snd_wavebits, ZMUSIC_VAR_INT, 32},
+	{"zmusic_snd_fmrealtime", zmusic_snd_fmrealtime, ZMUSIC_VAR_FLOAT, 4},
 	{"zmusic_snd_musicvolume", zmusic_snd_musicvolume, ZMUSIC_VAR_FLOAT, 1},
 	{"zmusic_relative_volume", zmusic_relative_volume, ZMUSIC_VAR_FLOAT, 1},
 	{"zmusic_snd_mastervolume", zmusic_snd_mastervolume, ZMUSIC_VAR_FLOAT, 1},
@@ -1223,3 +1256,75 @@ DLL_EXPORT const ZMusicConfigurationSetting* ZMusic_GetConfiguration()
 {
 	return config;
 }
+
+//==========================================================================
+//
+// Settings always go to the context the song belongs to.
+// Without a song the calling thread's current context is changed.
+//
+//==========================================================================
+
+DLL_EXPORT zmusic_bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSong, int value, int *pRealValue)
+{
+	ZMusicContextScope scope(currSong ? currSong->Context : currentContext);
+	return ChangeSettingInt(key, currSong, value, pRealValue);
+}
+
+DLL_EXPORT zmusic_bool ChangeMusicSettingFloat(EFloatConfigKey key, MusInfo* currSong, float value, float *pRealValue)
+{
+	ZMusicContextScope scope(currSong ? currSong->Context : currentContext);
+	return ChangeSettingFloat(key, currSong, value, pRealValue);
+}
+
+DLL_EXPORT zmusic_bool ChangeMusicSettingString(EStringConfigKey key, MusInfo* currSong, const char *value)
+{
+	ZMusicContextScope scope(currSong ? currSong->Context : currentContext);
+	return ChangeSettingString(key, currSong, value);
+}
+
+DLL_EXPORT zmusic_bool ChangeMusicSettingIntCtx(ZMusicContext *ctx, EIntConfigKey key, MusInfo *currSong, int value, int *pRealValue)
+{
+	ZMusicContextScope scope(ctx ? ctx : &defaultContext);
+	return ChangeSettingInt(key, currSong, value, pRealValue);
+}
+
+DLL_EXPORT zmusic_bool ChangeMusicSettingFloatCtx(ZMusicContext *ctx, EFloatConfigKey key, MusInfo* currSong, float value, float *pRealValue)
+{
+	ZMusicContextScope scope(ctx ? ctx : &defaultContext);
+	return ChangeSettingFloat(key, currSong, value, pRealValue);
+}
+
+DLL_EXPORT zmusic_bool ChangeMusicSettingStringCtx(ZMusicContext *ctx, EStringConfigKey key, MusInfo* currSong, const char *value)
+{
+	ZMusicContextScope scope(ctx ? ctx : &defaultContext);
+	return ChangeSettingString(key, currSong, value);
+}
+
+//==========================================================================
+//
+// Contexts
+//
+// A new context starts with the default settings but inherits the
+// instrument data the client has set for the default context.
+//
+//==========================================================================
+
+DLL_EXPORT ZMusicContext *ZMusic_CreateContext()
+{
+	auto ctx = new ZMusicContext;
+	auto &def = defaultContext;
+	memcpy(ctx->oplConfig.OPLinstruments, def.oplConfig.OPLinstruments, sizeof(def.oplConfig.OPLinstruments));
+	ctx->oplConfig.genmidiset = def.oplConfig.genmidiset;
+	memcpy(ctx->adlConfig.adl_genmidi_bank, def.adlConfig.adl_genmidi_bank, sizeof(def.adlConfig.adl_genmidi_bank));
+	ctx->adlConfig.adl_genmidi_set = def.adlConfig.adl_genmidi_set;
+	ctx->opnConfig.default_bank = def.opnConfig.default_bank;
+	ctx->gusConfig.dmxgus = def.gusConfig.dmxgus;
+	return ctx;
+}
+
+DLL_EXPORT void ZMusic_DestroyContext(ZMusicContext *ctx)
+{
+	if (ctx == nullptr || ctx == &defaultContext) return;
+	if (currentContext == ctx) currentContext = &defaultContext;
+	delete ctx;
+}
@@ -59,13 +59,10 @@ public:
 	{
 		LeaveCriticalSection(&CritSec);
 	}
-#if 0
-	// SDL has no equivalent functionality, so better not use it on Windows.
 	bool TryEnter()
 	{
 		return TryEnterCriticalSection(&CritSec) != 0;
 	}
-#endif
 private:
 	CRITICAL_SECTION CritSec;
 };
@@ -91,6 +88,11 @@ void LeaveCriticalSection(FInternalCriticalSection *c)
 	c->Leave();
 }
 
+bool TryEnterCriticalSection(FInternalCriticalSection *c)
+{
+	return c->TryEnter();
+}
+
 #else
 
 #include "critsec.h"
@@ -105,6 +107,7 @@ public:
 
 	void Enter();
 	void Leave();
+	bool TryEnter();
 
 private:
 	pthread_mutex_t m_mutex;
@@ -139,6 +142,11 @@ void FInternalCriticalSection::Leave()
 	pthread_mutex_unlock(&m_mutex);
 }
 
+bool FInternalCriticalSection::TryEnter()
+{
+	return pthread_mutex_trylock(&m_mutex) == 0;
+}
+
 
 FInternalCriticalSection *CreateCriticalSection()
 {
@@ -158,6 +166,11 @@ void EnterCriticalSection(FInternalCriticalSection *c)
 void LeaveCriticalSection(FInternalCriticalSection *c)
 {
 	c->Leave();
-} 
+}
+
+bool TryEnterCriticalSection(FInternalCriticalSection *c)
+{
+	return c->TryEnter();
+}
 
 #endif
\ No newline at end of file
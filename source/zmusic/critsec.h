@@ -6,6 +6,7 @@ FInternalCriticalSection *CreateCriticalSection();
 void DeleteCriticalSection(FInternalCriticalSection *c);
 void EnterCriticalSection(FInternalCriticalSection *c);
 void LeaveCriticalSection(FInternalCriticalSection *c);
+bool TryEnterCriticalSection(FInternalCriticalSection *c);
 
 // This is just a convenience wrapper around the function interface adjusted to use std::lock_guard
 class FCriticalSection
@@ -31,6 +32,11 @@ public:
 		LeaveCriticalSection(c);
 	}
 
+	bool try_lock()
+	{
+		return TryEnterCriticalSection(c);
+	}
+
 private:
 	FInternalCriticalSection *c;
 
@@ -0,0 +1,116 @@
+/*
+** fileio.cpp
+** Memory mapped file access
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
+#include "fileio.h"
+
+namespace MusicIO
+{
+
+//==========================================================================
+//
+// MappedFileReader :: Open
+//
+// Maps the entire file. Fails for anything that is not a regular file
+// with some content, which the caller must then read the normal way.
+// The FILE stays open and still belongs to the caller.
+//
+//==========================================================================
+
+MappedFileReader *MappedFileReader::Open(FILE *f)
+{
+	long pos = ftell(f);
+	if (pos < 0 || fseek(f, 0, SEEK_END) != 0) return nullptr;
+	long length = ftell(f);
+	fseek(f, pos, SEEK_SET);
+	if (length <= 0) return nullptr;
+
+#ifdef _WIN32
+	HANDLE mapping = CreateFileMappingW((HANDLE)_get_osfhandle(_fileno(f)), nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) return nullptr;
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);	// the view keeps the mapping alive.
+	if (view == nullptr) return nullptr;
+#else
+	void *view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+	if (view == MAP_FAILED) return nullptr;
+#endif
+	auto reader = new MappedFileReader((const uint8_t *)view, length);
+	reader->mPos = pos;
+	return reader;
+}
+
+//==========================================================================
+//
+// MappedFileReader Destructor
+//
+//==========================================================================
+
+MappedFileReader::~MappedFileReader()
+{
+#ifdef _WIN32
+	UnmapViewOfFile(mData);
+#else
+	munmap((void *)mData, mLength);
+#endif
+}
+
+//==========================================================================
+//
+// OpenFileReader
+//
+// Takes over the FILE. Gets closed right away if the file can be mapped,
+// since the mapping stays valid on its own.
+//
+//==========================================================================
+
+FileInterface *OpenFileReader(FILE *f)
+{
+	if (auto mapped = MappedFileReader::Open(f))
+	{
+		fclose(f);
+		return mapped;
+	}
+	auto reader = new StdioFileReader;
+	reader->f = f;
+	return reader;
+}
+
+}
@@ -69,6 +69,11 @@ public:
 	{
 		delete this;
 	}
+	// Readers that have the entire file in memory return it here, so that loaders which need all of it at once can use it without copying.
+	virtual const uint8_t* memory()
+	{
+		return nullptr;
+	}
 
 	long filelength()
 	{
@@ -139,11 +144,11 @@ struct MemoryReader : public FileInterface
 	
 	char* gets(char* strbuf, int len) override
 	{
-		if (len > mLength - mPos) len = mLength - mPos;
-		if (len <= 0) return NULL;
+		if (len > mLength - mPos + 1) len = mLength - mPos + 1;	// len includes the terminating 0.
+		if (len <= 1) return NULL;
 
 		char *p = strbuf;
-		while (len > 1)
+		while (len > 1 && mPos < mLength)	// a skipped \r does not use up len
 		{
 			if (mData[mPos] == 0)
 			{
@@ -196,10 +201,35 @@ struct MemoryReader : public FileInterface
 	{
 		return mPos;
 	}
+	const uint8_t* memory() override
+	{
+		return mData;
+	}
 protected:
 	MemoryReader() {}
 };
 
+//==========================================================================
+//
+// Inplementation of the FileInterface for a memory mapped file.
+// Reading is just a memcpy and loaders can use the mapping directly.
+//
+//==========================================================================
+
+struct MappedFileReader : public MemoryReader
+{
+	static MappedFileReader* Open(FILE* f);
+
+protected:
+	MappedFileReader(const uint8_t* data, long length) : MemoryReader(data, length) {}
+	~MappedFileReader();
+};
+
+// Returns a mapped reader for the file if possible and a StdioFileReader otherwise. The FILE is taken over in either case.
+FileInterface* OpenFileReader(FILE* f);
+// Returns a reader that decompresses a gzipped file while it is read, or nullptr if the header is invalid. Takes over the reader if successful.
+FileInterface* OpenGzipReader(FileInterface* reader);
+
 //==========================================================================
 //
 // Inplementation of the FileInterface for an std::vector owned by the reader
@@ -342,8 +372,7 @@ public:
 			if (!f) f = fopen(fn, "rb");
 		}
 		if (!f) return nullptr;
-		auto tf = new StdioFileReader;
-		tf->f = f;
+		auto tf = OpenFileReader(f);
 		tf->filename = fullname;
 		return tf;
 	}
@@ -0,0 +1,307 @@
+/*
+** gzipreader.cpp
+** Streaming decompression of gzipped songs
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <algorithm>
+#include <miniz.h>
+#include "fileio.h"
+
+#define GZIP_FHCRC		2
+#define GZIP_FEXTRA		4
+#define GZIP_FNAME		8
+#define GZIP_FCOMMENT	16
+
+namespace MusicIO
+{
+
+//==========================================================================
+//
+// Inflates a gzip file on demand while it is being read.
+//
+// The most recently inflated data is kept in a window so that the typical
+// pattern of reading a header and seeking back to the start is cheap.
+// Seeking back further than that restarts decompression from the top,
+// which is slow but only happens for loaders that jump around in the file.
+//
+//==========================================================================
+
+class GzipReader : public FileInterface
+{
+	enum
+	{
+		WindowSize = 65536,
+		InputSize = 16384,
+	};
+
+	FileInterface *mReader;
+	long mDataStart = 0;		// start of the deflate stream in the compressed file
+	long mPos = 0;				// read position in the uncompressed data
+	long mOutPos = 0;			// how much has been inflated so far
+	bool mEOF = false;
+	z_stream mStream = {};
+	uint8_t mWindow[WindowSize];
+	uint8_t mInput[InputSize];
+
+	bool Restart();
+	bool Inflate();
+
+public:
+	GzipReader(FileInterface *reader) : mReader(reader) {}
+	bool Open();
+
+	char *gets(char *buff, int n) override;
+	long read(void *buff, int32_t size) override;
+	long seek(long offset, int whence) override;
+	long tell() override { return mPos; }
+	void close() override;
+};
+
+//==========================================================================
+//
+// GzipReader :: Open
+//
+// Parses the header. The trailer's size field is only used as the file
+// length, reading stops wherever the compressed data actually ends.
+//
+//==========================================================================
+
+bool GzipReader::Open()
+{
+	uint8_t header[10];
+	uint8_t trailer[4];
+
+	if (mReader->seek(0, SEEK_SET) != 0 || mReader->read(header, 10) != 10) return false;
+	uint8_t flags = header[3];
+
+	if (flags & GZIP_FEXTRA)
+	{
+		uint8_t xlen[2];
+		if (mReader->read(xlen, 2) != 2 || mReader->seek(xlen[0] | (xlen[1] << 8), SEEK_CUR) != 0) return false;
+	}
+	for (int flag : { GZIP_FNAME, GZIP_FCOMMENT })
+	{
+		if (flags & flag)
+		{
+			uint8_t c;
+			do
+			{
+				if (mReader->read(&c, 1) != 1) return false;
+			} while (c != 0);
+		}
+	}
+	if ((flags & GZIP_FHCRC) && mReader->seek(2, SEEK_CUR) != 0)
+	{
+		return false;
+	}
+	mDataStart = mReader->tell();
+
+	if (mReader->seek(-4, SEEK_END) != 0 || mReader->read(trailer, 4) != 4) return false;
+	length = long(trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((uint32_t)trailer[3] << 24));
+
+	if (inflateInit2(&mStream, -MAX_WBITS) != Z_OK) return false;
+	if (!Restart())
+	{
+		inflateEnd(&mStream);
+		return false;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// GzipReader :: Restart
+//
+//==========================================================================
+
+bool GzipReader::Restart()
+{
+	if (mReader->seek(mDataStart, SEEK_SET) != 0 || inflateReset(&mStream) != Z_OK)
+	{
+		return false;
+	}
+	mStream.next_in = mInput;
+	mStream.avail_in = 0;
+	mOutPos = 0;
+	mEOF = false;
+	return true;
+}
+
+//==========================================================================
+//
+// GzipReader :: Inflate
+//
+// Appends the next piece of uncompressed data to the window.
+//
+//==========================================================================
+
+bool GzipReader::Inflate()
+{
+	if (mEOF) return false;
+
+	long start = mOutPos % WindowSize;
+	uInt space = uInt(WindowSize - start);
+	mStream.next_out = mWindow + start;
+	mStream.avail_out = space;
+
+	while (mStream.avail_out == space)
+	{
+		if (mStream.avail_in == 0)
+		{
+			long got = mReader->read(mInput, InputSize);
+			if (got <= 0)
+			{
+				mEOF = true;	// truncated file
+				break;
+			}
+			mStream.next_in = mInput;
+			mStream.avail_in = uInt(got);
+		}
+		if (inflate(&mStream, Z_NO_FLUSH) != Z_OK)
+		{
+			mEOF = true;	// either the end of the stream or broken data.
+			break;
+		}
+	}
+	mOutPos += long(space - mStream.avail_out);
+	return mStream.avail_out != space;
+}
+
+//==========================================================================
+//
+// GzipReader :: read
+//
+//==========================================================================
+
+long GzipReader::read(void *buff, int32_t size)
+{
+	auto out = (uint8_t *)buff;
+	long done = 0;
+
+	if (mPos < mOutPos - WindowSize && !Restart())
+	{
+		return 0;
+	}
+	while (done < size)
+	{
+		if (mPos >= mOutPos)
+		{
+			if (!Inflate()) break;
+			continue;
+		}
+		long ofs = mPos % WindowSize;
+		long count = std::min({ long(size - done), mOutPos - mPos, long(WindowSize - ofs) });
+		memcpy(out + done, mWindow + ofs, count);
+		done += count;
+		mPos += count;
+	}
+	return done;
+}
+
+//==========================================================================
+//
+// GzipReader :: gets
+//
+//==========================================================================
+
+char *GzipReader::gets(char *buff, int n)
+{
+	if (n <= 0) return nullptr;
+	int i = 0;
+	while (i < n - 1)
+	{
+		char c;
+		if (read(&c, 1) != 1) break;
+		buff[i++] = c;
+		if (c == '\n') break;
+	}
+	if (i == 0) return nullptr;
+	buff[i] = 0;
+	return buff;
+}
+
+//==========================================================================
+//
+// GzipReader :: seek
+//
+// Only moves the position, the actual work is done by the next read.
+//
+//==========================================================================
+
+long GzipReader::seek(long offset, int whence)
+{
+	switch (whence)
+	{
+	case SEEK_CUR:
+		offset += mPos;
+		break;
+
+	case SEEK_END:
+		offset += length;
+		break;
+	}
+	if (offset < 0 || offset > length) return -1;
+	mPos = offset;
+	return 0;
+}
+
+//==========================================================================
+//
+// GzipReader :: close
+//
+//==========================================================================
+
+void GzipReader::close()
+{
+	inflateEnd(&mStream);
+	mReader->close();
+	delete this;
+}
+
+//==========================================================================
+//
+// OpenGzipReader
+//
+//==========================================================================
+
+FileInterface *OpenGzipReader(FileInterface *reader)
+{
+	auto gz = new GzipReader(reader);
+	if (!gz->Open())
+	{
+		delete gz;
+		return nullptr;
+	}
+	return gz;
+}
+
+}
@@ -56,6 +56,7 @@ struct OPLConfig
 	int genmidiset = false;
 	uint8_t OPLinstruments[36 * 175]; // it really is 'struct GenMidiInstrument OPLinstruments[GENMIDI_NUM_TOTAL]'; but since this is a public header it cannot pull in a dependency from oplsynth.
 	float gain = 1.0f;
+	int resample = 0;	// quality of the built-in resampler to snd_outputrate, 0 keeps the chip rate
 };
 
 struct OpnConfig
@@ -89,10 +90,10 @@ struct GUSConfig
 	std::vector<uint8_t> dmxgus;				// can contain the contents of a DMXGUS lump that may be used as the instrument set. In this case gus_patchdir must point to the location of the GUS data and gus_dmxgus must be true.
 	
 	// This is the instrument cache for the GUS synth.
-	MusicIO::SoundFontReaderInterface *reader;
+	MusicIO::SoundFontReaderInterface *reader = nullptr;
 	std::string readerName;
 	std::string loadedConfig;
-	std::unique_ptr<Timidity::Instruments> instruments;
+	std::shared_ptr<Timidity::Instruments> instruments;
 };
 
 namespace TimidityPlus
@@ -105,7 +106,7 @@ struct TimidityConfig
 {
 	std::string timidity_config;
 
-	MusicIO::SoundFontReaderInterface* reader;
+	MusicIO::SoundFontReaderInterface* reader = nullptr;
 	std::string readerName;
 	std::string loadedConfig;
 	std::shared_ptr<TimidityPlus::Instruments> instruments;	// this is held both by the config and the device
@@ -124,7 +125,7 @@ struct WildMidiConfig
 	bool enhanced_resampling = true;
 	std::string config;
 
-	MusicIO::SoundFontReaderInterface* reader;
+	MusicIO::SoundFontReaderInterface* reader = nullptr;
 	std::string readerName;
 	std::string loadedConfig;
 	std::shared_ptr<WildMidi::Instruments> instruments;	// this is held both by the config and the device
@@ -133,10 +134,10 @@ struct WildMidiConfig
 
 struct DumbConfig
 {
-	int  mod_samplerate;
+	int  mod_samplerate = 0;
     int  mod_volramp = 2;
     int  mod_interp = 2;
-    int  mod_autochip;
+    int  mod_autochip = 0;
     int  mod_autochip_size_force = 100;
     int  mod_autochip_size_scan = 500;
     int  mod_autochip_scan_threshold = 12;
@@ -146,24 +147,53 @@ struct DumbConfig
 
 struct MiscConfig
 {
-	int snd_midiprecache;
-	float gme_stereodepth;
+	int snd_midiprecache = 0;
+	float gme_stereodepth = 0;
 	int snd_streambuffersize = 64;
-	int snd_mididevice;
+	int snd_mididevice = 0;
 	int snd_outputrate = 44100;
+	int snd_softclip = 0;		// compresses peaks in the synths' output stage instead of letting them clip hard
+	int snd_resampler_quality = 0;	// 0 leaves the output at the source's native rate, 1-3 resample it to snd_outputrate
+	int snd_midiquantum = 0;	// block size in samples for the software MIDI synths, 0 for exact event timing
+	int snd_wavebits = 32;		// sample format of MIDI wave dumps, 16 or 24 for dithered integer PCM, 32 for float
+	int snd_midisplit = 0;		// number of FluidSynth instances the MIDI channels get spread over, 0 or 1 for a single one
+	float snd_fmrealtime = 4.f;	// how many times faster than realtime an automatically chosen ADL/OPN core must run all chips
 	float snd_musicvolume = 1.f;
 	float relative_volume = 1.f;
 	float snd_mastervolume = 1.f;
 };
 
-extern ADLConfig adlConfig;
-extern FluidConfig fluidConfig;
-extern OPLConfig oplConfig;
-extern OpnConfig opnConfig;
-extern GUSConfig gusConfig;
-extern TimidityConfig timidityConfig;
-extern WildMidiConfig wildMidiConfig;
-extern DumbConfig dumbConfig;
-extern MiscConfig miscConfig;
+// Everything a client can configure, plus the instrument caches that depend on it.
+// Code always works with the context that is current on the calling thread. Songs remember the
+// context they were created with and make it current whenever they get locked.
+struct ZMusicContext
+{
+	ADLConfig adlConfig;
+	FluidConfig fluidConfig;
+	OPLConfig oplConfig;
+	OpnConfig opnConfig;
+	GUSConfig gusConfig;
+	TimidityConfig timidityConfig;
+	WildMidiConfig wildMidiConfig;
+	DumbConfig dumbConfig;
+	MiscConfig miscConfig;
+	std::string errorMessage;
+};
+
+extern ZMusicContext defaultContext;
+extern thread_local ZMusicContext *currentContext;
+
+// Makes a context current for the rest of the enclosing scope.
+class ZMusicContextScope
+{
+	ZMusicContext *previous;
+public:
+	ZMusicContextScope(ZMusicContext *ctx) : previous(currentContext) { currentContext = ctx; }
+	~ZMusicContextScope() { currentContext = previous; }
+	ZMusicContextScope(const ZMusicContextScope &) = delete;
+	ZMusicContextScope &operator=(const ZMusicContextScope &) = delete;
+};
+
+// The callbacks are the client's interface to its file system and message output and therefore shared by all contexts.
 extern ZMusicCallbacks musicCallbacks;
 
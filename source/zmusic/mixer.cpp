@@ -0,0 +1,283 @@
+/*
+** mixer.cpp
+** Renders multiple music streams in parallel and mixes them together
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "zmusic_internal.h"
+#include "musinfo.h"
+#include "threadpool.h"
+
+class MusicMixer
+{
+public:
+	MusicMixer(int samplerate, int numthreads);
+
+	bool Add(MusInfo *song, float gain);
+	void Remove(MusInfo *song);
+	void SetGain(MusInfo *song, float gain);
+	bool Fill(float *buff, int len);
+
+private:
+	struct Channel
+	{
+		MusInfo *Song;
+		float Gain;
+		std::vector<uint8_t> Raw;
+		std::vector<float> Mixed;
+		bool Active;
+	};
+
+	void RenderChannel(Channel &chan, int frames);
+
+	int SampleRate;
+	FCriticalSection CritSec;
+	std::vector<std::unique_ptr<Channel>> Channels;
+	WorkerPool Pool;
+};
+
+//==========================================================================
+//
+// MusicMixer Constructor
+//
+//==========================================================================
+
+MusicMixer::MusicMixer(int samplerate, int numthreads)
+	: SampleRate(samplerate), Pool(numthreads)
+{
+}
+
+//==========================================================================
+//
+// MusicMixer :: Add
+//
+// The song must already be playing so that its output format is known.
+//
+//==========================================================================
+
+bool MusicMixer::Add(MusInfo *song, float gain)
+{
+	SoundStreamInfoEx fmt;
+	{
+		std::lock_guard<MusInfo> lock(*song);
+		fmt = song->GetStreamInfoEx();
+	}
+	if (fmt.mBufferSize <= 0 || fmt.mSampleRate <= 0)
+	{
+		SetError("Song is not streaming");
+		return false;
+	}
+	if (fmt.mSampleRate != SampleRate)
+	{
+		SetError("Song's sample rate does not match the mixer's");
+		return false;
+	}
+
+	std::lock_guard<FCriticalSection> lock(CritSec);
+	for (auto &chan : Channels)
+	{
+		if (chan->Song == song)
+		{
+			chan->Gain = gain;
+			return true;
+		}
+	}
+	Channels.emplace_back(new Channel{ song, gain, {}, {}, false });
+	return true;
+}
+
+//==========================================================================
+//
+// MusicMixer :: Remove
+//
+//==========================================================================
+
+void MusicMixer::Remove(MusInfo *song)
+{
+	std::lock_guard<FCriticalSection> lock(CritSec);
+	Channels.erase(std::remove_if(Channels.begin(), Channels.end(), [=](const std::unique_ptr<Channel> &chan) { return chan->Song == song; }), Channels.end());
+}
+
+//==========================================================================
+//
+// MusicMixer :: SetGain
+//
+//==========================================================================
+
+void MusicMixer::SetGain(MusInfo *song, float gain)
+{
+	std::lock_guard<FCriticalSection> lock(CritSec);
+	for (auto &chan : Channels)
+	{
+		if (chan->Song == song) chan->Gain = gain;
+	}
+}
+
+//==========================================================================
+//
+// MusicMixer :: RenderChannel
+//
+// Runs on the worker pool. Pulls one block from the song and converts it
+// to stereo float with the channel's gain applied.
+//
+//==========================================================================
+
+void MusicMixer::RenderChannel(Channel &chan, int frames)
+{
+	MusInfo *song = chan.Song;
+	SoundStreamInfoEx fmt;
+
+	chan.Active = false;
+	if (song->m_Status != MusInfo::STATE_Playing) return;
+	fmt = song->GetPublishedStreamInfo();
+	// A song that got restarted with a different device may have changed its format.
+	if (fmt.mSampleRate != SampleRate) return;
+
+	int numchannels = ZMusic_ChannelCount(fmt.mChannelConfig);
+	int samples = frames * numchannels;
+	chan.Raw.resize(samples * ZMusic_SampleTypeSize(fmt.mSampleType));
+	chan.Mixed.resize(frames * 2);
+	song->ReadStream(chan.Raw.data(), (int)chan.Raw.size());
+
+	float *out = chan.Mixed.data();
+	float gain = chan.Gain;
+	switch (fmt.mSampleType)
+	{
+	case SampleType_Float32:
+	{
+		auto in = (const float *)chan.Raw.data();
+		if (numchannels == 2) for (int i = 0; i < samples; i++) out[i] = in[i] * gain;
+		else for (int i = 0; i < frames; i++) out[i * 2] = out[i * 2 + 1] = in[i] * gain;
+		break;
+	}
+	case SampleType_Int16:
+	{
+		auto in = (const int16_t *)chan.Raw.data();
+		gain *= 1.f / 32768.f;
+		if (numchannels == 2) for (int i = 0; i < samples; i++) out[i] = in[i] * gain;
+		else for (int i = 0; i < frames; i++) out[i * 2] = out[i * 2 + 1] = in[i] * gain;
+		break;
+	}
+	case SampleType_UInt8:
+	{
+		auto in = (const uint8_t *)chan.Raw.data();
+		gain *= 1.f / 128.f;
+		if (numchannels == 2) for (int i = 0; i < samples; i++) out[i] = (in[i] - 128) * gain;
+		else for (int i = 0; i < frames; i++) out[i * 2] = out[i * 2 + 1] = (in[i] - 128) * gain;
+		break;
+	}
+	}
+	chan.Active = true;
+}
+
+//==========================================================================
+//
+// MusicMixer :: Fill
+//
+// len is in bytes, the output is always interleaved stereo float.
+//
+//==========================================================================
+
+bool MusicMixer::Fill(float *buff, int len)
+{
+	int frames = len / (2 * sizeof(float));
+	memset(buff, 0, len);
+
+	std::lock_guard<FCriticalSection> lock(CritSec);
+	Pool.Run((int)Channels.size(), [&](int i) { RenderChannel(*Channels[i], frames); });
+
+	for (auto &chan : Channels)
+	{
+		if (!chan->Active) continue;
+		const float *in = chan->Mixed.data();
+		for (int i = 0; i < frames * 2; i++)
+		{
+			buff[i] += in[i];
+		}
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// C interface
+//
+//==========================================================================
+
+DLL_EXPORT MusicMixer *ZMusic_CreateMixer(int samplerate, int numthreads)
+{
+	if (samplerate <= 0)
+	{
+		SetError("Invalid sample rate");
+		return nullptr;
+	}
+	try
+	{
+		return new MusicMixer(samplerate, numthreads);
+	}
+	catch (const std::exception &ex)
+	{
+		SetError(ex.what());
+		return nullptr;
+	}
+}
+
+DLL_EXPORT zmusic_bool ZMusic_MixerAdd(MusicMixer *mixer, MusInfo *song, float gain)
+{
+	if (!mixer || !song) return false;
+	return mixer->Add(song, gain);
+}
+
+DLL_EXPORT void ZMusic_MixerRemove(MusicMixer *mixer, MusInfo *song)
+{
+	if (!mixer || !song) return;
+	mixer->Remove(song);
+}
+
+DLL_EXPORT void ZMusic_MixerSetGain(MusicMixer *mixer, MusInfo *song, float gain)
+{
+	if (!mixer || !song) return;
+	mixer->SetGain(song, gain);
+}
+
+DLL_EXPORT zmusic_bool ZMusic_MixerFill(MusicMixer *mixer, void *buff, int len)
+{
+	if (!mixer) return false;
+	return mixer->Fill((float *)buff, len);
+}
+
+DLL_EXPORT void ZMusic_DestroyMixer(MusicMixer *mixer)
+{
+	delete mixer;
+}
@@ -0,0 +1,283 @@
+/*
+** musinfo.cpp
+** Control command queue and published state of the music base class
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <algorithm>
+#include <chrono>
+#include "musinfo.h"
+#include "renderahead.h"
+
+//==========================================================================
+//
+// MusInfo Destructor
+//
+// Commands that never got to run are simply discarded.
+//
+//==========================================================================
+
+MusInfo::~MusInfo()
+{
+	auto cmd = Commands.exchange(nullptr, std::memory_order_acquire);
+	while (cmd != nullptr)
+	{
+		auto next = cmd->Next;
+		delete cmd;
+		cmd = next;
+	}
+}
+
+//==========================================================================
+//
+// MusInfo :: Enter
+//
+// Everything that runs while the song is locked uses the song's context.
+//
+//==========================================================================
+
+void MusInfo::Enter()
+{
+	CritSec.lock();
+	if (LockCount++ == 0)
+	{
+		OuterContext = currentContext;
+		currentContext = Context;
+	}
+}
+
+bool MusInfo::TryEnter()
+{
+	if (!CritSec.try_lock()) return false;
+	if (LockCount++ == 0)
+	{
+		OuterContext = currentContext;
+		currentContext = Context;
+	}
+	return true;
+}
+
+void MusInfo::Leave()
+{
+	if (--LockCount == 0)
+	{
+		currentContext = OuterContext;
+	}
+	CritSec.unlock();
+}
+
+//==========================================================================
+//
+// MusInfo :: lock
+//
+//==========================================================================
+
+void MusInfo::lock()
+{
+	Enter();
+	ExecuteCommands();
+}
+
+//==========================================================================
+//
+// MusInfo :: try_lock
+//
+//==========================================================================
+
+bool MusInfo::try_lock()
+{
+	if (!TryEnter()) return false;
+	ExecuteCommands();
+	return true;
+}
+
+//==========================================================================
+//
+// MusInfo :: unlock
+//
+// Anything that got queued while the lock was held must not get stuck
+// in the queue, so check again after releasing it.
+//
+//==========================================================================
+
+void MusInfo::unlock()
+{
+	ExecuteCommands();
+	PublishedInfo.Store(GetStreamInfoEx());
+	Leave();
+	RunPendingCommands();
+}
+
+//==========================================================================
+//
+// MusInfo :: Post
+//
+// Lock-free multiple producer queue. Commands get pushed onto a stack
+// which is reversed by the consumer to restore their order.
+//
+//==========================================================================
+
+void MusInfo::Post(std::function<void()> cmd)
+{
+	auto node = new MusicCommand{ std::move(cmd), Commands.load(std::memory_order_relaxed) };
+	while (!Commands.compare_exchange_weak(node->Next, node, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+	RunPendingCommands();
+}
+
+//==========================================================================
+//
+// MusInfo :: RunPendingCommands
+//
+// Executes the queue if nobody else holds the lock. If someone does,
+// they will take care of it when releasing it.
+//
+//==========================================================================
+
+void MusInfo::RunPendingCommands()
+{
+	while (Commands.load(std::memory_order_acquire) != nullptr && TryEnter())
+	{
+		ExecuteCommands();
+		PublishedInfo.Store(GetStreamInfoEx());
+		Leave();
+	}
+}
+
+//==========================================================================
+//
+// MusInfo :: ExecuteCommands
+//
+// CritSec must be held.
+//
+//==========================================================================
+
+void MusInfo::ExecuteCommands()
+{
+	auto list = Commands.exchange(nullptr, std::memory_order_acquire);
+	MusicCommand *ordered = nullptr;
+	while (list != nullptr)
+	{
+		auto next = list->Next;
+		list->Next = ordered;
+		ordered = list;
+		list = next;
+	}
+	while (ordered != nullptr)
+	{
+		auto next = ordered->Next;
+		try
+		{
+			ordered->Run();
+		}
+		catch (const std::exception &ex)
+		{
+			ZMusic_Printf(ZMUSIC_MSG_ERROR, "%s\n", ex.what());
+		}
+		delete ordered;
+		ordered = next;
+	}
+}
+
+//==========================================================================
+//
+// MusInfo :: PublishStats
+//
+// CritSec must be held.
+//
+//==========================================================================
+
+void MusInfo::PublishStats()
+{
+	std::atomic_store(&PublishedStats, std::shared_ptr<const std::string>(std::make_shared<std::string>(GetStats())));
+}
+
+//==========================================================================
+//
+// MusInfo :: RenderBlock
+//
+// The timing counters get published after every block, so that they are
+// current even if nobody asks the player for its part.
+//
+//==========================================================================
+
+bool MusInfo::RenderBlock(void *buff, int len)
+{
+	auto start = std::chrono::steady_clock::now();
+	bool res = ServiceStream(buff, len);
+	auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	auto fmt = GetStreamInfoEx();
+	int framesize = ZMusic_ChannelCount(fmt.mChannelConfig) * ZMusic_SampleTypeSize(fmt.mSampleType);
+	uint32_t frames = framesize > 0 ? uint32_t(len / framesize) : 0;
+
+	Perf.mBlocks++;
+	Perf.mFrames += frames;
+	Perf.mRenderNanoseconds += time;
+	Perf.mLastBlockFrames = frames;
+	Perf.mLastBlockNanoseconds = (uint32_t)std::min<int64_t>(time, UINT32_MAX);
+	if (fmt.mSampleRate > 0)
+	{
+		double rate = fmt.mSampleRate * 1e-9;
+		if (Perf.mRenderNanoseconds > 0) Perf.mRealtimeFactor = float(Perf.mFrames / (Perf.mRenderNanoseconds * rate));
+		if (time > 0) Perf.mLastBlockRealtimeFactor = float(frames / (time * rate));
+	}
+	PublishedPerf.Store(Perf);
+	return res;
+}
+
+//==========================================================================
+//
+// MusInfo :: PublishPerfCounters
+//
+// CritSec must be held.
+//
+//==========================================================================
+
+void MusInfo::PublishPerfCounters()
+{
+	Perf.mActiveVoices = -1;
+	GetPerfCounters(Perf);
+	PublishedPerf.Store(Perf);
+}
+
+//==========================================================================
+//
+// MusInfo :: ReadStream
+//
+//==========================================================================
+
+bool MusInfo::ReadStream(void *buff, int len)
+{
+	if (RenderAhead) return RenderAhead->Read(buff, len);
+	return FillStream(buff, len);
+}
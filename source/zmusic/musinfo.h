@@ -1,10 +1,23 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <string>
 #include <mutex>
 #include "mididefs.h"
 #include "zmusic/zmusic_internal.h"
 #include "critsec.h"
+#include "seqlock.h"
+#include "midiconfig.h"
+
+class RenderAheadBuffer;
+
+struct MusicCommand
+{
+	std::function<void()> Run;
+	MusicCommand *Next;
+};
 
 // The base music class. Everything is derived from this --------------------
 
@@ -12,7 +25,7 @@ class MusInfo
 {
 public:
 	MusInfo() = default;
-	virtual ~MusInfo() {}
+	virtual ~MusInfo();
 	virtual void MusicVolumeChanged() {}		// snd_musicvolume changed
 	virtual void Play (bool looping, int subsong) = 0;
 	virtual void Pause () = 0;
@@ -32,13 +45,62 @@ public:
 	virtual void ChangeSettingString(const char* setting, const char* value) {}	// "
 	virtual bool ServiceStream(void *buff, int len) { return false;  }
 	virtual SoundStreamInfoEx GetStreamInfoEx() const = 0;
+	// Fills in length and timing information for the given subsong by scanning the song's data. Only gets called for songs that were never started.
+	virtual bool Analyze(int subsong, SongAnalysis &info) { return false; }
+	// Fills in the counters only the player knows about, like the number of active voices.
+	virtual void GetPerfCounters(ZMusicPerfCounters &counters) {}
+
+	// Calls ServiceStream and keeps track of how long it took. The song must be locked.
+	bool RenderBlock(void *buff, int len);
+	// Renders the next block of audio synchronously.
+	bool FillStream(void *buff, int len)
+	{
+		std::lock_guard<MusInfo> lock(*this);
+		return RenderBlock(buff, len);
+	}
+	// Everything that pulls audio data out of a song must go through here. Takes the data from the render-ahead buffer if the song has one.
+	bool ReadStream(void *buff, int len);
+
+	// Locking the song itself instead of the CritSec also runs the queued control commands
+	// and publishes the state that can be read without locking.
+	void lock();
+	void unlock();
+	bool try_lock();
+
+	// Runs cmd right away if the song is not busy, otherwise it gets queued and whoever holds the lock runs it when done.
+	// The audio thread therefore executes queued commands between two blocks and the caller never has to wait for it.
+	void Post(std::function<void()> cmd);
+	SoundStreamInfoEx GetPublishedStreamInfo() const { return PublishedInfo.Load(); }
+	void PublishStats();
+	std::shared_ptr<const std::string> GetPublishedStats() const { return std::atomic_load(&PublishedStats); }
+	void PublishPerfCounters();
+	ZMusicPerfCounters GetPublishedPerfCounters() const { return PublishedPerf.Load(); }
 
 	enum EState
 	{
 		STATE_Stopped,
 		STATE_Playing,
 		STATE_Paused
-	} m_Status = STATE_Stopped;
-	bool m_Looping = false;
+	};
+	std::atomic<EState> m_Status{ STATE_Stopped };
+	std::atomic<bool> m_Looping{ false };
 	FCriticalSection CritSec;
+	RenderAheadBuffer *RenderAhead = nullptr;	// owned by ZMusic_SetRenderAhead/ZMusic_Close.
+	ZMusicContext *const Context = currentContext;
+
+private:
+	void Enter();
+	bool TryEnter();
+	void Leave();
+	void ExecuteCommands();
+	void RunPendingCommands();
+
+	int LockCount = 0;
+	ZMusicContext *OuterContext = nullptr;
+
+	std::atomic<MusicCommand*> Commands{ nullptr };
+	FSeqLock<SoundStreamInfoEx> PublishedInfo;
+	std::shared_ptr<const std::string> PublishedStats;
+	ZMusicPerfCounters Perf = {};
+	FSeqLock<ZMusicPerfCounters> PublishedPerf;
 };
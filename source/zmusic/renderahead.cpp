@@ -0,0 +1,287 @@
+/*
+** renderahead.cpp
+** Renders a song ahead of time on a separate thread
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+#include "renderahead.h"
+#include "musinfo.h"
+
+enum
+{
+	MaxSampleRate = 192000,
+	MaxFrameSize = 8,			// stereo float
+	MaxChunkFrames = 1024,
+	MaxMilliseconds = 2000,
+};
+
+//==========================================================================
+//
+// RenderAheadBuffer Constructor
+//
+// The ring is sized for the largest possible format so that it never
+// needs to be reallocated while the consumer is reading from it.
+//
+//==========================================================================
+
+RenderAheadBuffer::RenderAheadBuffer(MusInfo *song, int milliseconds)
+{
+	Song = song;
+	Milliseconds = std::min<int>(milliseconds, MaxMilliseconds);
+	Ring.resize((size_t)MaxSampleRate * MaxFrameSize * Milliseconds / 1000);
+	Producer = std::thread([this] { ProducerMain(); });
+}
+
+//==========================================================================
+//
+// RenderAheadBuffer Destructor
+//
+//==========================================================================
+
+RenderAheadBuffer::~RenderAheadBuffer()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Quit = true;
+	}
+	Wakeup.notify_one();
+	Producer.join();
+}
+
+//==========================================================================
+//
+// RenderAheadBuffer :: ProducerMain
+//
+// Keeps the ring filled. Once it is full the thread only wakes up
+// periodically to check if the consumer has made some room.
+//
+//==========================================================================
+
+void RenderAheadBuffer::ProducerMain()
+{
+	auto idlewait = std::chrono::milliseconds(std::max(1, Milliseconds / 8));
+	std::unique_lock<std::mutex> lock(Mutex);
+	while (!Quit)
+	{
+		lock.unlock();
+		bool busy;
+		try
+		{
+			busy = Produce();
+		}
+		catch (const std::exception &)
+		{
+			Ended.store(true, std::memory_order_release);
+			busy = false;
+		}
+		lock.lock();
+		if (!busy)
+		{
+			Wakeup.wait_for(lock, idlewait, [this] { return Quit || Kick; });
+			Kick = false;
+		}
+	}
+}
+
+//==========================================================================
+//
+// RenderAheadBuffer :: Produce
+//
+// Renders one chunk if there's room for it. Returns false if nothing
+// could be rendered.
+//
+//==========================================================================
+
+bool RenderAheadBuffer::Produce()
+{
+	std::lock_guard<MusInfo> lock(*Song);
+
+	if (Song->m_Status == MusInfo::STATE_Stopped) Ended.store(true, std::memory_order_release);
+	if (Ended.load(std::memory_order_relaxed)) return false;
+
+	auto fmt = Song->GetStreamInfoEx();
+	if (fmt.mSampleRate <= 0)
+	{
+		Ended.store(true, std::memory_order_release);
+		return false;
+	}
+	size_t framesize = ZMusic_ChannelCount(fmt.mChannelConfig) * ZMusic_SampleTypeSize(fmt.mSampleType);
+	size_t target = std::min<size_t>(Ring.size(), (size_t)fmt.mSampleRate * Milliseconds / 1000 * framesize);
+	target -= target % framesize;
+	size_t chunk = std::min<size_t>(target / 4, MaxChunkFrames * framesize);
+	chunk = std::max(chunk - chunk % framesize, framesize);
+	Silence.store(fmt.mSampleType == SampleType_UInt8 ? 0x80 : 0, std::memory_order_relaxed);
+	TargetFill.store((uint32_t)target, std::memory_order_relaxed);
+
+	// Flushed data does not count as buffered, or nothing would get rendered until the consumer reads again.
+	uint64_t wpos = WritePos.load(std::memory_order_relaxed);
+	uint64_t rpos = std::max(ReadPos.load(std::memory_order_acquire), FlushPos.load(std::memory_order_acquire));
+	if (wpos - rpos + chunk > target) return false;
+
+	Chunk.resize(chunk);
+	if (!Song->RenderBlock(Chunk.data(), (int)chunk))
+	{
+		Ended.store(true, std::memory_order_release);
+		return false;
+	}
+
+	size_t ofs = wpos % Ring.size();
+	size_t first = std::min(chunk, Ring.size() - ofs);
+	memcpy(&Ring[ofs], Chunk.data(), first);
+	memcpy(&Ring[0], Chunk.data() + first, chunk - first);
+	WritePos.store(wpos + chunk, std::memory_order_release);
+	return true;
+}
+
+//==========================================================================
+//
+// RenderAheadBuffer :: Read
+//
+// Called from the audio callback. This must never block. If there is not
+// enough data, the rest gets padded with silence and counted as an underrun.
+// Returns false once the song has ended and everything has been read.
+//
+//==========================================================================
+
+bool RenderAheadBuffer::Read(void *buff, int len)
+{
+	uint64_t rpos = ReadPos.load(std::memory_order_relaxed);
+	bool ended = Ended.load(std::memory_order_acquire);
+	uint64_t flush = FlushPos.load(std::memory_order_acquire);
+	if (flush > rpos)
+	{
+		rpos = flush;
+		Refilling = true;
+	}
+	size_t avail = (size_t)(WritePos.load(std::memory_order_acquire) - rpos);
+	size_t n = std::min(avail, (size_t)len);
+
+	if (!Refilling && !ended && avail < LowWater.load(std::memory_order_relaxed))
+	{
+		LowWater.store((uint32_t)avail, std::memory_order_relaxed);
+	}
+
+	size_t ofs = rpos % Ring.size();
+	size_t first = std::min(n, Ring.size() - ofs);
+	memcpy(buff, &Ring[ofs], first);
+	memcpy((uint8_t*)buff + first, &Ring[0], n - first);
+	if (n < (size_t)len)
+	{
+		memset((uint8_t*)buff + n, Silence.load(std::memory_order_relaxed), len - n);
+		if (!Refilling && !ended)
+		{
+			Underruns.fetch_add(1, std::memory_order_relaxed);
+			UnderrunBytes.fetch_add((uint32_t)(len - n), std::memory_order_relaxed);
+		}
+	}
+	if (n > 0) Refilling = false;
+	ReadPos.store(rpos + n, std::memory_order_release);
+	return n > 0 || !ended;
+}
+
+//==========================================================================
+//
+// RenderAheadBuffer :: Flush
+//
+// Discards everything that has been rendered so far. The consumer skips
+// ahead the next time it reads. Playback of the song must have been
+// changed with the CritSec held so that nothing from before gets kept.
+//
+//==========================================================================
+
+void RenderAheadBuffer::Flush()
+{
+	{
+		std::lock_guard<FCriticalSection> lock(Song->CritSec);
+		FlushPos.store(WritePos.load(std::memory_order_relaxed), std::memory_order_release);
+		Ended.store(false, std::memory_order_release);
+	}
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Kick = true;
+	}
+	Wakeup.notify_one();
+}
+
+//==========================================================================
+//
+// RenderAheadBuffer :: GetStats
+//
+//==========================================================================
+
+void RenderAheadBuffer::GetStats(ZMusicRenderAheadStats *stats, bool reset)
+{
+	uint64_t rpos = std::max(ReadPos.load(std::memory_order_acquire), FlushPos.load(std::memory_order_acquire));
+	uint64_t wpos = WritePos.load(std::memory_order_acquire);
+	uint32_t lowwater = reset ? LowWater.exchange(UINT32_MAX) : LowWater.load();
+
+	stats->mUnderruns = reset ? Underruns.exchange(0) : Underruns.load();
+	stats->mUnderrunBytes = reset ? UnderrunBytes.exchange(0) : UnderrunBytes.load();
+	stats->mBufferedBytes = wpos > rpos ? (uint32_t)(wpos - rpos) : 0;
+	stats->mLowWaterBytes = lowwater == UINT32_MAX ? stats->mBufferedBytes : lowwater;
+	stats->mTargetBytes = TargetFill.load();
+}
+
+//==========================================================================
+//
+// C interface
+//
+//==========================================================================
+
+DLL_EXPORT zmusic_bool ZMusic_SetRenderAhead(MusInfo *song, int milliseconds)
+{
+	if (!song) return false;
+	delete song->RenderAhead;
+	song->RenderAhead = nullptr;
+	if (milliseconds <= 0) return true;
+	try
+	{
+		song->RenderAhead = new RenderAheadBuffer(song, milliseconds);
+		return true;
+	}
+	catch (const std::exception &ex)
+	{
+		SetError(ex.what());
+		return false;
+	}
+}
+
+DLL_EXPORT zmusic_bool ZMusic_GetRenderAheadStats(MusInfo *song, ZMusicRenderAheadStats *stats, zmusic_bool reset)
+{
+	if (!stats) return false;
+	*stats = {};
+	if (!song || !song->RenderAhead) return false;
+	song->RenderAhead->GetStats(stats, !!reset);
+	return true;
+}
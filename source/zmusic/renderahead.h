@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "zmusic_internal.h"
+
+class MusInfo;
+
+// Renders a song on a separate thread into a single producer/single consumer ring buffer,
+// so that the audio callback only has to copy data out of it and never waits for the synth.
+// The consumer side (Read) never locks. Everything that changes the song's playback
+// position must call Flush afterwards so that no stale audio gets played.
+
+class RenderAheadBuffer
+{
+public:
+	RenderAheadBuffer(MusInfo *song, int milliseconds);
+	~RenderAheadBuffer();
+
+	bool Read(void *buff, int len);
+	void Flush();
+	void GetStats(ZMusicRenderAheadStats *stats, bool reset);
+
+private:
+	void ProducerMain();
+	bool Produce();
+
+	MusInfo *Song;
+	int Milliseconds;
+	std::vector<uint8_t> Ring;
+	std::vector<uint8_t> Chunk;
+
+	// Positions are running byte counts. WritePos only changes while the song's CritSec is held.
+	std::atomic<uint64_t> WritePos{ 0 };
+	std::atomic<uint64_t> ReadPos{ 0 };
+	std::atomic<uint64_t> FlushPos{ 0 };
+	std::atomic<uint32_t> TargetFill{ 0 };
+	std::atomic<bool> Ended{ false };
+	std::atomic<uint8_t> Silence{ 0 };
+	bool Refilling = true;		// consumer side only.
+
+	std::atomic<uint32_t> Underruns{ 0 };
+	std::atomic<uint32_t> UnderrunBytes{ 0 };
+	std::atomic<uint32_t> LowWater{ UINT32_MAX };
+
+	std::mutex Mutex;
+	std::condition_variable Wakeup;
+	bool Quit = false;
+	bool Kick = false;
+	std::thread Producer;
+};
@@ -0,0 +1,360 @@
+/*
+** resampler.cpp
+** Polyphase sample rate converter for the stream output
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include "resampler.h"
+#include "simd.h"
+#include "midiconfig.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct ResamplerQuality
+{
+	int taps;
+	double beta;		// Kaiser window shape
+	double cutoff;		// relative to the lower of the two Nyquist frequencies
+};
+
+static const ResamplerQuality Qualities[] =
+{
+	{ 8, 5.0, 0.85 },
+	{ 24, 7.0, 0.91 },
+	{ 48, 9.0, 0.95 },
+};
+
+enum
+{
+	MaxPhases = 1024,
+	MaxTaps = 512,
+	ChunkFrames = 512,
+	CompactFrames = 4096,
+};
+
+//==========================================================================
+//
+// Modified Bessel function of the first kind, order 0, for the Kaiser window
+//
+//==========================================================================
+
+static double BesselI0(double x)
+{
+	double sum = 1, term = 1;
+	for (int k = 1; k < 64; k++)
+	{
+		double t = x / (2 * k);
+		term *= t * t;
+		sum += term;
+		if (term < sum * 1e-12) break;
+	}
+	return sum;
+}
+
+static double Sinc(double x)
+{
+	if (fabs(x) < 1e-9) return 1;
+	return sin(M_PI * x) / (M_PI * x);
+}
+
+static uint32_t GCD(uint32_t a, uint32_t b)
+{
+	while (b != 0)
+	{
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+//==========================================================================
+//
+// PolyphaseResampler :: PolyphaseResampler
+//
+// The input position advances by exactly inrate/outrate per output frame,
+// kept as an integer fraction so that long streams cannot drift. Ratios
+// with more than MaxPhases positions between two input frames interpolate
+// between the two nearest phases.
+//
+//==========================================================================
+
+PolyphaseResampler::PolyphaseResampler(int inrate, int outrate, int channels, int quality)
+{
+	const ResamplerQuality &q = Qualities[std::max(1, std::min<int>(quality, MaxQuality)) - 1];
+
+	uint32_t div = GCD(inrate, outrate);
+	Step = inrate / div;
+	Denominator = outrate / div;
+	Phases = std::min<int>(Denominator, MaxPhases);
+	Channels = channels;
+
+	// When going down in rate the filter needs to be stretched to remove everything above the new Nyquist frequency.
+	double ratio = std::min(1.0, (double)outrate / inrate);
+	double cutoff = q.cutoff * ratio;
+	Taps = (int)ceil(q.taps / ratio);
+	Taps = std::min<int>((Taps + 7) & ~7, MaxTaps);
+
+	// One extra phase at the end so that positions between the last phase and the next input frame can be interpolated too.
+	Filter.resize((Phases + 1) * Taps);
+	double half = Taps / 2;
+	double i0beta = BesselI0(q.beta);
+	for (int p = 0; p <= Phases; p++)
+	{
+		double offset = (double)p / Phases;
+		float *coeffs = &Filter[p * Taps];
+		double sum = 0;
+		for (int k = 0; k < Taps; k++)
+		{
+			double x = k - half + 1 - offset;
+			double w = x / half;
+			w = w >= 1 || w <= -1 ? 0 : BesselI0(q.beta * sqrt(1 - w * w)) / i0beta;
+			double v = cutoff * Sinc(cutoff * x) * w;
+			coeffs[k] = (float)v;
+			sum += v;
+		}
+		// Every phase gets normalized on its own so that a constant signal passes through unchanged.
+		for (int k = 0; k < Taps; k++)
+		{
+			coeffs[k] = (float)(coeffs[k] / sum);
+		}
+	}
+	History.resize(Channels);
+	Reset();
+}
+
+//==========================================================================
+//
+// PolyphaseResampler :: Reset
+//
+//==========================================================================
+
+void PolyphaseResampler::Reset()
+{
+	Fraction = 0;
+	Position = 0;
+	// Pad the front so that the first output frame is centered on the first input frame.
+	for (auto &h : History)
+	{
+		h.assign(Taps / 2 - 1, 0.f);
+	}
+}
+
+//==========================================================================
+//
+// PolyphaseResampler :: Write
+//
+//==========================================================================
+
+void PolyphaseResampler::Write(const float *in, int frames)
+{
+	for (int c = 0; c < Channels; c++)
+	{
+		auto &h = History[c];
+		size_t start = h.size();
+		h.resize(start + frames);
+		for (int i = 0; i < frames; i++)
+		{
+			h[start + i] = in[i * Channels + c];
+		}
+	}
+}
+
+//==========================================================================
+//
+// PolyphaseResampler :: InputNeeded
+//
+//==========================================================================
+
+int PolyphaseResampler::InputNeeded(int frames) const
+{
+	if (frames <= 0) return 0;
+	size_t last = Position + size_t((Fraction + uint64_t(frames - 1) * Step) / Denominator);
+	size_t needed = last + Taps;
+	size_t have = History[0].size();
+	return needed > have ? int(needed - have) : 0;
+}
+
+//==========================================================================
+//
+// PolyphaseResampler :: Read
+//
+//==========================================================================
+
+int PolyphaseResampler::Read(float *out, int frames)
+{
+	size_t have = History[0].size();
+	int done = 0;
+	while (done < frames && Position + Taps <= have)
+	{
+		uint64_t scaled = uint64_t(Fraction) * Phases;
+		const float *coeffs = &Filter[size_t(scaled / Denominator) * Taps];
+		uint32_t between = uint32_t(scaled % Denominator);
+		if (between == 0)
+		{
+			for (int c = 0; c < Channels; c++)
+			{
+				out[done * Channels + c] = SIMD::DotProduct(&History[c][Position], coeffs, Taps);
+			}
+		}
+		else
+		{
+			float t = (float)between / Denominator;
+			for (int c = 0; c < Channels; c++)
+			{
+				float a = SIMD::DotProduct(&History[c][Position], coeffs, Taps);
+				float b = SIMD::DotProduct(&History[c][Position], coeffs + Taps, Taps);
+				out[done * Channels + c] = a + (b - a) * t;
+			}
+		}
+		done++;
+		Fraction += Step;
+		Position += Fraction / Denominator;
+		Fraction %= Denominator;
+	}
+
+	// Input that no future output frame will look at only gets discarded once there
+	// is enough of it, instead of moving the whole history down on every call.
+	size_t discard = std::min(Position, have);
+	if (discard >= CompactFrames)
+	{
+		for (auto &h : History)
+		{
+			h.erase(h.begin(), h.begin() + discard);
+		}
+		Position -= discard;
+	}
+	return done;
+}
+
+//==========================================================================
+//
+// PolyphaseResampler :: Drain
+//
+//==========================================================================
+
+void PolyphaseResampler::Drain()
+{
+	for (auto &h : History)
+	{
+		h.resize(h.size() + Taps / 2 + 1, 0.f);
+	}
+}
+
+//==========================================================================
+//
+// StreamResampler :: StreamResampler
+//
+//==========================================================================
+
+StreamResampler::StreamResampler(const SoundStreamInfoEx &source, int outrate, int quality)
+	: Source(source), Resampler(source.mSampleRate, outrate, ZMusic_ChannelCount(source.mChannelConfig), quality)
+{
+	int channels = ZMusic_ChannelCount(source.mChannelConfig);
+	int64_t frames = source.mBufferSize / (ZMusic_SampleTypeSize(source.mSampleType) * channels);
+	frames = frames * outrate / source.mSampleRate;
+
+	Format.mBufferSize = int(frames * channels * sizeof(float));
+	Format.mSampleRate = outrate;
+	Format.mSampleType = SampleType_Float32;
+	Format.mChannelConfig = source.mChannelConfig;
+
+	SourceFormat = source.mSampleType == SampleType_UInt8 ? SIMD::Sample_UInt8 : source.mSampleType == SampleType_Int16 ? SIMD::Sample_Int16 : SIMD::Sample_Float32;
+}
+
+//==========================================================================
+//
+// StreamResampler :: Create
+//
+//==========================================================================
+
+StreamResampler *StreamResampler::Create(const SoundStreamInfoEx &source)
+{
+	int quality = currentContext->miscConfig.snd_resampler_quality;
+	int outrate = currentContext->miscConfig.snd_outputrate;
+	if (quality <= 0 || outrate <= 0 || source.mBufferSize <= 0 || source.mSampleRate <= 0 || source.mSampleRate == outrate)
+	{
+		return nullptr;
+	}
+	if (ZMusic_SampleTypeSize(source.mSampleType) == 0 || ZMusic_ChannelCount(source.mChannelConfig) == 0)
+	{
+		return nullptr;
+	}
+	return new StreamResampler(source, outrate, quality);
+}
+
+//==========================================================================
+//
+// StreamResampler :: Fill
+//
+//==========================================================================
+
+bool StreamResampler::Fill(void *buff, int len, const std::function<bool(void *, int)> &source)
+{
+	int channels = ZMusic_ChannelCount(Format.mChannelConfig);
+	int samplesize = ZMusic_SampleTypeSize(Source.mSampleType);
+	float *out = (float *)buff;
+	int frames = len / (channels * sizeof(float));
+	int done = 0;
+
+	while (true)
+	{
+		done += Resampler.Read(out + done * channels, frames - done);
+		if (done >= frames || Ended) break;
+
+		int chunk = std::min<int>(std::max(Resampler.InputNeeded(frames - done), 1), ChunkFrames);
+		int samples = chunk * channels;
+		Raw.resize(samples * samplesize);
+		Converted.resize(samples);
+		// The chunk in which the source ends still has its last samples.
+		Ended = !source(Raw.data(), samples * samplesize);
+
+		SIMD::ConvertSamples(Converted.data(), SIMD::Sample_Float32, Raw.data(), SourceFormat, samples, 1.f);
+		Resampler.Write(Converted.data(), chunk);
+		if (Ended)
+		{
+			// Run the filter past the end of the input so that its delay does not swallow the tail.
+			Resampler.Drain();
+		}
+	}
+	if (done < frames)
+	{
+		memset(out + done * channels, 0, (frames - done) * channels * sizeof(float));
+	}
+	// Once the source has ended this keeps going until everything it delivered has been output.
+	return !Ended || done >= frames;
+}
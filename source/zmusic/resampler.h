@@ -0,0 +1,66 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+#include "zmusic_internal.h"
+#include "simd.h"
+
+// Windowed sinc polyphase resampler for interleaved float data.
+// Quality 1 to 3 trades filter length against CPU time, 0 means no resampling at all.
+
+class PolyphaseResampler
+{
+public:
+	enum { MaxQuality = 3 };
+
+	PolyphaseResampler(int inrate, int outrate, int channels, int quality);
+
+	// Appends interleaved input frames.
+	void Write(const float *in, int frames);
+	// Produces up to 'frames' interleaved output frames from the input written so far. Returns the number produced.
+	int Read(float *out, int frames);
+	// Number of input frames needed before another 'frames' can be read.
+	int InputNeeded(int frames) const;
+	// Appends the silence needed to read the output up to the last input frame written.
+	void Drain();
+	void Reset();
+
+private:
+	int Channels;
+	int Taps;
+	int Phases;
+	uint32_t Step;		// input advance per output frame is Step / Denominator
+	uint32_t Denominator;
+	uint32_t Fraction = 0;
+	size_t Position = 0;	// index into History of the first tap for the next output frame
+	std::vector<float> Filter;					// (Phases + 1) * Taps
+	std::vector<std::vector<float>> History;	// one deinterleaved buffer per channel
+};
+
+// Puts a resampler behind a source that delivers data in any of the stream formats.
+// The output is always 32 bit float at the requested rate with the source's channel configuration.
+
+class StreamResampler
+{
+public:
+	StreamResampler(const SoundStreamInfoEx &source, int outrate, int quality);
+
+	SoundStreamInfoEx GetFormat() const { return Format; }
+	// The source callback works like ServiceStream. Returns false once the source has run out of data
+	// and all of it has been output.
+	bool Fill(void *buff, int len, const std::function<bool(void *, int)> &source);
+	void Reset() { Resampler.Reset(); Ended = false; }
+
+	// Creates a resampler if the configured quality is enabled and the rates differ.
+	static StreamResampler *Create(const SoundStreamInfoEx &source);
+
+private:
+	SoundStreamInfoEx Source;
+	SoundStreamInfoEx Format;
+	SIMD::SampleFormat SourceFormat;
+	PolyphaseResampler Resampler;
+	bool Ended = false;
+	std::vector<uint8_t> Raw;
+	std::vector<float> Converted;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <string.h>
+#include <type_traits>
+
+// Publishes a small trivially copyable value from a single writer to any number of readers.
+// Neither side ever blocks, readers simply retry if they caught the writer in the middle of an update.
+
+template<class T>
+class FSeqLock
+{
+	static_assert(std::is_trivially_copyable<T>::value, "FSeqLock needs a trivially copyable type");
+	enum { NumWords = (sizeof(T) + sizeof(unsigned) - 1) / sizeof(unsigned) };
+
+public:
+	FSeqLock()
+	{
+		Store(T{});
+	}
+
+	// Only one thread may store at a time.
+	void Store(const T &value)
+	{
+		unsigned buffer[NumWords] = {};
+		memcpy(buffer, &value, sizeof(T));
+
+		unsigned seq = Sequence.load(std::memory_order_relaxed);
+		Sequence.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (int i = 0; i < NumWords; i++) Words[i].store(buffer[i], std::memory_order_relaxed);
+		Sequence.store(seq + 2, std::memory_order_release);
+	}
+
+	T Load() const
+	{
+		unsigned buffer[NumWords];
+		unsigned seq1, seq2;
+		do
+		{
+			seq1 = Sequence.load(std::memory_order_acquire);
+			for (int i = 0; i < NumWords; i++) buffer[i] = Words[i].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			seq2 = Sequence.load(std::memory_order_relaxed);
+		} while (seq1 != seq2 || (seq1 & 1));
+
+		T value;
+		memcpy(&value, buffer, sizeof(T));
+		return value;
+	}
+
+private:
+	std::atomic<unsigned> Sequence{ 0 };
+	std::atomic<unsigned> Words[NumWords];
+};
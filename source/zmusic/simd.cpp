@@ -0,0 +1,481 @@
+/*
+** simd.cpp
+** Runtime dispatched SIMD kernels
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "simd.h"
+
+#ifdef ZMUSIC_SIMD_SSE2
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#ifdef ZMUSIC_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace SIMD
+{
+
+// The soft clipper is x - 4/27 x^3 on [-1.5, 1.5], which reaches exactly +/-1 with a flat slope at the ends.
+static const float ClipLimit = 1.5f;
+static const float ClipCubic = 4.f / 27.f;
+// Largest float below 2^31, so that the int32 conversion cannot overflow.
+static const float Int32Max = 2147483520.f;
+
+static float InputScale(SampleFormat format)
+{
+	switch (format)
+	{
+	case Sample_UInt8: return 1.f / 128;
+	case Sample_Int16: return 1.f / 32768;
+	case Sample_Int32: return 1.f / 2147483648.f;
+	default: return 1.f;
+	}
+}
+
+//==========================================================================
+//
+// Scalar versions. The sample conversion also handles the leftovers of
+// the vectorized loops.
+//
+//==========================================================================
+
+#if !defined(ZMUSIC_SIMD_SSE2) && !defined(ZMUSIC_SIMD_NEON)
+
+static float DotProduct_C(const float *a, const float *b, int count)
+{
+	float sum[4] = {};
+	for (int i = 0; i < count; i += 4)
+	{
+		sum[0] += a[i] * b[i];
+		sum[1] += a[i + 1] * b[i + 1];
+		sum[2] += a[i + 2] * b[i + 2];
+		sum[3] += a[i + 3] * b[i + 3];
+	}
+	return (sum[0] + sum[2]) + (sum[1] + sum[3]);
+}
+
+#endif
+
+static inline float LoadSample(const void *in, SampleFormat format, int i)
+{
+	switch (format)
+	{
+	case Sample_UInt8: return float(((const uint8_t *)in)[i] - 128);
+	case Sample_Int16: return float(((const int16_t *)in)[i]);
+	case Sample_Int32: return float(((const int32_t *)in)[i]);
+	default: return ((const float *)in)[i];
+	}
+}
+
+static inline float Clamp(float v, float lo, float hi)
+{
+	return v < lo ? lo : v > hi ? hi : v;
+}
+
+static inline void StoreSample(void *out, SampleFormat format, int i, float v)
+{
+	switch (format)
+	{
+	case Sample_UInt8: ((uint8_t *)out)[i] = uint8_t(lrintf(Clamp(v * 128.f, -128.f, 127.f)) + 128); break;
+	case Sample_Int16: ((int16_t *)out)[i] = int16_t(lrintf(Clamp(v * 32768.f, -32768.f, 32767.f))); break;
+	case Sample_Int32: ((int32_t *)out)[i] = int32_t(lrintf(Clamp(v * 2147483648.f, -2147483648.f, Int32Max))); break;
+	default: ((float *)out)[i] = v; break;
+	}
+}
+
+static void ConvertSamples_C(void *out, SampleFormat outformat, const void *in, SampleFormat informat, int start, int count, float scale, bool softclip)
+{
+	for (int i = start; i < count; i++)
+	{
+		float v = LoadSample(in, informat, i) * scale;
+		if (softclip)
+		{
+			v = Clamp(v, -ClipLimit, ClipLimit);
+			v -= ClipCubic * v * v * v;
+		}
+		StoreSample(out, outformat, i, v);
+	}
+}
+
+#ifdef ZMUSIC_SIMD_SSE2
+
+//==========================================================================
+//
+// SSE2
+//
+//==========================================================================
+
+static float DotProduct_SSE2(const float *a, const float *b, int count)
+{
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+	for (int i = 0; i < count; i += 8)
+	{
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+	}
+	sum0 = _mm_add_ps(sum0, sum1);
+	sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+	sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+	return _mm_cvtss_f32(sum0);
+}
+
+template<SampleFormat In>
+static inline __m128 Load4_SSE2(const void *in, int i)
+{
+	if constexpr (In == Sample_UInt8)
+	{
+		int32_t bytes;
+		memcpy(&bytes, (const uint8_t *)in + i, 4);
+		__m128i zero = _mm_setzero_si128();
+		__m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+		return _mm_cvtepi32_ps(_mm_sub_epi32(v, _mm_set1_epi32(128)));
+	}
+	else if constexpr (In == Sample_Int16)
+	{
+		__m128i v = _mm_loadl_epi64((const __m128i *)((const int16_t *)in + i));
+		return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+	}
+	else if constexpr (In == Sample_Int32)
+	{
+		return _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)((const int32_t *)in + i)));
+	}
+	else
+	{
+		return _mm_loadu_ps((const float *)in + i);
+	}
+}
+
+template<SampleFormat Out>
+static inline void Store4_SSE2(void *out, int i, __m128 v)
+{
+	if constexpr (Out == Sample_UInt8)
+	{
+		v = _mm_max_ps(_mm_min_ps(_mm_mul_ps(v, _mm_set1_ps(128.f)), _mm_set1_ps(127.f)), _mm_set1_ps(-128.f));
+		__m128i r = _mm_add_epi32(_mm_cvtps_epi32(v), _mm_set1_epi32(128));
+		r = _mm_packs_epi32(r, r);
+		int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(r, r));
+		memcpy((uint8_t *)out + i, &bytes, 4);
+	}
+	else if constexpr (Out == Sample_Int16)
+	{
+		v = _mm_max_ps(_mm_min_ps(_mm_mul_ps(v, _mm_set1_ps(32768.f)), _mm_set1_ps(32767.f)), _mm_set1_ps(-32768.f));
+		__m128i r = _mm_cvtps_epi32(v);
+		_mm_storel_epi64((__m128i *)((int16_t *)out + i), _mm_packs_epi32(r, r));
+	}
+	else if constexpr (Out == Sample_Int32)
+	{
+		v = _mm_max_ps(_mm_min_ps(_mm_mul_ps(v, _mm_set1_ps(2147483648.f)), _mm_set1_ps(Int32Max)), _mm_set1_ps(-2147483648.f));
+		_mm_storeu_si128((__m128i *)((int32_t *)out + i), _mm_cvtps_epi32(v));
+	}
+	else
+	{
+		_mm_storeu_ps((float *)out + i, v);
+	}
+}
+
+template<SampleFormat In, SampleFormat Out, bool SoftClip>
+static void Convert_SSE2(void *out, const void *in, int count, float scale)
+{
+	__m128 vscale = _mm_set1_ps(scale);
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 v = _mm_mul_ps(Load4_SSE2<In>(in, i), vscale);
+		if constexpr (SoftClip)
+		{
+			v = _mm_max_ps(_mm_min_ps(v, _mm_set1_ps(ClipLimit)), _mm_set1_ps(-ClipLimit));
+			v = _mm_sub_ps(v, _mm_mul_ps(_mm_set1_ps(ClipCubic), _mm_mul_ps(v, _mm_mul_ps(v, v))));
+		}
+		Store4_SSE2<Out>(out, i, v);
+	}
+	ConvertSamples_C(out, Out, in, In, i, count, scale, SoftClip);
+}
+
+template<SampleFormat In>
+static void ConvertTo_SSE2(void *out, SampleFormat outformat, const void *in, int count, float scale, bool softclip)
+{
+	switch (outformat)
+	{
+	case Sample_UInt8: return softclip ? Convert_SSE2<In, Sample_UInt8, true>(out, in, count, scale) : Convert_SSE2<In, Sample_UInt8, false>(out, in, count, scale);
+	case Sample_Int16: return softclip ? Convert_SSE2<In, Sample_Int16, true>(out, in, count, scale) : Convert_SSE2<In, Sample_Int16, false>(out, in, count, scale);
+	case Sample_Int32: return softclip ? Convert_SSE2<In, Sample_Int32, true>(out, in, count, scale) : Convert_SSE2<In, Sample_Int32, false>(out, in, count, scale);
+	case Sample_Float32: return softclip ? Convert_SSE2<In, Sample_Float32, true>(out, in, count, scale) : Convert_SSE2<In, Sample_Float32, false>(out, in, count, scale);
+	}
+}
+
+static void ConvertSamples_SSE2(void *out, SampleFormat outformat, const void *in, SampleFormat informat, int count, float scale, bool softclip)
+{
+	switch (informat)
+	{
+	case Sample_UInt8: return ConvertTo_SSE2<Sample_UInt8>(out, outformat, in, count, scale, softclip);
+	case Sample_Int16: return ConvertTo_SSE2<Sample_Int16>(out, outformat, in, count, scale, softclip);
+	case Sample_Int32: return ConvertTo_SSE2<Sample_Int32>(out, outformat, in, count, scale, softclip);
+	case Sample_Float32: return ConvertTo_SSE2<Sample_Float32>(out, outformat, in, count, scale, softclip);
+	}
+}
+
+//==========================================================================
+//
+// AVX2
+//
+// Only the conversions the synths actually use are widened to 8 lanes,
+// everything else goes through the SSE2 version.
+//
+//==========================================================================
+
+TARGET_AVX2 static float DotProduct_AVX2(const float *a, const float *b, int count)
+{
+	__m256 sum = _mm256_setzero_ps();
+	for (int i = 0; i < count; i += 8)
+	{
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	}
+	__m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+	sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+	return _mm_cvtss_f32(sum4);
+}
+
+template<SampleFormat In, SampleFormat Out, bool SoftClip>
+TARGET_AVX2 static void Convert_AVX2(void *out, const void *in, int count, float scale)
+{
+	__m256 vscale = _mm256_set1_ps(scale);
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 v;
+		if constexpr (In == Sample_Int16)
+			v = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)((const int16_t *)in + i))));
+		else if constexpr (In == Sample_Int32)
+			v = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)((const int32_t *)in + i)));
+		else
+			v = _mm256_loadu_ps((const float *)in + i);
+
+		v = _mm256_mul_ps(v, vscale);
+		if constexpr (SoftClip)
+		{
+			v = _mm256_max_ps(_mm256_min_ps(v, _mm256_set1_ps(ClipLimit)), _mm256_set1_ps(-ClipLimit));
+			v = _mm256_sub_ps(v, _mm256_mul_ps(_mm256_set1_ps(ClipCubic), _mm256_mul_ps(v, _mm256_mul_ps(v, v))));
+		}
+
+		if constexpr (Out == Sample_Int16)
+		{
+			v = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(v, _mm256_set1_ps(32768.f)), _mm256_set1_ps(32767.f)), _mm256_set1_ps(-32768.f));
+			__m256i r = _mm256_cvtps_epi32(v);
+			_mm_storeu_si128((__m128i *)((int16_t *)out + i), _mm_packs_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1)));
+		}
+		else
+		{
+			_mm256_storeu_ps((float *)out + i, v);
+		}
+	}
+	Convert_SSE2<In, Out, SoftClip>((char *)out + i * (Out == Sample_Int16 ? 2 : 4), (const char *)in + i * (In == Sample_Int16 ? 2 : 4), count - i, scale);
+}
+
+template<SampleFormat In>
+static bool ConvertTo_AVX2(void *out, SampleFormat outformat, const void *in, int count, float scale, bool softclip)
+{
+	switch (outformat)
+	{
+	case Sample_Int16: softclip ? Convert_AVX2<In, Sample_Int16, true>(out, in, count, scale) : Convert_AVX2<In, Sample_Int16, false>(out, in, count, scale); return true;
+	case Sample_Float32: softclip ? Convert_AVX2<In, Sample_Float32, true>(out, in, count, scale) : Convert_AVX2<In, Sample_Float32, false>(out, in, count, scale); return true;
+	default: return false;
+	}
+}
+
+static void ConvertSamples_AVX2(void *out, SampleFormat outformat, const void *in, SampleFormat informat, int count, float scale, bool softclip)
+{
+	bool done = false;
+	switch (informat)
+	{
+	case Sample_Int16: done = ConvertTo_AVX2<Sample_Int16>(out, outformat, in, count, scale, softclip); break;
+	case Sample_Int32: done = ConvertTo_AVX2<Sample_Int32>(out, outformat, in, count, scale, softclip); break;
+	case Sample_Float32: done = ConvertTo_AVX2<Sample_Float32>(out, outformat, in, count, scale, softclip); break;
+	default: break;
+	}
+	if (!done) ConvertSamples_SSE2(out, outformat, in, informat, count, scale, softclip);
+}
+
+static bool CPUHasAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+#ifdef ZMUSIC_SIMD_NEON
+
+//==========================================================================
+//
+// NEON
+//
+//==========================================================================
+
+static float DotProduct_NEON(const float *a, const float *b, int count)
+{
+	float32x4_t sum0 = vdupq_n_f32(0);
+	float32x4_t sum1 = vdupq_n_f32(0);
+	for (int i = 0; i < count; i += 8)
+	{
+		sum0 = vaddq_f32(sum0, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+		sum1 = vaddq_f32(sum1, vmulq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4)));
+	}
+	sum0 = vaddq_f32(sum0, sum1);
+	float32x2_t sum2 = vadd_f32(vget_low_f32(sum0), vget_high_f32(sum0));
+	return vget_lane_f32(vpadd_f32(sum2, sum2), 0);
+}
+
+// Only float output is vectorized here since NEON's float to int conversion truncates.
+template<SampleFormat In, bool SoftClip>
+static void ConvertToFloat_NEON(float *out, const void *in, int count, float scale)
+{
+	float32x4_t vscale = vdupq_n_f32(scale);
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		float32x4_t v;
+		if constexpr (In == Sample_Int16)
+			v = vcvtq_f32_s32(vmovl_s16(vld1_s16((const int16_t *)in + i)));
+		else if constexpr (In == Sample_Int32)
+			v = vcvtq_f32_s32(vld1q_s32((const int32_t *)in + i));
+		else
+			v = vld1q_f32((const float *)in + i);
+
+		v = vmulq_f32(v, vscale);
+		if constexpr (SoftClip)
+		{
+			v = vmaxq_f32(vminq_f32(v, vdupq_n_f32(ClipLimit)), vdupq_n_f32(-ClipLimit));
+			v = vsubq_f32(v, vmulq_f32(vdupq_n_f32(ClipCubic), vmulq_f32(v, vmulq_f32(v, v))));
+		}
+		vst1q_f32(out + i, v);
+	}
+	ConvertSamples_C(out, Sample_Float32, in, In, i, count, scale, SoftClip);
+}
+
+static void ConvertSamples_NEON(void *out, SampleFormat outformat, const void *in, SampleFormat informat, int count, float scale, bool softclip)
+{
+	if (outformat == Sample_Float32)
+	{
+		switch (informat)
+		{
+		case Sample_Int16: return softclip ? ConvertToFloat_NEON<Sample_Int16, true>((float *)out, in, count, scale) : ConvertToFloat_NEON<Sample_Int16, false>((float *)out, in, count, scale);
+		case Sample_Int32: return softclip ? ConvertToFloat_NEON<Sample_Int32, true>((float *)out, in, count, scale) : ConvertToFloat_NEON<Sample_Int32, false>((float *)out, in, count, scale);
+		case Sample_Float32: return softclip ? ConvertToFloat_NEON<Sample_Float32, true>((float *)out, in, count, scale) : ConvertToFloat_NEON<Sample_Float32, false>((float *)out, in, count, scale);
+		default: break;
+		}
+	}
+	ConvertSamples_C(out, outformat, in, informat, 0, count, scale, softclip);
+}
+
+#endif
+
+#if !defined(ZMUSIC_SIMD_SSE2) && !defined(ZMUSIC_SIMD_NEON)
+
+static void ConvertSamples_Scalar(void *out, SampleFormat outformat, const void *in, SampleFormat informat, int count, float scale, bool softclip)
+{
+	ConvertSamples_C(out, outformat, in, informat, 0, count, scale, softclip);
+}
+
+#endif
+
+//==========================================================================
+//
+// Dispatch
+//
+//==========================================================================
+
+struct Kernels
+{
+	const char *Name;
+	float (*DotProduct)(const float *a, const float *b, int count);
+	void (*ConvertSamples)(void *out, SampleFormat outformat, const void *in, SampleFormat informat, int count, float scale, bool softclip);
+};
+
+static Kernels SelectKernels()
+{
+#ifdef ZMUSIC_SIMD_SSE2
+	if (CPUHasAVX2()) return { "AVX2", DotProduct_AVX2, ConvertSamples_AVX2 };
+	return { "SSE2", DotProduct_SSE2, ConvertSamples_SSE2 };
+#elif defined(ZMUSIC_SIMD_NEON)
+	return { "NEON", DotProduct_NEON, ConvertSamples_NEON };
+#else
+	return { "C", DotProduct_C, ConvertSamples_Scalar };
+#endif
+}
+
+static const Kernels &Get()
+{
+	static const Kernels kernels = SelectKernels();
+	return kernels;
+}
+
+float DotProduct(const float *a, const float *b, int count)
+{
+	return Get().DotProduct(a, b, count);
+}
+
+void ConvertSamples(void *out, SampleFormat outformat, const void *in, SampleFormat informat, int count, float gain, bool softclip)
+{
+	if (count <= 0) return;
+	Get().ConvertSamples(out, outformat, in, informat, count, gain * InputScale(informat), softclip);
+}
+
+const char *InstructionSet()
+{
+	return Get().Name;
+}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// Runtime dispatched SIMD kernels shared by the audio processing stages.
+// The best implementation for the CPU gets picked the first time one of these is used.
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define ZMUSIC_SIMD_SSE2
+#endif
+#if defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define ZMUSIC_SIMD_NEON
+#endif
+
+namespace SIMD
+{
+	enum SampleFormat
+	{
+		Sample_UInt8,
+		Sample_Int16,
+		Sample_Int32,
+		Sample_Float32,
+	};
+
+	// Returns the sum of a[i] * b[i]. count must be a multiple of 8.
+	float DotProduct(const float *a, const float *b, int count);
+
+	// Converts count samples in one pass, multiplying them by gain. Integer input is normalized to [-1, 1) first
+	// and integer output saturates. With softclip set the signal gets gently compressed towards +/-1 before being stored.
+	// in and out may be the same buffer if both formats have the same size.
+	void ConvertSamples(void *out, SampleFormat outformat, const void *in, SampleFormat informat, int count, float gain, bool softclip = false);
+
+	// Name of the instruction set that is being used, for stats output.
+	const char *InstructionSet();
+}
@@ -0,0 +1,163 @@
+/*
+** songcache.cpp
+** content addressed cache for song files
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <list>
+#include <map>
+#include "songcache.h"
+
+namespace
+{
+	struct Cache
+	{
+		struct Entry
+		{
+			SongCache::Key Key;
+			std::shared_ptr<CachedSong> Song;
+		};
+
+		std::mutex Mutex;
+		size_t Budget = 0;
+		std::list<Entry> Entries;	// most recently used first.
+		std::map<SongCache::Key, std::list<Entry>::iterator> Index;
+	};
+
+	Cache cache;
+
+	size_t EntrySize(CachedSong &song)
+	{
+		std::lock_guard<std::mutex> lock(song.ParsedMutex);
+		return song.Data.size() + song.Packed.size() + song.ParsedSize;
+	}
+
+	// Discards the least recently used entries until everything fits. Songs that are still playing keep their entry alive.
+	void TrimLocked()
+	{
+		size_t total = 0;
+		for (auto &entry : cache.Entries)
+		{
+			total += EntrySize(*entry.Song);
+		}
+		while (total > cache.Budget && !cache.Entries.empty())
+		{
+			auto &entry = cache.Entries.back();
+			total -= EntrySize(*entry.Song);
+			cache.Index.erase(entry.Key);
+			cache.Entries.pop_back();
+		}
+	}
+}
+
+//==========================================================================
+//
+// HashData
+//
+// 64 bit FNV-1a
+//
+//==========================================================================
+
+uint64_t HashData(const uint8_t *data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ data[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+namespace SongCache
+{
+
+//==========================================================================
+//
+// SongCache :: SetBudget
+//
+//==========================================================================
+
+void SetBudget(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(cache.Mutex);
+	cache.Budget = bytes;
+	TrimLocked();
+}
+
+bool IsEnabled()
+{
+	std::lock_guard<std::mutex> lock(cache.Mutex);
+	return cache.Budget > 0;
+}
+
+bool Fits(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(cache.Mutex);
+	return bytes <= cache.Budget;
+}
+
+//==========================================================================
+//
+// SongCache :: Find
+//
+//==========================================================================
+
+std::shared_ptr<CachedSong> Find(const Key &key)
+{
+	std::lock_guard<std::mutex> lock(cache.Mutex);
+	auto it = cache.Index.find(key);
+	if (it == cache.Index.end()) return nullptr;
+	cache.Entries.splice(cache.Entries.begin(), cache.Entries, it->second);
+	return it->second->Song;
+}
+
+//==========================================================================
+//
+// SongCache :: Insert
+//
+//==========================================================================
+
+void Insert(const Key &key, std::shared_ptr<CachedSong> song)
+{
+	std::lock_guard<std::mutex> lock(cache.Mutex);
+	if (cache.Index.count(key) || EntrySize(*song) > cache.Budget) return;
+	cache.Entries.push_front({ key, std::move(song) });
+	cache.Index[key] = cache.Entries.begin();
+	TrimLocked();
+}
+
+void Trim()
+{
+	std::lock_guard<std::mutex> lock(cache.Mutex);
+	TrimLocked();
+}
+
+}
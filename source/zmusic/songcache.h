@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "fileio.h"
+
+// A process wide cache of song files, keyed by a hash of their content, so that reopening a song neither
+// has to read nor decompress it again. Players whose loaded representation does not change during playback
+// can attach it to the entry, and all songs opened from it then share it instead of loading it again.
+// The cache is off unless zmusic_snd_songcache sets a memory budget for it.
+
+struct CachedSong
+{
+	std::vector<uint8_t> Data;		// decompressed file content. Never changes once the entry is in the cache.
+	std::vector<uint8_t> Packed;	// the file as passed in if it was compressed, for checking hits against.
+
+	std::mutex ParsedMutex;			// guards the two fields below.
+	std::shared_ptr<void> Parsed;	// must not get modified by the players that use it.
+	size_t ParsedSize = 0;
+};
+
+// Reads from a cache entry and keeps it alive after it got evicted, for players that stream from the reader.
+struct CachedSongReader : public MusicIO::MemoryReader
+{
+	std::shared_ptr<CachedSong> Song;
+
+	CachedSongReader(std::shared_ptr<CachedSong> song) : MemoryReader(song->Data.data(), (long)song->Data.size()), Song(std::move(song)) {}
+};
+
+uint64_t HashData(const uint8_t *data, size_t size);
+
+namespace SongCache
+{
+	using Key = std::pair<uint64_t, size_t>;	// hash and size of the file as it was passed in, before decompression. The hash is not collision resistant, so hits must be checked against the data.
+
+	inline Key MakeKey(const uint8_t *data, size_t size) { return Key(HashData(data, size), size); }
+
+	void SetBudget(size_t bytes);
+	bool IsEnabled();
+	// Whether an entry of this size could be kept at all.
+	bool Fits(size_t bytes);
+
+	// Returns nullptr if there's no entry for this key, otherwise it becomes the most recently used one.
+	std::shared_ptr<CachedSong> Find(const Key &key);
+	// Entries that are larger than the budget on their own are not kept.
+	void Insert(const Key &key, std::shared_ptr<CachedSong> song);
+	// Call after attaching parsed data to an entry, so that it is accounted for.
+	void Trim();
+}
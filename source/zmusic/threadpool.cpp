@@ -0,0 +1,198 @@
+/*
+** threadpool.cpp
+** Fixed size worker pool for parallel rendering
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <algorithm>
+#include "threadpool.h"
+
+//==========================================================================
+//
+// WorkerPool Constructor
+//
+// A thread count of 0 or less picks one thread per hardware thread.
+//
+//==========================================================================
+
+WorkerPool::WorkerPool(int numthreads)
+{
+	if (numthreads <= 0) numthreads = DefaultThreadCount();
+	for (int i = 1; i < numthreads; i++)
+	{
+		Threads.emplace_back(&WorkerPool::WorkerMain, this);
+	}
+}
+
+//==========================================================================
+//
+// WorkerPool Destructor
+//
+//==========================================================================
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Quit = true;
+	}
+	Wakeup.notify_all();
+	for (auto &thread : Threads)
+	{
+		thread.join();
+	}
+}
+
+//==========================================================================
+//
+// WorkerPool :: DefaultThreadCount									static
+//
+//==========================================================================
+
+int WorkerPool::DefaultThreadCount()
+{
+	unsigned count = std::thread::hardware_concurrency();
+	return count == 0 ? 1 : (int)count;
+}
+
+//==========================================================================
+//
+// WorkerPool :: Shared												static
+//
+//==========================================================================
+
+WorkerPool &WorkerPool::Shared()
+{
+	static WorkerPool pool(0);
+	return pool;
+}
+
+//==========================================================================
+//
+// WorkerPool :: Work
+//
+// Grabs jobs from the batch until there are none left.
+//
+//==========================================================================
+
+void WorkerPool::Work(Batch &batch)
+{
+	int index;
+	while ((index = batch.NextJob.fetch_add(1)) < batch.Count)
+	{
+		try
+		{
+			(*batch.Job)(index);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			if (!batch.Error) batch.Error = std::current_exception();
+		}
+	}
+}
+
+//==========================================================================
+//
+// WorkerPool :: Remove
+//
+// Takes a batch that has no more jobs to hand out off the queue, so that
+// the workers move on to the next one. Mutex must be held.
+//
+//==========================================================================
+
+void WorkerPool::Remove(Batch &batch)
+{
+	auto it = std::find(Batches.begin(), Batches.end(), &batch);
+	if (it != Batches.end()) Batches.erase(it);
+}
+
+//==========================================================================
+//
+// WorkerPool :: WorkerMain
+//
+//==========================================================================
+
+void WorkerPool::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	for (;;)
+	{
+		Wakeup.wait(lock, [&] { return Quit || !Batches.empty(); });
+		if (Quit) return;
+		Batch &batch = *Batches.front();
+		batch.Helpers++;
+		lock.unlock();
+		Work(batch);
+		lock.lock();
+		Remove(batch);
+		if (--batch.Helpers == 0) Finished.notify_all();
+	}
+}
+
+//==========================================================================
+//
+// WorkerPool :: Run
+//
+// The caller works on its own batch too, so every call makes progress
+// even when all workers are busy with other calls.
+//
+//==========================================================================
+
+void WorkerPool::Run(int count, const std::function<void(int)> &job)
+{
+	if (count <= 0) return;
+	if (Threads.empty() || count == 1)
+	{
+		for (int i = 0; i < count; i++) job(i);
+		return;
+	}
+
+	Batch batch;
+	batch.Job = &job;
+	batch.Count = count;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Batches.push_back(&batch);
+	}
+	Wakeup.notify_all();
+	Work(batch);
+
+	std::exception_ptr error;
+	{
+		// Workers may still be running jobs from this batch, and it must not go away before they have let go of it.
+		std::unique_lock<std::mutex> lock(Mutex);
+		Remove(batch);
+		Finished.wait(lock, [&] { return batch.Helpers == 0; });
+		error = batch.Error;
+	}
+	if (error) std::rethrow_exception(error);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed size pool of worker threads for splitting render work into independent jobs.
+// The thread calling Run participates in the work, so a pool for N parallel jobs only needs N-1 workers.
+
+class WorkerPool
+{
+public:
+	WorkerPool(int numthreads);
+	~WorkerPool();
+
+	// Calls job(0) ... job(count-1) in parallel and returns when all of them are done.
+	// If a job throws, the first exception gets rethrown on the calling thread.
+	// Several threads may call this at the same time. The workers serve the calls in order.
+	void Run(int count, const std::function<void(int)> &job);
+	int NumThreads() const { return (int)Threads.size() + 1; }
+
+	static int DefaultThreadCount();
+
+	// Process wide pool for spreading a single song's work, e.g. its emulated chips, over the cores.
+	static WorkerPool &Shared();
+
+private:
+	// The jobs of one Run call. Lives on the caller's stack.
+	struct Batch
+	{
+		const std::function<void(int)> *Job;
+		int Count;
+		std::atomic<int> NextJob{ 0 };
+		int Helpers = 0;			// workers inside Work for this batch, guarded by Mutex.
+		std::exception_ptr Error;	// guarded by Mutex.
+	};
+
+	void WorkerMain();
+	void Work(Batch &batch);
+	void Remove(Batch &batch);
+
+	std::vector<std::thread> Threads;
+	std::mutex Mutex;
+	std::condition_variable Wakeup;
+	std::condition_variable Finished;
+
+	std::vector<Batch *> Batches;	// Run calls that may still have jobs to hand out, oldest first.
+	bool Quit = false;
+};
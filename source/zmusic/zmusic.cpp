@@ -34,27 +34,29 @@
  */
 
 #include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
 #include <vector>
 #include <string>
-#include <miniz.h>
 #include "m_swap.h"
 #include "zmusic_internal.h"
 #include "midiconfig.h"
 #include "musinfo.h"
+#include "renderahead.h"
 #include "streamsources/streamsource.h"
 #include "midisources/midisource.h"
 #include "critsec.h"
+#include "songcache.h"
 
 #define GZIP_ID1		31
 #define GZIP_ID2		139
 #define GZIP_CM			8
-#define GZIP_ID			MAKE_ID(GZIP_ID1,GZIP_ID2,GZIP_CM,0)
-
-#define GZIP_FTEXT		1
-#define GZIP_FHCRC		2
-#define GZIP_FEXTRA		4
-#define GZIP_FNAME		8
-#define GZIP_FCOMMENT	16
 
 class MIDIDevice;
 class OPLmusicFile;
@@ -62,87 +64,235 @@ class StreamSource;
 class MusInfo;
 
 MusInfo *OpenStreamSong(StreamSource *source);
-const char *GME_CheckFormat(uint32_t header);
 MusInfo* CDDA_OpenSong(MusicIO::FileInterface* reader);
 MusInfo* CD_OpenSong(int track, int id);
 MusInfo* CreateMIDIStreamer(MIDISource *source, EMidiDevice devtype, const char* args);
 
 //==========================================================================
 //
-// ungzip
+// The formats that can be opened from a file, in order of precedence for
+// equally good matches. Each one rates the file's header with its probe
+// function and the best candidates get opened first, so that a file only
+// gets read up to the player that can handle it.
 //
-// VGZ files are compressed with gzip, so we need to uncompress them before
-// handing them to GME.
+// The open function may take over the reader and must set it to null then.
+// If it does so, a failure is final and the error has already been set.
 //
 //==========================================================================
 
-static bool ungzip(uint8_t *data, int complen, std::vector<uint8_t> &newdata)
+struct SongFormat
 {
-	const uint8_t *max = data + complen - 8;
-	const uint8_t *compstart = data + 10;
-	uint8_t flags = data[3];
-	unsigned isize;
-	z_stream stream;
-	int err;
-	
-	// Find start of compressed data stream
-	if (flags & GZIP_FEXTRA)
-	{
-		compstart += 2 + LittleShort(*(uint16_t *)(data + 10));
-	}
-	if (flags & GZIP_FNAME)
-	{
-		while (compstart < max && *compstart != 0)
-		{
-			compstart++;
-		}
-	}
-	if (flags & GZIP_FCOMMENT)
+	int (*Probe)(const SongHeader &header);
+	MusInfo *(*Open)(MusicIO::FileInterface *&reader, const SongHeader &header, EMidiDevice device, const char *Args);
+};
+
+// The MUS header search only looks at the first 32 bytes, like it always did, so that it doesn't find false positives inside other formats.
+static int MIDI_Probe(const SongHeader &header)
+{
+	return ZMusic_IdentifyMIDIType((uint32_t*)header.data, 32) != MIDI_NOTMIDI ? PROBE_MAGIC : PROBE_NO;
+}
+
+static MusInfo *MIDI_Open(MusicIO::FileInterface *&reader, const SongHeader &header, EMidiDevice device, const char *Args)
+{
+	EMIDIType miditype = ZMusic_IdentifyMIDIType((uint32_t*)header.data, 32);
+
+	// The MIDI sources make their own copy of the data, so there's no need for an intermediate one if the reader is memory based.
+	std::vector<uint8_t> data;
+	const uint8_t* mididata = reader->memory();
+	size_t midisize = reader->filelength();
+	if (mididata == nullptr)
 	{
-		while (compstart < max && *compstart != 0)
+		data.resize(midisize);
+		if (reader->read(data.data(), (long)data.size()) != (long)data.size())
 		{
-			compstart++;
+			SetError("Failed to read MIDI data");
+			reader->close();
+			reader = nullptr;
+			return nullptr;
 		}
+		mididata = data.data();
 	}
-	if (flags & GZIP_FHCRC)
+	auto source = ZMusic_CreateMIDISource(mididata, midisize, miditype);
+	reader->close();
+	reader = nullptr;
+	if (source == nullptr)
 	{
-		compstart += 2;
+		return nullptr;
 	}
-	if (compstart >= max - 1)
+	if (!source->isValid())
 	{
-		return false;
+		SetError("Invalid data in MIDI file");
+		delete source;
+		return nullptr;
 	}
-	
-	// Decompress
-	isize = LittleLong(*(uint32_t *)(data + complen - 4));
-	newdata.resize(isize);
-	
-	stream.next_in = (Bytef *)compstart;
-	stream.avail_in = (uInt)(max - compstart);
-	stream.next_out = &newdata[0];
-	stream.avail_out = isize;
-	stream.zalloc = (alloc_func)0;
-	stream.zfree = (free_func)0;
-	
-	err = inflateInit2(&stream, -MAX_WBITS);
-	if (err != Z_OK)
+
+#ifndef HAVE_SYSTEM_MIDI
+	// some platforms don't support MDEV_STANDARD so map to MDEV_SNDSYS
+	if (device == MDEV_STANDARD)
+		device = MDEV_SNDSYS;
+#endif
+
+	return CreateMIDIStreamer(source, device, Args? Args : "");
+}
+
+static int CDDA_Probe(const SongHeader &header)
+{
+	bool iscdda = header.size >= 12 && !memcmp(header.data, "RIFF", 4) && !memcmp(header.data + 8, "CDDA", 4);
+	return iscdda ? PROBE_MAGIC : PROBE_NO;
+}
+
+static MusInfo *CDDA_Open(MusicIO::FileInterface *&reader, const SongHeader &header, EMidiDevice device, const char *Args)
+{
+	return CDDA_OpenSong(reader);
+}
+
+#ifdef HAVE_OPL
+static MusInfo *OPL_Open(MusicIO::FileInterface *&reader, const SongHeader &header, EMidiDevice device, const char *Args)
+{
+	return OpenStreamSong(OPL_OpenSong(reader, &currentContext->oplConfig));
+}
+#endif
+
+static MusInfo *XA_Open(MusicIO::FileInterface *&reader, const SongHeader &header, EMidiDevice device, const char *Args)
+{
+	auto streamsource = XA_OpenSong(reader);	// this takes over the reader.
+	reader = nullptr;							// We do not own this anymore.
+	return OpenStreamSong(streamsource);
+}
+
+static MusInfo *GME_Open(MusicIO::FileInterface *&reader, const SongHeader &header, EMidiDevice device, const char *Args)
+{
+	auto streamsource = GME_OpenSong(reader, GME_Format(header), currentContext->miscConfig.snd_outputrate);
+	return streamsource ? OpenStreamSong(streamsource) : nullptr;
+}
+
+static MusInfo *XMP_Open(MusicIO::FileInterface *&reader, const SongHeader &header, EMidiDevice device, const char *Args)
+{
+	auto streamsource = XMP_OpenSong(reader, currentContext->miscConfig.snd_outputrate);
+	return streamsource ? OpenStreamSong(streamsource) : nullptr;
+}
+
+static MusInfo *MOD_Open(MusicIO::FileInterface *&reader, const SongHeader &header, EMidiDevice device, const char *Args)
+{
+	auto streamsource = MOD_OpenSong(reader, currentContext->miscConfig.snd_outputrate, header.cache);
+	return streamsource ? OpenStreamSong(streamsource) : nullptr;
+}
+
+static MusInfo *SndFile_Open(MusicIO::FileInterface *&reader, const SongHeader &header, EMidiDevice device, const char *Args)
+{
+	auto streamsource = SndFile_OpenSong(reader);		// this only takes over the reader if it succeeds. We need to look out for this.
+	if (streamsource == nullptr) return nullptr;
+	reader = nullptr;
+	return OpenStreamSong(streamsource);
+}
+
+static const SongFormat SongFormats[] =
+{
+	{ MIDI_Probe, MIDI_Open },
+	{ CDDA_Probe, CDDA_Open },
+#ifdef HAVE_OPL
+	{ OPL_Probe, OPL_Open },
+#endif
+	{ XA_Probe, XA_Open },
+	{ GME_Probe, GME_Open },
+	{ XMP_Probe, XMP_Open },		// XMP and DUMB swap places if the calling app prefers DUMB.
+	{ MOD_Probe, MOD_Open },
+	{ SndFile_Probe, SndFile_Open },
+};
+
+//==========================================================================
+//
+// GetExtension
+//
+// Lower case and without the dot. A trailing .gz gets skipped for
+// compressed files.
+//
+//==========================================================================
+
+static std::string GetExtension(const std::string &filename, bool gzipped)
+{
+	auto name = filename.substr(filename.find_last_of("/\\") + 1);
+	auto dot = name.find_last_of('.');
+	if (dot == std::string::npos) return "";
+	std::string ext = name.substr(dot + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+	if (gzipped && ext == "gz") return GetExtension(name.substr(0, dot), false);
+	return ext;
+}
+
+//==========================================================================
+//
+// OpenCachedSong
+//
+// Swaps the reader for one that reads from the song cache, after adding
+// the song to it if it isn't in there yet. Compressed songs get stored
+// decompressed, along with the original for telling hash collisions
+// apart. If this fails, the reader is left alone. Files that are too
+// large for the cache don't get read in the first place.
+//
+//==========================================================================
+
+static std::shared_ptr<CachedSong> OpenCachedSong(MusicIO::FileInterface *&reader, bool gzipped)
+{
+	long size = reader->filelength();
+	if (size <= 0 || !SongCache::Fits(size)) return nullptr;
+
+	std::vector<uint8_t> buffer;
+	const uint8_t *data = reader->memory();
+	if (data == nullptr)
 	{
-		return false;
+		buffer.resize(size);
+		bool ok = reader->read(buffer.data(), size) == size;
+		reader->seek(0, SEEK_SET);
+		if (!ok) return nullptr;
+		data = buffer.data();
 	}
-	err = inflate(&stream, Z_FINISH);
-	if (err != Z_STREAM_END)
+
+	auto key = SongCache::MakeKey(data, size);
+	auto song = SongCache::Find(key);
+	if (song != nullptr)
 	{
-		inflateEnd(&stream);
-		return false;
+		// Another file with the same hash must not get the cached song's data.
+		auto &original = gzipped ? song->Packed : song->Data;
+		if (original.size() != size_t(size) || memcmp(original.data(), data, size) != 0) return nullptr;
 	}
-	err = inflateEnd(&stream);
-	if (err != Z_OK)
+	else
 	{
-		return false;
+		song = std::make_shared<CachedSong>();
+		if (gzipped)
+		{
+			auto mreader = new MusicIO::MemoryReader(data, size);
+			auto zreader = MusicIO::OpenGzipReader(mreader);
+			if (zreader == nullptr)
+			{
+				// The reader stays with the caller if this fails.
+				mreader->close();
+				return nullptr;
+			}
+			song->Data.resize(zreader->filelength());
+			bool ok = zreader->read(song->Data.data(), (long)song->Data.size()) == (long)song->Data.size();
+			zreader->close();
+			if (!ok) return nullptr;
+			if (!buffer.empty()) song->Packed = std::move(buffer);
+			else song->Packed.assign(data, data + size);
+		}
+		else if (!buffer.empty())
+		{
+			song->Data = std::move(buffer);
+		}
+		else
+		{
+			song->Data.assign(data, data + size);
+		}
+		SongCache::Insert(key, song);
 	}
-	return true;
-}
 
+	auto filename = std::move(reader->filename);
+	reader->close();
+	reader = new CachedSongReader(song);
+	reader->filename = std::move(filename);
+	return song;
+}
 
 //==========================================================================
 //
@@ -150,177 +300,100 @@ static bool ungzip(uint8_t *data, int complen, std::vector<uint8_t> &newdata)
 //
 //==========================================================================
 
-static  MusInfo *ZMusic_OpenSongInternal (MusicIO::FileInterface *reader, EMidiDevice device, const char *Args)
+static  MusInfo *ZMusic_OpenSongInternal (MusicIO::FileInterface *reader, EMidiDevice device, const char *Args, bool cacheable = true)
 {
 	MusInfo *info = nullptr;
-	StreamSource *streamsource = nullptr;
-	const char *fmt;
-	uint32_t id[32/4];
+	uint32_t id[2048/4];	// aligned for the MIDI check.
+	uint8_t *header = (uint8_t *)id;
+	long headsize = 0;
+	auto ReadHeader = [&]()
+	{
+		headsize = std::min<long>(sizeof(id), reader->filelength());
+		if (headsize < 32 || reader->read(header, headsize) != headsize || reader->seek(0, SEEK_SET) != 0)
+		{
+			SetError("Unable to read header");
+			reader->close();
+			return false;
+		}
+		return true;
+	};
 	
-	if(reader->read(id, 32) != 32 || reader->seek(-32, SEEK_CUR) != 0)
+	if (!ReadHeader())
 	{
-		SetError("Unable to read header");
-		reader->close();
 		return nullptr;
 	}
 	try
 	{
+		std::string filename = reader->filename;
+		bool gzipped = header[0] == GZIP_ID1 && header[1] == GZIP_ID2 && header[2] == GZIP_CM;
+		std::shared_ptr<CachedSong> cached;
+
+		if (cacheable && SongCache::IsEnabled() && (cached = OpenCachedSong(reader, gzipped)) != nullptr)
+		{
+			if (gzipped && !ReadHeader()) return nullptr;
+		}
 		// Check for gzip compression. Some formats are expected to have players
 		// that can handle it, so it simplifies things if we make all songs
 		// gzippable.
-		if ((id[0] & MAKE_ID(255, 255, 255, 0)) == GZIP_ID)
+		else if (gzipped)
 		{
-			// swap out the reader with one that reads the decompressed content.
-			auto zreader = new MusicIO::VectorReader([reader](std::vector<uint8_t>& array)
-													 {
-														 bool res = false;
-														 auto len = reader->filelength();
-														 uint8_t* gzipped = new uint8_t[len];
-														 if (reader->read(gzipped, len) == len)
-														 {
-															 res = ungzip(gzipped, (int)len, array);
-														 }
-														 delete[] gzipped;
-													 });
-			reader->close();
-			reader = zreader;
-			
-			
-			if (reader->read(id, 32) != 32 || reader->seek(-32, SEEK_CUR) != 0)
+			// swap out the reader with one that decompresses the content while it is being read.
+			auto zreader = MusicIO::OpenGzipReader(reader);
+			if (zreader == nullptr)
 			{
+				SetError("Invalid gzip data");
 				reader->close();
 				return nullptr;
 			}
-		}
-		
-		EMIDIType miditype = ZMusic_IdentifyMIDIType(id, sizeof(id));
-		if (miditype != MIDI_NOTMIDI)
-		{
-			std::vector<uint8_t> data(reader->filelength());
-			if (reader->read(data.data(), (long)data.size()) != (long)data.size())
-			{
-				SetError("Failed to read MIDI data");
-				reader->close();
-				return nullptr;
-			}
-			auto source = ZMusic_CreateMIDISource(data.data(), data.size(), miditype);
-			if (source == nullptr)
-			{
-				reader->close();
-				return nullptr;
-			}
-			if (!source->isValid())
+			reader = zreader;
+
+			if (!ReadHeader())
 			{
-				SetError("Invalid data in MIDI file");
-				delete source;
 				return nullptr;
 			}
+		}
 
-#ifndef HAVE_SYSTEM_MIDI
-			// some platforms don't support MDEV_STANDARD so map to MDEV_SNDSYS
-			if (device == MDEV_STANDARD)
-				device = MDEV_SNDSYS;
-#endif
-			
-			info = CreateMIDIStreamer(source, device, Args? Args : "");
+		std::string ext = GetExtension(filename, gzipped);
+		SongHeader songheader = { header, (size_t)headsize, reader->filelength(), ext.c_str(), reader, cached.get() };
+
+		// Rate the file for every format in one go, then try the candidates from the best match down.
+		const int numformats = int(sizeof(SongFormats) / sizeof(SongFormats[0]));
+		const SongFormat *order[numformats];
+		int ratings[numformats];
+		int count = 0;
+
+		for (auto &format : SongFormats)
+		{
+			order[count++] = &format;
 		}
-		
-		// Check for CDDA "format"
-		else if ((id[0] == MAKE_ID('R', 'I', 'F', 'F') && id[2] == MAKE_ID('C', 'D', 'D', 'A')))
+		// give the calling app an option to select between XMP and DUMB.
+		if (currentContext->dumbConfig.mod_preferred_player != 0)
 		{
-			// This is a CDDA file
-			info = CDDA_OpenSong(reader);
+			auto xmp = std::find_if(order, order + count, [](const SongFormat *f) { return f->Probe == XMP_Probe; });
+			auto dumb = std::find_if(order, order + count, [](const SongFormat *f) { return f->Probe == MOD_Probe; });
+			std::iter_swap(xmp, dumb);
 		}
-		
-		// Check for various raw OPL formats
-		else
+		for (int i = 0; i < count; i++)
 		{
-#ifdef HAVE_OPL
-			if (
-				(id[0] == MAKE_ID('R', 'A', 'W', 'A') && id[1] == MAKE_ID('D', 'A', 'T', 'A')) ||		// Rdos Raw OPL
-				(id[0] == MAKE_ID('D', 'B', 'R', 'A') && id[1] == MAKE_ID('W', 'O', 'P', 'L')) ||		// DosBox Raw OPL
-				(id[0] == MAKE_ID('A', 'D', 'L', 'I') && *((uint8_t*)id + 4) == 'B'))		// Martin Fernandez's modified IMF
-			{
-				streamsource = OPL_OpenSong(reader, &oplConfig);
+			ratings[order[i] - SongFormats] = order[i]->Probe(songheader);
+		}
+		std::stable_sort(order, order + count, [&](const SongFormat *a, const SongFormat *b) { return ratings[a - SongFormats] > ratings[b - SongFormats]; });
 
-			}
-			else 
-#endif
-				if ((id[0] == MAKE_ID('R', 'I', 'F', 'F') && id[2] == MAKE_ID('C', 'D', 'X', 'A')))
-			{
-				streamsource = XA_OpenSong(reader);	// this takes over the reader.
-				reader = nullptr;					// We do not own this anymore.
-			}
-			// Check for game music
-			else if ((fmt = GME_CheckFormat(id[0])) != nullptr && fmt[0] != '\0')
-			{
-				streamsource = GME_OpenSong(reader, fmt, miscConfig.snd_outputrate);
-			}
-			// Check for module formats not supported by XMP
-			else if ((id[0] == MAKE_ID('R', 'I', 'F', 'F') && id[2] == MAKE_ID('D', 'S', 'M', 'F')))
-			{
-				streamsource = MOD_OpenSong(reader, miscConfig.snd_outputrate);
-			}
-			// Everything else is trial and error. Try both players successively, the first one that succeeds wins.
-			else
-			{
-					// XMP does not play mptm right, so force DUMB for that.
-					auto CheckMPTM = [&]()
-						{
-							bool ret = false;
-							if (id[0] == MAKE_ID('I', 'M', 'P', 'M'))
-							{
-								int chki = -1;
-								char chk[8] = "";
-								auto pos = reader->tell();
-								reader->seek(-4, SEEK_END);
-								reader->read(&chki, 8);
-								auto length = reader->tell();
-								chki = LittleLong(chki);
-								if (chki >= 4 && (chki < length - 4 || chki < 0))
-								{
-									reader->seek(chki, SEEK_SET);
-									reader->read(chk, 8);
-									ret = !memcmp(chk, "228\4mptm", 8);
-
-								}
-								reader->seek(pos, SEEK_SET);
-							}
-							return ret;
-						};
-				// give the calling app an option to select between XMP and DUMB.
-				if (dumbConfig.mod_preferred_player != 0 || CheckMPTM())
-				{
-					streamsource = MOD_OpenSong(reader, miscConfig.snd_outputrate);
-				}
-				if (!streamsource)
-				{
-					reader->seek(0, SEEK_SET);
-					streamsource = XMP_OpenSong(reader, miscConfig.snd_outputrate);
-					if (!streamsource && dumbConfig.mod_preferred_player == 0)
-					{
-						reader->seek(0, SEEK_SET);
-						streamsource = MOD_OpenSong(reader, miscConfig.snd_outputrate);
-					}
-				}
-			}
-			if (streamsource == nullptr)
-			{
-				streamsource = SndFile_OpenSong(reader);		// this only takes over the reader if it succeeds. We need to look out for this.
-				if (streamsource != nullptr) reader = nullptr;
-			}
-			
-			if (streamsource)
-			{
-				info = OpenStreamSong(streamsource);
-			}
+		for (int i = 0; i < count && ratings[order[i] - SongFormats] != PROBE_NO; i++)
+		{
+			reader->seek(0, SEEK_SET);
+			info = order[i]->Open(reader, songheader, device, Args);
+			if (info != nullptr || reader == nullptr) break;
 		}
-		
+
 		if (!info)
 		{
-			// File could not be identified as music.
-			if (reader) reader->close();
-			SetError("Unable to identify as music");
+			// File could not be identified as music, unless the player that took over the reader already said what went wrong.
+			if (reader)
+			{
+				reader->close();
+				SetError("Unable to identify as music");
+			}
 			return nullptr;
 		}
 		
@@ -350,9 +423,9 @@ DLL_EXPORT ZMusic_MusicStream ZMusic_OpenSongFile(const char* filename, EMidiDev
 		SetError("File not found");
 		return nullptr;
 	}
-	auto fr = new MusicIO::StdioFileReader;
-	fr->f = f;
-	return ZMusic_OpenSongInternal(fr, device, Args);
+	auto reader = MusicIO::OpenFileReader(f);
+	reader->filename = filename;	// for the extension, as a hint for formats without a signature.
+	return ZMusic_OpenSongInternal(reader, device, Args);
 }
 
 DLL_EXPORT ZMusic_MusicStream ZMusic_OpenSongMem(const void* mem, size_t size, EMidiDevice device, const char* Args)
@@ -367,6 +440,19 @@ DLL_EXPORT ZMusic_MusicStream ZMusic_OpenSongMem(const void* mem, size_t size, E
 	return ZMusic_OpenSongInternal(mr, device, Args);
 }
 
+DLL_EXPORT ZMusic_MusicStream ZMusic_OpenSongMemNoCopy(const void* mem, size_t size, void (*release)(void* userdata), void* userdata, EMidiDevice device, const char* Args)
+{
+	if (!mem || !size)
+	{
+		if (release) release(userdata);
+		SetError("Invalid data");
+		return nullptr;
+	}
+	// Closing the reader calls the release function. This happens once the song got loaded, unless the player streams from the reader.
+	auto mr = new ReleasingMemoryReader((const uint8_t*)mem, (long)size, release, userdata);
+	return ZMusic_OpenSongInternal(mr, device, Args);
+}
+
 DLL_EXPORT ZMusic_MusicStream ZMusic_OpenSong(ZMusicCustomReader* reader, EMidiDevice device, const char* Args)
 {
 	if (!reader)
@@ -378,6 +464,321 @@ DLL_EXPORT ZMusic_MusicStream ZMusic_OpenSong(ZMusicCustomReader* reader, EMidiD
 	return ZMusic_OpenSongInternal(cr, device, Args);
 }
 
+//==========================================================================
+//
+// The song gets bound to the context it gets opened with.
+//
+//==========================================================================
+
+DLL_EXPORT ZMusic_MusicStream ZMusic_OpenSongCtx(ZMusicContext* ctx, ZMusicCustomReader* reader, EMidiDevice device, const char* Args)
+{
+	ZMusicContextScope scope(ctx ? ctx : &defaultContext);
+	return ZMusic_OpenSong(reader, device, Args);
+}
+
+DLL_EXPORT ZMusic_MusicStream ZMusic_OpenSongFileCtx(ZMusicContext* ctx, const char* filename, EMidiDevice device, const char* Args)
+{
+	ZMusicContextScope scope(ctx ? ctx : &defaultContext);
+	return ZMusic_OpenSongFile(filename, device, Args);
+}
+
+DLL_EXPORT ZMusic_MusicStream ZMusic_OpenSongMemCtx(ZMusicContext* ctx, const void* mem, size_t size, EMidiDevice device, const char* Args)
+{
+	ZMusicContextScope scope(ctx ? ctx : &defaultContext);
+	return ZMusic_OpenSongMem(mem, size, device, Args);
+}
+
+DLL_EXPORT ZMusic_MusicStream ZMusic_OpenSongMemNoCopyCtx(ZMusicContext* ctx, const void* mem, size_t size, void (*release)(void* userdata), void* userdata, EMidiDevice device, const char* Args)
+{
+	ZMusicContextScope scope(ctx ? ctx : &defaultContext);
+	return ZMusic_OpenSongMemNoCopy(mem, size, release, userdata, device, Args);
+}
+
+//==========================================================================
+//
+// asynchronous loading
+//
+// The song gets opened and started on a thread of its own. Errors go to
+// the loader instead of the context, because the caller may be reading
+// the context's last error meanwhile. They get passed on when the song
+// is collected.
+//
+//==========================================================================
+
+static thread_local std::string *errorTarget;
+
+struct SongLoader
+{
+	ZMusicContext *Context;
+	std::thread Thread;
+	std::mutex Mutex;
+	bool Finished = false;
+	std::atomic<bool> Cancelled{ false };
+	MusInfo *Song = nullptr;
+	std::string Error;
+	void (*Callback)(SongLoader *loader, void *userdata);
+	void *Userdata;
+
+	void Load(MusicIO::FileInterface *reader, EMidiDevice device, const std::string &args, int subsong, bool loop);
+};
+
+void SongLoader::Load(MusicIO::FileInterface *reader, EMidiDevice device, const std::string &args, int subsong, bool loop)
+{
+	ZMusicContextScope scope(Context);
+	errorTarget = &Error;
+	auto song = ZMusic_OpenSongInternal(reader, device, args.c_str());
+	if (song != nullptr && (Cancelled || !ZMusic_Start(song, subsong, loop)))
+	{
+		ZMusic_Close(song);
+		song = nullptr;
+	}
+	errorTarget = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Song = song;
+		Finished = true;
+	}
+	if (Callback) Callback(this, Userdata);
+}
+
+static SongLoader *StartSongLoader(ZMusicContext *ctx, MusicIO::FileInterface *reader, EMidiDevice device, const char *Args, int subsong, bool loop, void (*callback)(SongLoader *loader, void *userdata), void *userdata)
+{
+	auto loader = new SongLoader;
+	loader->Context = ctx;
+	loader->Callback = callback;
+	loader->Userdata = userdata;
+	try
+	{
+		loader->Thread = std::thread(&SongLoader::Load, loader, reader, device, std::string(Args ? Args : ""), subsong, loop);
+	}
+	catch (const std::exception &ex)
+	{
+		reader->close();
+		delete loader;
+		SetError(ex.what());
+		return nullptr;
+	}
+	return loader;
+}
+
+DLL_EXPORT SongLoader *ZMusic_OpenSongAsync(ZMusicContext *ctx, ZMusicCustomReader *reader, EMidiDevice device, const char *Args, int subsong, zmusic_bool loop, void (*callback)(SongLoader *loader, void *userdata), void *userdata)
+{
+	ZMusicContextScope scope(ctx ? ctx : &defaultContext);
+	if (!reader)
+	{
+		SetError("No reader protocol specified");
+		return nullptr;
+	}
+	return StartSongLoader(currentContext, new CustomFileReader(reader), device, Args, subsong, loop, callback, userdata);
+}
+
+DLL_EXPORT SongLoader *ZMusic_OpenSongFileAsync(ZMusicContext *ctx, const char *filename, EMidiDevice device, const char *Args, int subsong, zmusic_bool loop, void (*callback)(SongLoader *loader, void *userdata), void *userdata)
+{
+	ZMusicContextScope scope(ctx ? ctx : &defaultContext);
+	auto f = MusicIO::utf8_fopen(filename, "rb");
+	if (!f)
+	{
+		SetError("File not found");
+		return nullptr;
+	}
+	auto reader = MusicIO::OpenFileReader(f);
+	reader->filename = filename;
+	return StartSongLoader(currentContext, reader, device, Args, subsong, loop, callback, userdata);
+}
+
+DLL_EXPORT SongLoader *ZMusic_OpenSongMemAsync(ZMusicContext *ctx, const void *mem, size_t size, EMidiDevice device, const char *Args, int subsong, zmusic_bool loop, void (*callback)(SongLoader *loader, void *userdata), void *userdata)
+{
+	ZMusicContextScope scope(ctx ? ctx : &defaultContext);
+	if (!mem || !size)
+	{
+		SetError("Invalid data");
+		return nullptr;
+	}
+	// Copied for the same reason as in ZMusic_OpenSongMem. It also means that the caller can free its memory right away.
+	auto mr = new MusicIO::VectorReader((uint8_t*)mem, (long)size);
+	return StartSongLoader(currentContext, mr, device, Args, subsong, loop, callback, userdata);
+}
+
+DLL_EXPORT zmusic_bool ZMusic_IsSongLoaded(SongLoader *loader)
+{
+	if (!loader) return true;
+	std::lock_guard<std::mutex> lock(loader->Mutex);
+	return loader->Finished;
+}
+
+DLL_EXPORT MusInfo *ZMusic_FinishSongLoad(SongLoader *loader)
+{
+	if (!loader) return nullptr;
+	loader->Thread.join();
+	auto song = loader->Song;
+	if (song == nullptr)
+	{
+		ZMusicContextScope scope(loader->Context);
+		SetError(loader->Error.c_str());
+	}
+	delete loader;
+	return song;
+}
+
+DLL_EXPORT void ZMusic_CancelSongLoad(SongLoader *loader)
+{
+	if (!loader) return;
+	loader->Cancelled = true;
+	loader->Thread.join();
+	if (loader->Song != nullptr) ZMusic_Close(loader->Song);
+	delete loader;
+}
+
+
+//==========================================================================
+//
+// song analysis
+//
+// The song gets opened without a device and its player scans the data.
+// Since games tend to ask for the same songs repeatedly, the results are
+// kept around, keyed by a hash of the data.
+//
+//==========================================================================
+
+namespace
+{
+	using AnalysisKey = std::tuple<uint64_t, size_t, int>;
+
+	struct AnalysisCache
+	{
+		enum { MaxEntries = 256 };
+
+		std::mutex Mutex;
+		std::map<AnalysisKey, SongAnalysis> Entries;
+		std::deque<AnalysisKey> Order;	// oldest first, for discarding entries when full.
+	};
+
+	AnalysisCache analysisCache;
+}
+
+static bool ZMusic_AnalyzeSongInternal(const uint8_t *data, size_t size, int subsong, ZMusicSongAnalysis *analysis, ZMusicTempoChange *tempomap, int tempomapsize)
+{
+	if (!analysis)
+	{
+		SetError("No analysis buffer specified");
+		return false;
+	}
+	AnalysisKey key(HashData(data, size), size, subsong);
+	SongAnalysis info;
+	bool cached;
+	{
+		std::lock_guard<std::mutex> lock(analysisCache.Mutex);
+		auto it = analysisCache.Entries.find(key);
+		cached = it != analysisCache.Entries.end();
+		if (cached) info = it->second;
+	}
+
+	if (!cached)
+	{
+		// This must not share data with playing songs, because scanning may modify it.
+		auto song = ZMusic_OpenSongInternal(new MusicIO::MemoryReader(data, (long)size), MDEV_DEFAULT, nullptr, false);
+		if (song == nullptr)
+		{
+			return false;
+		}
+		bool res;
+		try
+		{
+			std::lock_guard<MusInfo> lock(*song);
+			res = song->Analyze(subsong, info);
+		}
+		catch (const std::exception &ex)
+		{
+			delete song;
+			SetError(ex.what());
+			return false;
+		}
+		delete song;
+		if (!res)
+		{
+			SetError("Unable to analyze song");
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(analysisCache.Mutex);
+		if (analysisCache.Entries.emplace(key, info).second)
+		{
+			analysisCache.Order.push_back(key);
+			if (analysisCache.Order.size() > AnalysisCache::MaxEntries)
+			{
+				analysisCache.Entries.erase(analysisCache.Order.front());
+				analysisCache.Order.pop_front();
+			}
+		}
+	}
+
+	*analysis = info.Info;
+	if (tempomap != nullptr && tempomapsize > 0)
+	{
+		size_t count = std::min(info.TempoMap.size(), (size_t)tempomapsize);
+		std::copy(info.TempoMap.begin(), info.TempoMap.begin() + count, tempomap);
+	}
+	return true;
+}
+
+DLL_EXPORT zmusic_bool ZMusic_AnalyzeSongMem(const void* mem, size_t size, int subsong, ZMusicSongAnalysis* analysis, ZMusicTempoChange* tempomap, int tempomapsize)
+{
+	if (!mem || !size)
+	{
+		SetError("Invalid data");
+		return false;
+	}
+	return ZMusic_AnalyzeSongInternal((const uint8_t*)mem, size, subsong, analysis, tempomap, tempomapsize);
+}
+
+DLL_EXPORT zmusic_bool ZMusic_AnalyzeSong(ZMusicCustomReader* reader, int subsong, ZMusicSongAnalysis* analysis, ZMusicTempoChange* tempomap, int tempomapsize)
+{
+	if (!reader)
+	{
+		SetError("No reader protocol specified");
+		return false;
+	}
+	// The whole file is needed for the hash anyway.
+	auto cr = new CustomFileReader(reader);
+	std::vector<uint8_t> data(cr->filelength());
+	bool ok = cr->read(data.data(), (long)data.size()) == (long)data.size();
+	cr->close();
+	if (!ok)
+	{
+		SetError("Unable to read song");
+		return false;
+	}
+	return ZMusic_AnalyzeSongMem(data.data(), data.size(), subsong, analysis, tempomap, tempomapsize);
+}
+
+DLL_EXPORT zmusic_bool ZMusic_AnalyzeSongFile(const char* filename, int subsong, ZMusicSongAnalysis* analysis, ZMusicTempoChange* tempomap, int tempomapsize)
+{
+	auto f = MusicIO::utf8_fopen(filename, "rb");
+	if (!f)
+	{
+		SetError("File not found");
+		return false;
+	}
+	auto fr = MusicIO::OpenFileReader(f);
+	std::vector<uint8_t> data;
+	const uint8_t* mem = fr->memory();
+	size_t size = fr->filelength();
+	if (mem == nullptr)
+	{
+		data.resize(size);
+		if (fr->read(data.data(), (long)size) != (long)size)
+		{
+			fr->close();
+			SetError("Unable to read song");
+			return false;
+		}
+		mem = data.data();
+	}
+	bool res = ZMusic_AnalyzeSongMem(mem, size, subsong, analysis, tempomap, tempomapsize);
+	fr->close();
+	return res;
+}
+
 
 //==========================================================================
 //
@@ -408,8 +809,71 @@ DLL_EXPORT MusInfo *ZMusic_OpenCDSong (int track, int id)
 DLL_EXPORT zmusic_bool ZMusic_FillStream(MusInfo* song, void* buff, int len)
 {
 	if (song == nullptr) return false;
-	std::lock_guard<FCriticalSection> lock(song->CritSec);
-	return song->ServiceStream(buff, len);
+	return song->ReadStream(buff, len);
+}
+
+//==========================================================================
+//
+// SoundFrames
+//
+// Number of frames up to and including the last one that is not silent.
+//
+//==========================================================================
+
+static size_t SoundFrames(const uint8_t *data, size_t frames, size_t framesize, int sampletype)
+{
+	const uint8_t silence = sampletype == SampleType_UInt8 ? 0x80 : 0;
+	while (frames > 0)
+	{
+		const uint8_t *frame = data + (frames - 1) * framesize;
+		if (std::any_of(frame, frame + framesize, [=](uint8_t b) { return b != silence; })) break;
+		frames--;
+	}
+	return frames;
+}
+
+//==========================================================================
+//
+// offline rendering
+//
+// Renders as fast as the song can be synthesized, in the song's own output
+// format. Returns the number of frames written, which is less than what was
+// requested once the song has ended.
+//
+//==========================================================================
+
+DLL_EXPORT size_t ZMusic_Render(MusInfo* song, size_t frames, void* buffer)
+{
+	if (song == nullptr || buffer == nullptr) return 0;
+
+	SoundStreamInfoEx fmt;
+	{
+		std::lock_guard<MusInfo> lock(*song);
+		fmt = song->GetStreamInfoEx();
+	}
+	if (fmt.mBufferSize <= 0 || fmt.mSampleRate <= 0)
+	{
+		ZMusicContextScope scope(song->Context);
+		SetError("Song is not streaming");
+		return 0;
+	}
+
+	const size_t framesize = ZMusic_ChannelCount(fmt.mChannelConfig) * ZMusic_SampleTypeSize(fmt.mSampleType);
+	const size_t chunkframes = std::max<size_t>(fmt.mBufferSize / framesize, 1);
+	auto out = (uint8_t*)buffer;
+	size_t done = 0;
+	while (done < frames)
+	{
+		size_t count = std::min(chunkframes, frames - done);
+		if (!song->ReadStream(out + done * framesize, int(count * framesize)))
+		{
+			// The block in which the song ends is valid up to the end of the song and silent after it.
+			done += SoundFrames(out + done * framesize, count, framesize, fmt.mSampleType);
+			break;
+		}
+		done += count;
+	}
+	return done;
 }
 
 //==========================================================================
@@ -421,9 +885,12 @@ DLL_EXPORT zmusic_bool ZMusic_FillStream(MusInfo* song, void* buff, int len)
 DLL_EXPORT zmusic_bool ZMusic_Start(MusInfo *song, int subsong, zmusic_bool loop)
 {
 	if (!song) return true;	// Starting a null song is not an error! It just won't play anything.
+	ZMusicContextScope scope(song->Context);
 	try
 	{
+		std::lock_guard<MusInfo> lock(*song);
 		song->Play(loop, subsong);
+		if (song->RenderAhead) song->RenderAhead->Flush();
 		return true;
 	}
 	catch (const std::exception & ex)
@@ -442,39 +909,74 @@ DLL_EXPORT zmusic_bool ZMusic_Start(MusInfo *song, int subsong, zmusic_bool loop
 DLL_EXPORT void ZMusic_Pause(MusInfo *song)
 {
 	if (!song) return;
+	ZMusicContextScope scope(song->Context);
 	song->Pause();
 }
 
 DLL_EXPORT void ZMusic_Resume(MusInfo *song)
 {
 	if (!song) return;
+	ZMusicContextScope scope(song->Context);
 	song->Resume();
 }
 
 DLL_EXPORT void ZMusic_Update(MusInfo *song)
 {
 	if (!song) return;
+	ZMusicContextScope scope(song->Context);
 	song->Update();
 }
 
 DLL_EXPORT zmusic_bool ZMusic_IsPlaying(MusInfo *song)
 {
 	if (!song) return false;
+	// If the song is busy rendering, the last published state is good enough.
+	std::unique_lock<MusInfo> lock(*song, std::try_to_lock);
+	if (!lock.owns_lock()) return song->m_Status != MusInfo::STATE_Stopped;
 	return song->IsPlaying();
 }
 
 DLL_EXPORT void ZMusic_Stop(MusInfo *song)
 {
 	if (!song) return;
-	std::lock_guard<FCriticalSection> lock(song->CritSec);
-	song->Stop();
+	song->Post([=]
+	{
+		song->Stop();
+		if (song->RenderAhead) song->RenderAhead->Flush();
+	});
 }
 
+// If the song is busy, the change gets queued and this returns true without knowing if the subsong exists.
+// Should it turn out not to, the failure gets printed since nobody is around to receive it.
 DLL_EXPORT zmusic_bool ZMusic_SetSubsong(MusInfo *song, int subsong)
 {
 	if (!song) return false;
-	std::lock_guard<FCriticalSection> lock(song->CritSec);
-	return song->SetSubsong(subsong);
+	auto change = [=]
+	{
+		bool res = song->SetSubsong(subsong);
+		if (res && song->RenderAhead) song->RenderAhead->Flush();
+		return res;
+	};
+	std::unique_lock<MusInfo> lock(*song, std::try_to_lock);
+	if (lock.owns_lock()) return change();
+	song->Post([=] { if (!change()) ZMusic_Printf(ZMUSIC_MSG_WARNING, "Unable to switch to subsong %d\n", subsong); });
+	return true;
+}
+
+// Same as above, a busy song gets the change queued.
+DLL_EXPORT zmusic_bool ZMusic_SetPosition(MusInfo *song, unsigned int milliseconds)
+{
+	if (!song) return false;
+	auto change = [=]
+	{
+		bool res = song->SetPosition(milliseconds);
+		if (res && song->RenderAhead) song->RenderAhead->Flush();
+		return res;
+	};
+	std::unique_lock<MusInfo> lock(*song, std::try_to_lock);
+	if (lock.owns_lock()) return change();
+	song->Post([=] { if (!change()) ZMusic_Printf(ZMUSIC_MSG_WARNING, "Unable to jump to %u ms\n", milliseconds); });
+	return true;
 }
 
 DLL_EXPORT zmusic_bool ZMusic_IsLooping(MusInfo *song)
@@ -495,6 +997,13 @@ DLL_EXPORT zmusic_bool ZMusic_IsMIDI(MusInfo *song)
 	return song->IsMIDI();
 }
 
+static SoundStreamInfoEx GetStreamInfoNoWait(MusInfo *song)
+{
+	std::unique_lock<MusInfo> lock(*song, std::try_to_lock);
+	if (lock.owns_lock()) return song->GetStreamInfoEx();
+	return song->GetPublishedStreamInfo();
+}
+
 DLL_EXPORT void ZMusic_GetStreamInfo(MusInfo *song, SoundStreamInfo *fmt)
 {
 	if (!fmt) return;
@@ -503,11 +1012,7 @@ DLL_EXPORT void ZMusic_GetStreamInfo(MusInfo *song, SoundStreamInfo *fmt)
 	if (!song)
 		return;
 
-	SoundStreamInfoEx fmtex;
-	{
-		std::lock_guard<FCriticalSection> lock(song->CritSec);
-		fmtex = song->GetStreamInfoEx();
-	}
+	SoundStreamInfoEx fmtex = GetStreamInfoNoWait(song);
 	if (fmtex.mSampleRate > 0)
 	{
 		fmt->mBufferSize = fmtex.mBufferSize;
@@ -521,42 +1026,65 @@ DLL_EXPORT void ZMusic_GetStreamInfo(MusInfo *song, SoundStreamInfo *fmt)
 DLL_EXPORT void ZMusic_GetStreamInfoEx(MusInfo *song, SoundStreamInfoEx *fmt)
 {
 	if (!fmt) return;
-	if (!song) *fmt = {};
-	std::lock_guard<FCriticalSection> lock(song->CritSec);
-	*fmt = song->GetStreamInfoEx();
+	*fmt = song ? GetStreamInfoNoWait(song) : SoundStreamInfoEx{};
 }
 
 DLL_EXPORT void ZMusic_Close(MusInfo *song)
 {
 	if (!song) return;
+	ZMusicContextScope scope(song->Context);
+	// The producer thread must be gone before the song gets destroyed.
+	delete song->RenderAhead;
 	delete song;
 }
 
 DLL_EXPORT void ZMusic_VolumeChanged(MusInfo *song)
 {
 	if (!song) return;
-	std::lock_guard<FCriticalSection> lock(song->CritSec);
-	song->MusicVolumeChanged();
+	song->Post([=] { song->MusicVolumeChanged(); });
 }
 
-static std::string staticErrorMessage;
-
 DLL_EXPORT const char *ZMusic_GetStats(MusInfo *song)
 {
 	if (!song) return "";
-	std::lock_guard<FCriticalSection> lock(song->CritSec);
-	staticErrorMessage = song->GetStats();
-	return staticErrorMessage.c_str();
+	// A busy song gets asked to refresh its stats and the previous ones are returned.
+	song->Post([=] { song->PublishStats(); });
+	auto stats = song->GetPublishedStats();
+	auto &buffer = song->Context->errorMessage;
+	buffer = stats ? *stats : "";
+	return buffer.c_str();
+}
+
+DLL_EXPORT zmusic_bool ZMusic_GetPerfCounters(MusInfo *song, ZMusicPerfCounters *counters)
+{
+	if (!counters) return false;
+	*counters = {};
+	if (!song) return false;
+	song->Post([=] { song->PublishPerfCounters(); });
+	*counters = song->GetPublishedPerfCounters();
+	if (song->RenderAhead)
+	{
+		ZMusicRenderAheadStats stats;
+		song->RenderAhead->GetStats(&stats, false);
+		counters->mUnderruns = stats.mUnderruns;
+	}
+	return true;
 }
 
 void SetError(const char* msg)
 {
-	staticErrorMessage = msg;
+	if (errorTarget) *errorTarget = msg;
+	else currentContext->errorMessage = msg;
 }
 
 DLL_EXPORT const char* ZMusic_GetLastError()
 {
-	return staticErrorMessage.c_str();
+	return currentContext->errorMessage.c_str();
+}
+
+DLL_EXPORT const char* ZMusic_GetLastErrorCtx(ZMusicContext* ctx)
+{
+	return (ctx ? ctx : &defaultContext)->errorMessage.c_str();
 }
 
 DLL_EXPORT zmusic_bool ZMusic_WriteSMF(MIDISource* source, const char *fn, int looplimit)
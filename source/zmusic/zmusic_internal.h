@@ -16,6 +16,9 @@
 
 typedef class MIDISource *ZMusic_MidiSource;
 typedef class MusInfo *ZMusic_MusicStream;
+typedef class MusicMixer *ZMusic_Mixer;
+typedef struct ZMusicContext *ZMusic_Context;
+typedef struct SongLoader *ZMusic_SongLoader;
 
 // Build two configurations - lite and full.
 // Lite only  uses FluidSynth for MIDI playback and is licensed under the LGPL v2.1
@@ -30,6 +33,7 @@ typedef class MusInfo *ZMusic_MusicStream;
 #define HAVE_WILDMIDI	// LGPL v3.0
 #endif
 
+#include <vector>
 #include "zmusic.h"
 #include "fileio.h"
 
@@ -52,6 +56,26 @@ struct CustomFileReader : public MusicIO::FileInterface
 
 };
 
+// Reads the client's memory directly and tells the client when it is no longer needed.
+struct ReleasingMemoryReader : public MusicIO::MemoryReader
+{
+	void (*release)(void* userdata);
+	void* userdata;
+
+	ReleasingMemoryReader(const uint8_t* data, long length, void (*rel)(void*), void* ud) : MemoryReader(data, length), release(rel), userdata(ud) {}
+	void close() override
+	{
+		if (release) release(userdata);
+		delete this;
+	}
+};
+
+// What the players fill in for ZMusic_AnalyzeSong.
+struct SongAnalysis
+{
+	ZMusicSongAnalysis Info = { 0, -1, -1, 1, 0 };
+	std::vector<ZMusicTempoChange> TempoMap;
+};
 
 void ZMusic_Printf(int type, const char* msg, ...);
 
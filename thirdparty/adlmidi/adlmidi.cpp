@@ -1257,6 +1257,17 @@ ADLMIDI_EXPORT void adl_setLoopStartHook(struct ADL_MIDIPlayer *device, ADL_Loop
 #endif
 }
 
+/* Set parallel chip rendering hook */
+ADLMIDI_EXPORT void adl_setParallelForHook(struct ADL_MIDIPlayer *device, ADL_ParallelForHook parallelForHook, void *userData)
+{
+    if(!device)
+        return;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    play->hooks.onParallelFor = parallelForHook;
+    play->hooks.onParallelFor_userData = userData;
+}
+
 /* Set loop end hook */
 ADLMIDI_EXPORT void adl_setLoopEndHook(struct ADL_MIDIPlayer *device, ADL_LoopPointHook loopEndHook, void *userData)
 {
@@ -1461,6 +1472,80 @@ static int SendStereoAudio(int        samples_requested,
 
 #endif // ADLMIDI_HW_OPL
 
+#ifndef ADLMIDI_HW_OPL
+struct ChipRenderJob
+{
+    Synth *synth;
+    const unsigned *active;
+    int32_t *bufs;
+    size_t frames;
+};
+
+static void generateChipJob(void *jobdata, int index)
+{
+    ChipRenderJob *job = reinterpret_cast<ChipRenderJob *>(jobdata);
+    unsigned card = job->active[index];
+    int32_t *out = job->bufs + (size_t)index * job->frames * 2;
+    job->synth->m_chips[card]->generate32(out, job->frames);
+    job->synth->updateChipActivity(card, out, job->frames);
+}
+
+/* Mixes every chip into the zero filled out_buf, on the parallel hook when there is one.
+   Chips which went idle are not emulated until they get written to again. */
+static void generateAndMixChips(MidiPlayer *player, int32_t *out_buf, size_t frames)
+{
+    Synth &synth = *player->m_synth;
+    unsigned int chips = synth.m_numChips;
+
+#if defined(ADLMIDI_AUDIO_TICK_HANDLER)
+    // The audio tick handler runs the sequencer from inside the chips, so all of them must run, in order
+    for(unsigned card = 0; card < chips; ++card)
+        synth.m_chips[card]->generateAndMix32(out_buf, frames);
+#else
+    std::vector<unsigned> &active = player->m_activeChips;
+    active.clear();
+    for(unsigned card = 0; card < chips; ++card)
+    {
+        if(!synth.isChipIdle(card))
+            active.push_back(card);
+    }
+
+    // Very short blocks are cheaper to render serially than to hand out to other threads
+    if(player->hooks.onParallelFor && frames >= 64 && active.size() > 1)
+    {
+        player->m_chipBufs.resize(active.size() * frames * 2);
+        ChipRenderJob job = { &synth, active.data(), player->m_chipBufs.data(), frames };
+        player->hooks.onParallelFor(player->hooks.onParallelFor_userData, (int)active.size(), generateChipJob, &job);
+
+        for(size_t index = 0; index < active.size(); ++index)
+        {
+            const int32_t *in = job.bufs + index * frames * 2;
+            for(size_t i = 0; i < frames * 2; ++i)
+                out_buf[i] += in[i];
+        }
+        return;
+    }
+
+    // Chips with keys held can't go idle, so only the others need their output checked
+    player->m_chipBufs.resize(frames * 2);
+    int32_t *buf = player->m_chipBufs.data();
+    for(size_t index = 0; index < active.size(); ++index)
+    {
+        unsigned card = active[index];
+        if(synth.isChipKeyed(card))
+        {
+            synth.m_chips[card]->generateAndMix32(out_buf, frames);
+            continue;
+        }
+        synth.m_chips[card]->generate32(buf, frames);
+        synth.updateChipActivity(card, buf, frames);
+        for(size_t i = 0; i < frames * 2; ++i)
+            out_buf[i] += buf[i];
+    }
+#endif
+}
+#endif
+
 
 ADLMIDI_EXPORT int adl_play(struct ADL_MIDIPlayer *device, int sampleCount, short *out)
 {
@@ -1541,8 +1626,7 @@ ADLMIDI_EXPORT int adl_playFormat(ADL_MIDIPlayer *device, int sampleCount,
             else/* if(n_periodCountStereo > 0)*/
             {
                 /* Generate data from every chip and mix result */
-                for(size_t card = 0; card < chips; ++card)
-                    synth.m_chips[card]->generateAndMix32(out_buf, (size_t)in_generatedStereo);
+                generateAndMixChips(player, out_buf, (size_t)in_generatedStereo);
             }
 
             /* Process it */
@@ -1632,8 +1716,7 @@ ADLMIDI_EXPORT int adl_generateFormat(struct ADL_MIDIPlayer *device, int sampleC
             else if(n_periodCountStereo > 0)
             {
                 /* Generate data from every chip and mix result */
-                for(unsigned card = 0; card < chips; ++card)
-                    synth.m_chips[card]->generateAndMix32(out_buf, (size_t)in_generatedStereo);
+                generateAndMixChips(player, out_buf, (size_t)in_generatedStereo);
             }
             /* Process it */
             if(SendStereoAudio(sampleCount, in_generatedStereo, out_buf, gotten_len, out_left, out_right, format) == -1)
@@ -1412,6 +1412,17 @@ typedef void (*ADL_DebugMessageHook)(void *userdata, const char *fmt, ...);
  */
 typedef void (*ADL_LoopPointHook)(void *userdata);
 
+/**
+ * @brief Parallel chip rendering callback
+ * @param userdata Pointer to user data (usually, context of something)
+ * @param count Number of jobs
+ * @param job Function which must be called once for every index in [0, count)
+ * @param jobdata Pointer which must be passed through to the job
+ *
+ * The calls may be spread over several threads, but the callback must return only when all of them are done.
+ */
+typedef void (*ADL_ParallelForHook)(void *userdata, int count, void (*job)(void *jobdata, int index), void *jobdata);
+
 /**
  * @brief Set raw MIDI event hook
  *
@@ -1480,6 +1491,19 @@ extern ADLMIDI_DECLSPEC void adl_setLoopStartHook(struct ADL_MIDIPlayer *device,
  */
 extern ADLMIDI_DECLSPEC void adl_setLoopEndHook(struct ADL_MIDIPlayer *device, ADL_LoopPointHook loopEndHook, void *userData);
 
+/**
+ * @brief Set the parallel chip rendering hook
+ *
+ * With more than one emulated chip every chip gets rendered into its own buffer by a job
+ * passed to this hook, and the buffers are mixed afterwards. Register writes still happen
+ * on the thread which calls the generate functions, so they stay in order per chip.
+ *
+ * @param device Instance of the library
+ * @param parallelForHook Pointer to the callback function, or NULL to render the chips one after another
+ * @param userData Pointer to user data which will be passed through the callback.
+ */
+extern ADLMIDI_DECLSPEC void adl_setParallelForHook(struct ADL_MIDIPlayer *device, ADL_ParallelForHook parallelForHook, void *userData);
+
 /**
  * @brief Get a textual description of the channel state. For display only.
  * @param device Instance of the library
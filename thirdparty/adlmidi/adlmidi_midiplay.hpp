@@ -42,7 +42,9 @@ struct MIDIEventHooks
         onLoopEnd(NULL),
         onLoopEnd_userData(NULL),
         onDebugMessage(NULL),
-        onDebugMessage_userData(NULL)
+        onDebugMessage_userData(NULL),
+        onParallelFor(NULL),
+        onParallelFor_userData(NULL)
     {}
 
     //! Note on/off hooks
@@ -61,6 +63,10 @@ struct MIDIEventHooks
     typedef void (*DebugMessageHook)(void *userdata, const char *fmt, ...);
     DebugMessageHook onDebugMessage;
     void *onDebugMessage_userData;
+
+    //! Parallel chip rendering
+    ADL_ParallelForHook onParallelFor;
+    void *onParallelFor_userData;
 };
 
 class MIDIplay
@@ -683,6 +689,12 @@ public:
     //! Generator output buffer
     int32_t m_outBuf[1024];
 
+    //! Output buffers of the chips for parallel rendering and idle detection
+    std::vector<int32_t> m_chipBufs;
+
+    //! Chips which are not idle in the current block
+    std::vector<unsigned> m_activeChips;
+
     //! Synthesizer setup
     Setup m_setup;
 
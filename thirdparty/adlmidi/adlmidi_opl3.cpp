@@ -1027,16 +1027,74 @@ void OPL3::setEmbeddedBank(uint32_t bank)
 #endif
 }
 
+static void trackChipWrite(OPL3::ChipActivity &activity, uint16_t address, uint8_t value)
+{
+    uint16_t reg = address & 0xFF;
+    if(reg >= 0xB0 && reg <= 0xB8)
+    {
+        uint32_t bit = 1u << ((reg - 0xB0) + ((address & 0x100) ? 9 : 0));
+        if(value & 0x20)
+            activity.keyOn |= bit;
+        else
+            activity.keyOn &= ~bit;
+    }
+    else if(address == 0xBD)
+    {
+        if(value & 0x1F)
+            activity.keyOn |= 1u << 18;
+        else
+            activity.keyOn &= ~(1u << 18);
+    }
+    activity.silentFrames = 0;
+}
+
 void OPL3::writeReg(size_t chip, uint16_t address, uint8_t value)
 {
+    if(chip < m_chipActivity.size())
+        trackChipWrite(m_chipActivity[chip], address, value);
     m_chips[chip]->writeReg(address, value);
 }
 
 void OPL3::writeRegI(size_t chip, uint32_t address, uint32_t value)
 {
+    if(chip < m_chipActivity.size())
+        trackChipWrite(m_chipActivity[chip], static_cast<uint16_t>(address), static_cast<uint8_t>(value));
     m_chips[chip]->writeReg(static_cast<uint16_t>(address), static_cast<uint8_t>(value));
 }
 
+bool OPL3::isChipKeyed(size_t chip) const
+{
+    return chip >= m_chipActivity.size() || m_chipActivity[chip].keyOn != 0;
+}
+
+bool OPL3::isChipIdle(size_t chip) const
+{
+    if(chip >= m_chipActivity.size())
+        return false;
+    const ChipActivity &activity = m_chipActivity[chip];
+    return activity.keyOn == 0 && activity.silentFrames >= ChipIdleFrames;
+}
+
+void OPL3::updateChipActivity(size_t chip, const int32_t *frames, size_t count)
+{
+    if(chip >= m_chipActivity.size())
+        return;
+    ChipActivity &activity = m_chipActivity[chip];
+    if(activity.keyOn != 0)
+        return;
+    for(size_t i = 0; i < count * 2; ++i)
+    {
+        // Anything above one LSB counts as sound, released notes may hover there for a while
+        if(frames[i] > 1 || frames[i] < -1)
+        {
+            activity.silentFrames = 0;
+            return;
+        }
+    }
+    if(activity.silentFrames < ChipIdleFrames)
+        activity.silentFrames += static_cast<uint32_t>(count);
+}
+
 void OPL3::writePan(size_t chip, uint32_t address, uint32_t value)
 {
     m_chips[chip]->writePan(static_cast<uint16_t>(address), static_cast<uint8_t>(value));
@@ -1981,6 +2039,7 @@ void OPL3::reset(int emulator, unsigned long PCM_RATE, void *audioTickHandler)
         initChip(i);
     }
 
+    m_chipActivity.assign(m_numChips, ChipActivity());
     updateChannelCategories();
     silenceAll();
 }
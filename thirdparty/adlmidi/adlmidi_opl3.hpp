@@ -63,6 +63,20 @@ public:
     //! Running chip emulators
     std::vector<AdlMIDI_SPtr<OPLChipBase > > m_chips;
 
+    //! Activity of one chip, used to skip emulating chips which can't be heard
+    struct ChipActivity
+    {
+        ChipActivity() : keyOn(0), silentFrames(0) {}
+        //! Channels with the key-on bit set. Bit 18 is the rhythm section
+        uint32_t keyOn;
+        //! Frames of inaudible output since the last register write
+        uint32_t silentFrames;
+    };
+    //! Silent frames after which a chip without keys held is no longer emulated
+    enum { ChipIdleFrames = 4096 };
+    //! Activity of every running chip
+    std::vector<ChipActivity> m_chipActivity;
+
 private:
     //! Cached patch data, needed by Touch()
     std::vector<OplTimbre>    m_insCache;
@@ -312,6 +326,27 @@ public:
      */
     void writePan(size_t chip, uint32_t address, uint32_t value);
 
+    /**
+     * @brief Is any channel or rhythm instrument of the chip keyed on?
+     * @param chip Index of emulated chip
+     */
+    bool isChipKeyed(size_t chip) const;
+
+    /**
+     * @brief Can the chip skip emulation? True when no keys are held and it produced
+     * only inaudible output since its last register write. Any write wakes it up again
+     * @param chip Index of emulated chip
+     */
+    bool isChipIdle(size_t chip) const;
+
+    /**
+     * @brief Feed the chip's freshly generated output to the idle detection
+     * @param chip Index of emulated chip
+     * @param frames Generated stereo frames
+     * @param count Number of frames
+     */
+    void updateChipActivity(size_t chip, const int32_t *frames, size_t count);
+
     /**
      * @brief Off the note in specified chip channel
      * @param c Channel of chip (Emulated chip choosing by next formula: [c = ch + (chipId * 23)])
@@ -5926,7 +5926,8 @@ int DUMBEXPORT dumb_it_scan_for_playable_orders(DUMB_IT_SIGDATA *sigdata, dumb_s
 
 		if (n == sigdata->n_orders) break;
 
-		sigrenderer = dumb_it_init_sigrenderer(sigdata, 0, n);
+		/* Nothing gets mixed, but mono sigrenderers cannot be created anymore. */
+		sigrenderer = dumb_it_init_sigrenderer(sigdata, 2, n);
 		if (!sigrenderer) {
 			bit_array_destroy(ba_played);
 			return -1;
@@ -54,10 +54,22 @@
 		Improved emulation output.
 */
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include "nukedopl3.h"
 
+#if defined(_M_X64) || defined(__x86_64__)
+#define NUKEDOPL3_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
 //
 // Envelope generator
 //
@@ -766,6 +778,8 @@ Bit16s limshort(Bit32s a) {
 	return (Bit16s)a;
 }
 
+void chip_step(opl_chip *chip);
+
 void chip_generate(opl_chip *chip, Bit16s *buff) {
 	buff[1] = limshort(chip->mixbuff[1]);
 
@@ -850,6 +864,10 @@ void chip_generate(opl_chip *chip, Bit16s *buff) {
 		slot_generate(&chip->slot[ii]);
 	}
 
+	chip_step(chip);
+}
+
+void chip_step(opl_chip *chip) {
 	n_generate(chip);
 
 	if ((chip->timer & 0x3f) == 0x3f) {
@@ -877,7 +895,487 @@ void chip_generate(opl_chip *chip, Bit16s *buff) {
 	chip->timer++;
 }
 
+//
+// Structure-of-arrays generator
+//
+// Produces the same output as chip_generate, but with the slots laid out so that
+// every stage runs over all of them in flat loops. On x86 CPUs with AVX2 these
+// advance 8 slots per instruction, elsewhere they are left to the compiler's
+// vectorizer. The waveforms are folded into one table, the vibrato steps are
+// precomputed and the envelope generator runs without function pointers. The
+// register state is constant inside a block, so everything derived from it is
+// set up once in soa_load and the changing state is copied back by soa_store.
+//
+
+struct opl_soatables;
+
+typedef void(*soa_slotfunc)(opl_soa *soa, const opl_soatables *tables, Bit32u timer, Bit32u vibpos, Bit32s tremval);
+typedef void(*soa_operatorfunc)(opl_soa *soa, const opl_soatables *tables, Bit32u start, Bit32u end);
+
+struct opl_soatables {
+	Bit16u wave[8 * 0x400 + 2];		// log-sin value of each waveform, bit 15 set if the output is negated
+	Bit32s exp[256];				// exprom value for the low byte of the level
+	Bit32s rate_shift[64];			// eg_incsh of each envelope rate
+	Bit32s rate_step[64 * 8];		// eg_incstep row of each envelope rate
+	soa_slotfunc slots;
+	soa_operatorfunc operators;
+	opl_soatables();
+};
+
+inline Bit32s soa_wave(const opl_soatables *tables, Bit32u wf, Bit32u phase, Bit32s eg_out) {
+	Bit32u entry = tables->wave[wf | (phase & 0x3ff)];
+	Bit32u level = (entry & 0x7fff) + ((Bit32u)(Bit16u)eg_out << 3);
+	if (level > 0x1fff) {
+		level = 0x1fff;
+	}
+	Bit32s out = tables->exp[level & 0xff] >> (level >> 8);
+	return (entry & 0x8000) ? ~out : out;
+}
+
+void soa_slots(opl_soa *soa, const opl_soatables *tables, Bit32u timer, Bit32u vibpos, Bit32s tremval) {
+	for (Bit32u ii = 0; ii < soa_lanes; ii++) {
+		Bit32s rate = soa->eg_rate[ii];
+		Bit32s shift = tables->rate_shift[rate];
+		const Bit32s *step = &tables->rate_step[rate * 8];
+		if (shift > 0) {
+			soa->eg_inc[ii] = (timer & ((1 << shift) - 1)) == 0 ? step[(timer >> shift) & 0x07] : 0;
+		}
+		else {
+			soa->eg_inc[ii] = step[timer & 0x07] << (-shift);
+		}
+	}
+
+	for (Bit32u ii = 0; ii < soa_lanes; ii++) {
+		Bit32s out = soa->val[ii];
+		Bit32s prout = soa->prout[0][ii];
+		soa->val[soa_prev + ii] = out;
+		soa->prout[1][ii] = prout;
+		soa->prout[0][ii] = out;
+		soa->val[soa_fbmod + ii] = ((out + prout) >> soa->fb_shift[ii]) & soa->fb_on[ii];
+
+		soa->pg_phase[ii] += soa->pg_inc[vibpos][ii];
+
+		Bit32s gen = soa->eg_gen[ii];
+		Bit32s rout = soa->eg_rout[ii];
+		Bit32s inc = soa->eg_inc[ii];
+		soa->eg_out[ii] = rout + soa->eg_base[ii] + (tremval & soa->eg_trem[ii]);
+
+		bool attack = gen == envelope_gen_num_attack;
+		bool decay = gen == envelope_gen_num_decay;
+		bool release = gen == envelope_gen_num_release || (gen == envelope_gen_num_sustain && !soa->eg_type[ii]);
+		bool attack_end = attack && rout == 0x00;
+		bool decay_end = decay && rout >= soa->eg_sl[ii];
+		bool release_end = release && rout >= 0x1ff;
+		Bit32s rise = rout + (((~rout) * inc) >> 3);
+		if (rise < 0x00) {
+			rise = 0x00;
+		}
+		Bit32s next = attack ? rise : rout + inc;
+		next = (gen == envelope_gen_num_off || release_end) ? 0x1ff : (attack_end || decay_end) ? rout : (attack || decay || release) ? next : rout;
+		soa->eg_rout[ii] = next;
+		soa->eg_gen[ii] = attack_end ? envelope_gen_num_decay : decay_end ? envelope_gen_num_sustain : release_end ? envelope_gen_num_off : gen;
+		soa->eg_rate[ii] = attack_end ? soa->eg_rate_dr[ii] : decay_end ? soa->eg_rate_rr[ii] : release_end ? 0 : soa->eg_rate[ii];
+	}
+}
+
+// Slots in [start, end) only depend on slots before start, so the phases
+// are gathered first and the output loop doesn't read what it writes.
+void soa_operators(opl_soa *soa, const opl_soatables *tables, Bit32u start, Bit32u end) {
+	for (Bit32u ii = start; ii < end; ii++) {
+		soa->phase[ii] = (soa->pg_phase[ii] >> 9) + soa->val[soa->mod[ii]];
+	}
+	for (Bit32u ii = start; ii < end; ii++) {
+		soa->val[ii] = soa_wave(tables, soa->wf[ii], soa->phase[ii], soa->eg_out[ii]);
+	}
+}
+
+#ifdef NUKEDOPL3_AVX2
+
+TARGET_AVX2 void soa_slots_avx2(opl_soa *soa, const opl_soatables *tables, Bit32u timer, Bit32u vibpos, Bit32s tremval) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i vtimer = _mm256_set1_epi32(timer);
+	const __m256i vtrem = _mm256_set1_epi32(tremval);
+	for (Bit32u ii = 0; ii < soa_lanes; ii += 8) {
+		// feedback
+		__m256i out = _mm256_loadu_si256((const __m256i*)&soa->val[ii]);
+		__m256i prout = _mm256_loadu_si256((const __m256i*)&soa->prout[0][ii]);
+		_mm256_storeu_si256((__m256i*)&soa->val[soa_prev + ii], out);
+		_mm256_storeu_si256((__m256i*)&soa->prout[1][ii], prout);
+		_mm256_storeu_si256((__m256i*)&soa->prout[0][ii], out);
+		__m256i fbmod = _mm256_srav_epi32(_mm256_add_epi32(out, prout), _mm256_loadu_si256((const __m256i*)&soa->fb_shift[ii]));
+		fbmod = _mm256_and_si256(fbmod, _mm256_loadu_si256((const __m256i*)&soa->fb_on[ii]));
+		_mm256_storeu_si256((__m256i*)&soa->val[soa_fbmod + ii], fbmod);
+
+		// phase
+		__m256i phase = _mm256_loadu_si256((const __m256i*)&soa->pg_phase[ii]);
+		phase = _mm256_add_epi32(phase, _mm256_loadu_si256((const __m256i*)&soa->pg_inc[vibpos][ii]));
+		_mm256_storeu_si256((__m256i*)&soa->pg_phase[ii], phase);
+
+		// envelope increment, a shift of 0 or less always steps
+		__m256i rate = _mm256_loadu_si256((const __m256i*)&soa->eg_rate[ii]);
+		__m256i shift = _mm256_i32gather_epi32((const int*)tables->rate_shift, rate, 4);
+		__m256i right = _mm256_max_epi32(shift, zero);
+		__m256i left = _mm256_sub_epi32(zero, _mm256_min_epi32(shift, zero));
+		__m256i pos = _mm256_and_si256(_mm256_srlv_epi32(vtimer, right), _mm256_set1_epi32(0x07));
+		__m256i step = _mm256_i32gather_epi32((const int*)tables->rate_step, _mm256_add_epi32(_mm256_slli_epi32(rate, 3), pos), 4);
+		__m256i due = _mm256_cmpeq_epi32(_mm256_and_si256(vtimer, _mm256_sub_epi32(_mm256_sllv_epi32(one, right), one)), zero);
+		__m256i inc = _mm256_and_si256(_mm256_sllv_epi32(step, left), due);
+		_mm256_storeu_si256((__m256i*)&soa->eg_inc[ii], inc);
+
+		// envelope
+		__m256i rout = _mm256_loadu_si256((const __m256i*)&soa->eg_rout[ii]);
+		__m256i gen = _mm256_loadu_si256((const __m256i*)&soa->eg_gen[ii]);
+		__m256i eg_out = _mm256_add_epi32(rout, _mm256_loadu_si256((const __m256i*)&soa->eg_base[ii]));
+		eg_out = _mm256_add_epi32(eg_out, _mm256_and_si256(vtrem, _mm256_loadu_si256((const __m256i*)&soa->eg_trem[ii])));
+		_mm256_storeu_si256((__m256i*)&soa->eg_out[ii], eg_out);
+
+		__m256i off = _mm256_cmpeq_epi32(gen, _mm256_set1_epi32(envelope_gen_num_off));
+		__m256i attack = _mm256_cmpeq_epi32(gen, _mm256_set1_epi32(envelope_gen_num_attack));
+		__m256i decay = _mm256_cmpeq_epi32(gen, _mm256_set1_epi32(envelope_gen_num_decay));
+		__m256i sustain = _mm256_cmpeq_epi32(gen, _mm256_set1_epi32(envelope_gen_num_sustain));
+		__m256i release = _mm256_cmpeq_epi32(gen, _mm256_set1_epi32(envelope_gen_num_release));
+		release = _mm256_or_si256(release, _mm256_and_si256(sustain, _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)&soa->eg_type[ii]), zero)));
+		__m256i attack_end = _mm256_and_si256(attack, _mm256_cmpeq_epi32(rout, zero));
+		__m256i decay_end = _mm256_and_si256(decay, _mm256_cmpgt_epi32(rout, _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)&soa->eg_sl[ii]), one)));
+		__m256i release_end = _mm256_and_si256(release, _mm256_cmpgt_epi32(rout, _mm256_set1_epi32(0x1fe)));
+
+		__m256i rise = _mm256_mullo_epi32(_mm256_xor_si256(rout, _mm256_set1_epi32(-1)), inc);
+		rise = _mm256_max_epi32(_mm256_add_epi32(rout, _mm256_srai_epi32(rise, 3)), zero);
+		__m256i next = _mm256_blendv_epi8(_mm256_add_epi32(rout, inc), rise, attack);
+		__m256i moving = _mm256_or_si256(_mm256_or_si256(attack, decay), release);
+		__m256i hold = _mm256_or_si256(_mm256_or_si256(attack_end, decay_end), _mm256_cmpeq_epi32(moving, zero));
+		next = _mm256_blendv_epi8(next, rout, hold);
+		next = _mm256_blendv_epi8(next, _mm256_set1_epi32(0x1ff), _mm256_or_si256(off, release_end));
+		_mm256_storeu_si256((__m256i*)&soa->eg_rout[ii], next);
+
+		gen = _mm256_blendv_epi8(gen, _mm256_set1_epi32(envelope_gen_num_decay), attack_end);
+		gen = _mm256_blendv_epi8(gen, _mm256_set1_epi32(envelope_gen_num_sustain), decay_end);
+		gen = _mm256_blendv_epi8(gen, _mm256_set1_epi32(envelope_gen_num_off), release_end);
+		_mm256_storeu_si256((__m256i*)&soa->eg_gen[ii], gen);
+
+		rate = _mm256_blendv_epi8(rate, _mm256_loadu_si256((const __m256i*)&soa->eg_rate_dr[ii]), attack_end);
+		rate = _mm256_blendv_epi8(rate, _mm256_loadu_si256((const __m256i*)&soa->eg_rate_rr[ii]), decay_end);
+		rate = _mm256_andnot_si256(release_end, rate);
+		_mm256_storeu_si256((__m256i*)&soa->eg_rate[ii], rate);
+	}
+}
+
+TARGET_AVX2 void soa_operators_avx2(opl_soa *soa, const opl_soatables *tables, Bit32u start, Bit32u end) {
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	for (Bit32u ii = start; ii < end; ii += 8) {
+		// The last batch may reach into the next group, those lanes are left alone.
+		__m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(end - ii), lanes);
+		__m256i mod = _mm256_maskload_epi32((const int*)&soa->mod[ii], mask);
+		__m256i pg_phase = _mm256_maskload_epi32((const int*)&soa->pg_phase[ii], mask);
+		__m256i wf = _mm256_maskload_epi32((const int*)&soa->wf[ii], mask);
+		__m256i eg_out = _mm256_maskload_epi32((const int*)&soa->eg_out[ii], mask);
+
+		__m256i phase = _mm256_add_epi32(_mm256_srli_epi32(pg_phase, 9), _mm256_i32gather_epi32((const int*)soa->val, mod, 4));
+		__m256i index = _mm256_or_si256(wf, _mm256_and_si256(phase, _mm256_set1_epi32(0x3ff)));
+		__m256i entry = _mm256_and_si256(_mm256_i32gather_epi32((const int*)tables->wave, index, 2), _mm256_set1_epi32(0xffff));
+		__m256i level = _mm256_slli_epi32(_mm256_and_si256(eg_out, _mm256_set1_epi32(0xffff)), 3);
+		level = _mm256_add_epi32(level, _mm256_and_si256(entry, _mm256_set1_epi32(0x7fff)));
+		level = _mm256_min_epi32(level, _mm256_set1_epi32(0x1fff));
+		__m256i out = _mm256_i32gather_epi32((const int*)tables->exp, _mm256_and_si256(level, _mm256_set1_epi32(0xff)), 4);
+		out = _mm256_srlv_epi32(out, _mm256_srli_epi32(level, 8));
+		__m256i neg = _mm256_cmpeq_epi32(_mm256_and_si256(entry, _mm256_set1_epi32(0x8000)), _mm256_set1_epi32(0x8000));
+		_mm256_maskstore_epi32((int*)&soa->val[ii], mask, _mm256_xor_si256(out, neg));
+	}
+}
+
+bool soa_hasavx2() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+opl_soatables::opl_soatables() {
+	for (Bit16u wf = 0; wf < 8; wf++) {
+		for (Bit16u phase = 0; phase < 0x400; phase++) {
+			Bit16u out = 0;
+			Bit16u neg = 0;
+			switch (wf) {
+			case 0:
+				neg = phase & 0x200;
+				out = (phase & 0x100) ? logsinrom[(phase & 0xff) ^ 0xff] : logsinrom[phase & 0xff];
+				break;
+			case 1:
+				if (phase & 0x200) {
+					out = 0x1000;
+				}
+				else {
+					out = (phase & 0x100) ? logsinrom[(phase & 0xff) ^ 0xff] : logsinrom[phase & 0xff];
+				}
+				break;
+			case 2:
+				out = (phase & 0x100) ? logsinrom[(phase & 0xff) ^ 0xff] : logsinrom[phase & 0xff];
+				break;
+			case 3:
+				out = (phase & 0x100) ? 0x1000 : logsinrom[phase & 0xff];
+				break;
+			case 4:
+			case 5:
+				if (wf == 4) {
+					neg = (phase & 0x300) == 0x100;
+				}
+				if (phase & 0x200) {
+					out = 0x1000;
+				}
+				else if (phase & 0x80) {
+					out = logsinrom[((phase ^ 0xff) << 1) & 0xff];
+				}
+				else {
+					out = logsinrom[(phase << 1) & 0xff];
+				}
+				break;
+			case 6:
+				neg = phase & 0x200;
+				break;
+			case 7:
+				neg = phase & 0x200;
+				out = (neg ? (phase & 0x1ff) ^ 0x1ff : phase) << 3;
+				break;
+			}
+			wave[(wf << 10) | phase] = out | (neg ? 0x8000 : 0);
+		}
+	}
+	wave[8 * 0x400] = wave[8 * 0x400 + 1] = 0;
+	for (Bit32u level = 0; level < 256; level++) {
+		exp[level] = (exprom[level ^ 0xff] | 0x400) << 1;
+	}
+	for (Bit32u rate = 0; rate < 64; rate++) {
+		Bit32u rate_h = rate >> 2;
+		rate_shift[rate] = eg_incsh[rate_h];
+		for (Bit32u pos = 0; pos < 8; pos++) {
+			rate_step[rate * 8 + pos] = eg_incstep[eg_incdesc[rate_h]][rate & 3][pos];
+		}
+	}
+	slots = soa_slots;
+	operators = soa_operators;
+#ifdef NUKEDOPL3_AVX2
+	if (soa_hasavx2()) {
+		slots = soa_slots_avx2;
+		operators = soa_operators_avx2;
+	}
+#endif
+}
+
+const opl_soatables *soa_tables() {
+	static const opl_soatables tables;
+	return &tables;
+}
+
+bool soa_rhythmslot(opl_chip *chip, Bit8u slotnum) {
+	return (chip->rhy & 0x20) && (slotnum == 13 || slotnum == 14 || slotnum == 16 || slotnum == 17);
+}
+
+// Returns the slot whose output ptr points to, or -1.
+int soa_outslot(opl_chip *chip, const Bit16s *ptr) {
+	ptrdiff_t offset = (const char *)ptr - (const char *)&chip->slot[0].out;
+	if (offset < 0 || offset % sizeof(opl_slot) != 0 || offset / sizeof(opl_slot) >= 36) {
+		return -1;
+	}
+	return (int)(offset / sizeof(opl_slot));
+}
+
+// Returns false if the chip is in a state the generator doesn't cover, in which
+// case the block has to be done by chip_generate.
+bool soa_load(opl_chip *chip, opl_soa *soa) {
+	Bit8u depth[36];
+	Bit8u counts[soa_groups] = {};
+
+	for (Bit8u slotnum = 0; slotnum < 36; slotnum++) {
+		opl_slot *slot = &chip->slot[slotnum];
+		if (slot->trem != &chip->tremval && slot->trem != (Bit8u*)&chip->zeromod) {
+			return false;
+		}
+		if (soa_rhythmslot(chip, slotnum)) {
+			depth[slotnum] = soa_groups - 1;
+		}
+		else if (slot->mod == &slot->fbmod || slot->mod == &chip->zeromod) {
+			depth[slotnum] = 0;
+		}
+		else {
+			// A modulator has to be generated before the slot it feeds, and at most 4 operators can be chained.
+			int src = soa_outslot(chip, slot->mod);
+			if (src < 0 || src >= slotnum || soa_rhythmslot(chip, src) || depth[src] >= soa_groups - 2) {
+				return false;
+			}
+			depth[slotnum] = depth[src] + 1;
+		}
+		counts[depth[slotnum]]++;
+	}
+
+	memset(soa, 0, sizeof(opl_soa));
+	soa->group[0] = 0;
+	for (Bit8u group = 0; group < soa_groups; group++) {
+		soa->group[group + 1] = soa->group[group] + counts[group];
+	}
+	Bit8u next[soa_groups];
+	memcpy(next, soa->group, sizeof(next));
+	for (Bit8u slotnum = 0; slotnum < 36; slotnum++) {
+		Bit8u lane = next[depth[slotnum]]++;
+		soa->slot[lane] = slotnum;
+		soa->lane[slotnum] = lane;
+	}
+
+	for (Bit8u lane = 0; lane < soa_lanes; lane++) {
+		soa->mod[lane] = soa_zero;
+		if (lane >= 36) {
+			continue;
+		}
+		opl_slot *slot = &chip->slot[soa->slot[lane]];
+		opl_channel *channel = slot->channel;
+
+		soa->val[lane] = slot->out;
+		soa->val[soa_fbmod + lane] = slot->fbmod;
+		soa->prout[0][lane] = slot->prout[0];
+		soa->prout[1][lane] = slot->prout[1];
+		soa->fb_on[lane] = channel->fb != 0x00 ? ~0 : 0;
+		soa->fb_shift[lane] = 0x09 - channel->fb;
+		if (slot->mod == &slot->fbmod) {
+			soa->mod[lane] = soa_fbmod + lane;
+		}
+		else if (slot->mod != &chip->zeromod) {
+			soa->mod[lane] = soa->lane[soa_outslot(chip, slot->mod)];
+		}
+
+		soa->pg_phase[lane] = slot->pg_phase;
+		for (Bit8u vibpos = 0; vibpos < 8; vibpos++) {
+			Bit16u f_num = channel->f_num;
+			if (slot->reg_vib) {
+				Bit8u f_num_high = f_num >> (7 + vib_table[vibpos] + (0x01 - chip->dvb));
+				f_num += f_num_high * vibsgn_table[vibpos];
+			}
+			soa->pg_inc[vibpos][lane] = (((f_num << channel->block) >> 1) * mt[slot->reg_mult]) >> 1;
+		}
+
+		soa->eg_rout[lane] = slot->eg_rout;
+		soa->eg_out[lane] = slot->eg_out;
+		soa->eg_inc[lane] = slot->eg_inc;
+		soa->eg_gen[lane] = slot->eg_gen;
+		soa->eg_rate[lane] = slot->eg_rate;
+		soa->eg_rate_dr[lane] = envelope_calc_rate(slot, slot->reg_dr);
+		soa->eg_rate_rr[lane] = envelope_calc_rate(slot, slot->reg_rr);
+		soa->eg_base[lane] = (slot->reg_tl << 2) + (slot->eg_ksl >> kslshift[slot->reg_ksl]);
+		soa->eg_trem[lane] = slot->trem == &chip->tremval ? 0xff : 0x00;
+		soa->eg_sl[lane] = slot->reg_sl << 4;
+		soa->eg_type[lane] = slot->reg_type;
+		soa->wf[lane] = slot->reg_wf << 10;
+	}
+
+	// The left mix is taken before slots 15-35 are generated and the right one before slots 33-35,
+	// so those contribute what they produced for the previous sample.
+	for (Bit8u channum = 0; channum < 18; channum++) {
+		for (Bit8u jj = 0; jj < 4; jj++) {
+			const Bit16s *ptr = chip->channel[channum].out[jj];
+			if (ptr == &chip->zeromod) {
+				soa->mix[0][channum][jj] = soa->mix[1][channum][jj] = soa_zero;
+				continue;
+			}
+			int src = soa_outslot(chip, ptr);
+			if (src < 0) {
+				return false;
+			}
+			soa->mix[0][channum][jj] = soa->lane[src] + (src >= 15 ? soa_prev : 0);
+			soa->mix[1][channum][jj] = soa->lane[src] + (src >= 33 ? soa_prev : 0);
+		}
+	}
+	soa->rhythm = (chip->rhy & 0x20) != 0;
+	return true;
+}
+
+void soa_store(opl_chip *chip, opl_soa *soa) {
+	for (Bit8u lane = 0; lane < 36; lane++) {
+		opl_slot *slot = &chip->slot[soa->slot[lane]];
+		slot->out = (Bit16s)soa->val[lane];
+		slot->fbmod = (Bit16s)soa->val[soa_fbmod + lane];
+		slot->prout[0] = (Bit16s)soa->prout[0][lane];
+		slot->prout[1] = (Bit16s)soa->prout[1][lane];
+		slot->pg_phase = soa->pg_phase[lane];
+		slot->eg_rout = (Bit16s)soa->eg_rout[lane];
+		slot->eg_out = (Bit16s)soa->eg_out[lane];
+		slot->eg_inc = (Bit8u)soa->eg_inc[lane];
+		slot->eg_gen = (Bit8u)soa->eg_gen[lane];
+		slot->eg_rate = (Bit8u)soa->eg_rate[lane];
+	}
+}
+
+Bit32s soa_mix(opl_chip *chip, opl_soa *soa, int side) {
+	Bit32s mix = 0;
+	for (Bit8u ii = 0; ii < 18; ii++) {
+		const Bit8u *src = soa->mix[side][ii];
+		Bit16s accm = soa->val[src[0]] + soa->val[src[1]] + soa->val[src[2]] + soa->val[src[3]];
+		if (chip->FullPan) {
+			mix += (Bit16s)(accm * (side ? chip->channel[ii].fchb : chip->channel[ii].fcha));
+		}
+		else {
+			mix += (Bit16s)(accm & (side ? chip->channel[ii].chb : chip->channel[ii].cha));
+		}
+	}
+	return mix;
+}
+
+void chip_generate_soa(opl_chip *chip, opl_soa *soa, const opl_soatables *tables, Bit16s *buff) {
+	buff[1] = limshort(chip->mixbuff[1]);
+
+	// The hi-hat is generated before the top cymbal's phase gets updated.
+	Bit32u phase17 = soa->pg_phase[soa->lane[17]];
+
+	tables->slots(soa, tables, chip->timer, (chip->timer >> 10) & 0x07, chip->tremval);
+	for (Bit32u group = 0; group < soa_groups - 1; group++) {
+		if (soa->group[group] < soa->group[group + 1]) {
+			tables->operators(soa, tables, soa->group[group], soa->group[group + 1]);
+		}
+	}
+
+	if (soa->rhythm) {
+		Bit32u hh = soa->lane[13], tt = soa->lane[14], sd = soa->lane[16], tc = soa->lane[17];
+		Bit16u phase14 = (soa->pg_phase[hh] >> 9) & 0x3ff;
+		Bit16u phase17old = (phase17 >> 9) & 0x3ff;
+		phase17 = (soa->pg_phase[tc] >> 9) & 0x3ff;
+		//hh
+		Bit16u phasebit = ((phase14 & 0x08) | (((phase14 >> 5) ^ phase14) & 0x04) | (((phase17old >> 2) ^ phase17old) & 0x08)) ? 0x01 : 0x00;
+		Bit16u phase = (phasebit << 9) | (0x34 << ((phasebit ^ (chip->noise & 0x01) << 1)));
+		soa->val[hh] = soa_wave(tables, soa->wf[hh], phase, soa->eg_out[hh]);
+		//tt
+		soa->val[tt] = soa_wave(tables, soa->wf[tt], (Bit16u)(soa->pg_phase[tt] >> 9), soa->eg_out[tt]);
+		//sd
+		phase = (0x100 << ((phase14 >> 8) & 0x01)) ^ ((chip->noise & 0x01) << 8);
+		soa->val[sd] = soa_wave(tables, soa->wf[sd], phase, soa->eg_out[sd]);
+		//tc
+		phasebit = ((phase14 & 0x08) | (((phase14 >> 5) ^ phase14) & 0x04) | (((phase17 >> 2) ^ phase17) & 0x08)) ? 0x01 : 0x00;
+		phase = 0x100 | (phasebit << 9);
+		soa->val[tc] = soa_wave(tables, soa->wf[tc], phase, soa->eg_out[tc]);
+	}
+
+	chip->mixbuff[0] = soa_mix(chip, soa, 0);
+	chip->mixbuff[1] = soa_mix(chip, soa, 1);
+	buff[0] = limshort(chip->mixbuff[0]);
+
+	chip_step(chip);
+}
+
 void NukedOPL3::Reset() {
+	soa_valid = false;
 	memset(&opl3, 0, sizeof(opl_chip));
 	for (Bit8u slotnum = 0; slotnum < 36; slotnum++) {
 		opl3.slot[slotnum].chip = &opl3;
@@ -916,6 +1414,10 @@ void NukedOPL3::Reset() {
 }
 
 void NukedOPL3::WriteReg(int reg, int v) {
+	if (soa_valid) {
+		soa_store(&opl3, &soa);
+		soa_valid = false;
+	}
 	v &= 0xff;
 	reg &= 0x1ff;
 	Bit8u high = (reg >> 8) & 0x01;
@@ -999,21 +1501,46 @@ void NukedOPL3::WriteReg(int reg, int v) {
 	}
 }
 
+// The slot state stays in soa from one call to the next. It only gets written
+// back and rebuilt when a register write changes the layout.
+void NukedOPL3::Generate(Bit16s *buffer, int numsamples) {
+	if (!soa_valid) {
+		soa_valid = soa_load(&opl3, &soa);
+	}
+	if (soa_valid) {
+		const opl_soatables *tables = soa_tables();
+		for (int i = 0; i < numsamples; i++) {
+			chip_generate_soa(&opl3, &soa, tables, buffer + i * 2);
+		}
+	}
+	else {
+		for (int i = 0; i < numsamples; i++) {
+			chip_generate(&opl3, buffer + i * 2);
+		}
+	}
+}
+
 void NukedOPL3::Update(float* sndptr, int numsamples) {
-	Bit16s buffer[2];
-	for (Bit32u i = 0; i < (Bit32u)numsamples; i++) {
-		chip_generate(&opl3, buffer);
-		*sndptr++ += (float)(buffer[0] / 10240.0);
-		*sndptr++ += (float)(buffer[1] / 10240.0);
+	Bit16s buffer[512];
+	while (numsamples > 0) {
+		int count = numsamples < 256 ? numsamples : 256;
+		Generate(buffer, count);
+		for (int i = 0; i < count * 2; i++) {
+			*sndptr++ += (float)(buffer[i] / 10240.0);
+		}
+		numsamples -= count;
 	}
 }
 
 void NukedOPL3::UpdateS(short *sndptr, int numsamples) {
-	Bit16s buffer[2];
-	for (Bit32u i = 0; i < (Bit32u)numsamples; i++) {
-		chip_generate(&opl3, buffer);
-		*sndptr++ += buffer[0] * 2;
-		*sndptr++ += buffer[1] * 2;
+	Bit16s buffer[512];
+	while (numsamples > 0) {
+		int count = numsamples < 256 ? numsamples : 256;
+		Generate(buffer, count);
+		for (int i = 0; i < count * 2; i++) {
+			*sndptr++ += buffer[i] * 2;
+		}
+		numsamples -= count;
 	}
 }
 
@@ -258,14 +258,10 @@ bool OPLmusicBlock::ServiceStream (void *buff, int numbytes)
 	{
 		int tick_in = int(NextTickIn);
 		int samplesleft = std::min(numsamples, tick_in);
-		size_t i;
 
 		if (samplesleft > 0)
 		{
-			for (i = 0; i < io->NumChips; ++i)
-			{
-				io->chips[i]->Update(samples1, samplesleft);
-			}
+			UpdateChips(samples1, samplesleft);
 			OffsetSamples(samples1, samplesleft << stereoshift);
 			NextTickIn -= samplesleft;
 			assert (NextTickIn >= 0);
@@ -283,10 +279,7 @@ bool OPLmusicBlock::ServiceStream (void *buff, int numbytes)
 				{
 					if (numsamples > 0)
 					{
-						for (i = 0; i < io->NumChips; ++i)
-						{
-							io->chips[i]->Update(samples1, numsamples);
-						}
+						UpdateChips(samples1, numsamples);
 						OffsetSamples(samples1, numsamples << stereoshift);
 					}
 					res = false;
@@ -311,6 +304,62 @@ bool OPLmusicBlock::ServiceStream (void *buff, int numbytes)
 	return res;
 }
 
+void OPLmusicBlock::UpdateChips(float *buff, int numsamples)
+{
+	size_t count = size_t(numsamples) << (int)(FullPan | io->IsOPL3);
+	uint32_t active[OPL_NUM_VOICES];
+	int numactive = 0;
+
+	for (uint32_t chip = 0; chip < io->NumChips; ++chip)
+	{
+		if (!io->IsChipIdle(chip)) active[numactive++] = chip;
+	}
+
+	// Short stretches between ticks are not worth waking other threads for.
+	if (ParallelFor && numactive > 1 && numsamples >= 64)
+	{
+		// Every chip gets its own buffer, they are added in chip order afterward.
+		ChipBuffer.resize(count * numactive);
+		memset(ChipBuffer.data(), 0, ChipBuffer.size() * sizeof(float));
+
+		ParallelFor(numactive, [&](int i)
+		{
+			float *out = &ChipBuffer[count * i];
+			io->chips[active[i]]->Update(out, numsamples);
+			io->UpdateChipActivity(active[i], out, count, numsamples);
+		});
+
+		for (int i = 0; i < numactive; ++i)
+		{
+			const float *in = &ChipBuffer[count * i];
+			for (size_t j = 0; j < count; ++j)
+			{
+				buff[j] += in[j];
+			}
+		}
+		return;
+	}
+
+	// Chips with keys held can't go idle, so only the others need their output checked.
+	for (int i = 0; i < numactive; ++i)
+	{
+		uint32_t chip = active[i];
+		if (io->KeyOn[chip] != 0)
+		{
+			io->chips[chip]->Update(buff, numsamples);
+			continue;
+		}
+		ChipBuffer.resize(count);
+		memset(ChipBuffer.data(), 0, count * sizeof(float));
+		io->chips[chip]->Update(ChipBuffer.data(), numsamples);
+		io->UpdateChipActivity(chip, ChipBuffer.data(), count, numsamples);
+		for (size_t j = 0; j < count; ++j)
+		{
+			buff[j] += ChipBuffer[j];
+		}
+	}
+}
+
 void OPLmusicBlock::OffsetSamples(float *buff, int count)
 {
 	// Three out of four of the OPL waveforms are non-negative. Depending on
@@ -71,6 +71,8 @@ int OPLio::Init(int core, uint32_t numchips, bool stereo, bool initopl3)
 	if (core > 3) core = 3;
 
 	memset(chips, 0, sizeof(chips));
+	memset(KeyOn, 0, sizeof(KeyOn));
+	memset(SilentSamples, 0, sizeof(SilentSamples));
 	if (IsOPL3)
 	{
 		numchips = (numchips + 1) >> 1;
@@ -152,10 +154,44 @@ void OPLio::WriteRegister(int chipnum, uint32_t reg, uint8_t data)
 	}
 	if (chips[chipnum] != nullptr)
 	{
+		uint32_t index = reg & 0xff;
+		if (index >= 0xb0 && index <= 0xb8)
+		{
+			uint32_t bit = 1u << ((index - 0xb0) + ((reg & 0x100) ? 9 : 0));
+			if (data & 0x20) KeyOn[chipnum] |= bit;
+			else KeyOn[chipnum] &= ~bit;
+		}
+		else if (reg == 0xbd)
+		{
+			if (data & 0x1f) KeyOn[chipnum] |= 1u << 18;
+			else KeyOn[chipnum] &= ~(1u << 18);
+		}
+		SilentSamples[chipnum] = 0;
 		chips[chipnum]->WriteReg(reg, data);
 	}
 }
 
+//----------------------------------------------------------------------------
+//
+// Feeds a chip's own output to the idle detection. Anything below -72 dB
+// counts as silence, released notes may hover there for a while.
+//
+//----------------------------------------------------------------------------
+
+void OPLio::UpdateChipActivity(uint32_t chip, const float *buffer, size_t count, int numsamples)
+{
+	if (KeyOn[chip] != 0) return;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (fabsf(buffer[i]) > 1.f / 4096)
+		{
+			SilentSamples[chip] = 0;
+			return;
+		}
+	}
+	if (SilentSamples[chip] < ChipIdleSamples) SilentSamples[chip] += numsamples;
+}
+
 //----------------------------------------------------------------------------
 //
 // 
@@ -223,11 +223,57 @@ struct opl_chip {
 	Bit8u FullPan;
 };
 
+//
+// Structure-of-arrays copy of the slot state, used to generate blocks of samples
+// without register writes in between. Slots are sorted by how many operators
+// modulate them, so each group only needs the output of the groups before it.
+//
+
+enum {
+	soa_lanes = 40,					// 36 slots padded to a multiple of 8
+	soa_prev = soa_lanes,			// outputs of the previous sample
+	soa_fbmod = soa_lanes * 2,		// feedback of each slot
+	soa_zero = soa_lanes * 3,		// always 0
+	soa_groups = 5					// 4 modulation depths and the rhythm slots
+};
+
+struct opl_soa {
+	Bit32s val[soa_lanes * 3 + 8];
+	Bit32s prout[2][soa_lanes];
+	Bit32s fb_on[soa_lanes];		// ~0 if the channel has feedback
+	Bit32s fb_shift[soa_lanes];
+	Bit32s mod[soa_lanes];			// index into val
+	Bit32u pg_phase[soa_lanes];
+	Bit32u pg_inc[8][soa_lanes];	// phase step for each vibrato position
+	Bit32u phase[soa_lanes];
+	Bit32s eg_rout[soa_lanes];
+	Bit32s eg_out[soa_lanes];
+	Bit32s eg_inc[soa_lanes];
+	Bit32s eg_gen[soa_lanes];
+	Bit32s eg_rate[soa_lanes];
+	Bit32s eg_rate_dr[soa_lanes];
+	Bit32s eg_rate_rr[soa_lanes];
+	Bit32s eg_base[soa_lanes];
+	Bit32s eg_trem[soa_lanes];
+	Bit32s eg_sl[soa_lanes];
+	Bit32s eg_type[soa_lanes];
+	Bit32u wf[soa_lanes];			// waveform << 10
+	Bit8u slot[soa_lanes];			// chip slot of each lane
+	Bit8u lane[36];					// lane of each chip slot
+	Bit8u group[soa_groups + 1];	// first lane of each group
+	Bit8u mix[2][18][4];			// val index of each channel output
+	bool rhythm;
+};
+
 
 class NukedOPL3 : public OPLEmul {
 private:
 	opl_chip opl3;
+	opl_soa soa;
+	bool soa_valid;		// the slot state lives in soa and opl3's copy is out of date
 	bool FullPan;
+
+	void Generate(Bit16s *buffer, int numsamples);
 public:
 	void Reset();
 	void Update(float* sndptr, int numsamples);
@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <mutex>
 #include <vector>
 #include <string>
@@ -15,10 +16,17 @@ public:
 
 	virtual void Restart();
 
+	// Lets the host render the chips on several threads. It must call job(0) ... job(count-1)
+	// and return when all of them are done. Without it the chips get rendered one after another.
+	std::function<void(int count, const std::function<void(int)> &job)> ParallelFor;
+
 protected:
 	virtual int PlayTick() = 0;
+	void UpdateChips(float *buff, int numsamples);
 	void OffsetSamples(float *buff, int count);
 
+	std::vector<float> ChipBuffer;
+
 	uint8_t *score;
 	uint8_t *scoredata;
 	double NextTickIn;
@@ -79,7 +79,15 @@ struct OPLio
 	virtual void SetClockRate(double samples_per_tick);
 	virtual void WriteDelay(int ticks);
 
+	// Idle detection for skipping chips that can't be heard. A chip goes idle when it has
+	// no keys held and its output stayed inaudible for a while. Any register write wakes it.
+	enum { ChipIdleSamples = 4096 };
+	bool IsChipIdle(uint32_t chip) const { return KeyOn[chip] == 0 && SilentSamples[chip] >= ChipIdleSamples; }
+	void UpdateChipActivity(uint32_t chip, const float *buffer, size_t count, int numsamples);
+
 	class OPLEmul *chips[OPL_NUM_VOICES];
+	uint32_t KeyOn[OPL_NUM_VOICES];			// channels with the key on bit set, bit 18 is the rhythm section
+	uint32_t SilentSamples[OPL_NUM_VOICES];
 	uint32_t NumChannels;
 	uint32_t NumChips;
 	bool IsOPL3;
@@ -1134,6 +1134,37 @@ static int SendStereoAudio(int         samples_requested,
 }
 
 
+/* Mixes every chip into the zero filled out_buf. Chips which went idle are not emulated until they get written to again. */
+static void generateAndMixChips(MidiPlayer *player, int32_t *out_buf, size_t frames)
+{
+    Synth &synth = *player->m_synth;
+    unsigned int chips = synth.m_numChips;
+
+#if defined(OPNMIDI_AUDIO_TICK_HANDLER) || defined(OPNMIDI_MIDI2VGM)
+    // The audio tick handler and the VGM dumper need every chip to run
+    for(unsigned card = 0; card < chips; ++card)
+        synth.m_chips[card]->generateAndMix32(out_buf, frames);
+#else
+    // Chips with keys held can't go idle, so only the others need their output checked
+    player->m_chipBuf.resize(frames * 2);
+    int32_t *buf = player->m_chipBuf.data();
+    for(unsigned card = 0; card < chips; ++card)
+    {
+        if(synth.isChipIdle(card))
+            continue;
+        if(synth.isChipKeyed(card))
+        {
+            synth.m_chips[card]->generateAndMix32(out_buf, frames);
+            continue;
+        }
+        synth.m_chips[card]->generate32(buf, frames);
+        synth.updateChipActivity(card, buf, frames);
+        for(size_t i = 0; i < frames * 2; ++i)
+            out_buf[i] += buf[i];
+    }
+#endif
+}
+
 OPNMIDI_EXPORT int opn2_play(struct OPN2_MIDIPlayer *device, int sampleCount, short *out)
 {
     return opn2_playFormat(device, sampleCount, (OPN2_UInt8 *)out, (OPN2_UInt8 *)(out + 1), &opn2_DefaultAudioFormat);
@@ -1213,8 +1244,7 @@ OPNMIDI_EXPORT int opn2_playFormat(OPN2_MIDIPlayer *device, int sampleCount,
             else/* if(n_periodCountStereo > 0)*/
             {
                 /* Generate data from every chip and mix result */
-                for(size_t card = 0; card < chips; ++card)
-                    synth.m_chips[card]->generateAndMix32(out_buf, (size_t)in_generatedStereo);
+                generateAndMixChips(player, out_buf, (size_t)in_generatedStereo);
             }
             /* Process it */
             if(SendStereoAudio(sampleCount, in_generatedStereo, out_buf, gotten_len, out_left, out_right, format) == -1)
@@ -1291,8 +1321,7 @@ OPNMIDI_EXPORT int opn2_generateFormat(struct OPN2_MIDIPlayer *device, int sampl
             else/* if(n_periodCountStereo > 0)*/
             {
                 /* Generate data from every chip and mix result */
-                for(size_t card = 0; card < chips; ++card)
-                    synth.m_chips[card]->generateAndMix32(out_buf, (size_t)in_generatedStereo);
+                generateAndMixChips(player, out_buf, (size_t)in_generatedStereo);
             }
             /* Process it */
             if(SendStereoAudio(sampleCount, in_generatedStereo, out_buf, gotten_len, out_left, out_right, format) == -1)
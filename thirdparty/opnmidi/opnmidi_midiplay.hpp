@@ -653,6 +653,9 @@ public:
     //! Generator output buffer
     int32_t m_outBuf[1024];
 
+    //! Output buffer of a chip for idle detection
+    std::vector<int32_t> m_chipBuf;
+
     //! Synthesizer setup
     Setup m_setup;
 
@@ -276,16 +276,68 @@ bool OPN2::setupLocked()
             m_musicMode == MODE_RSXX);
 }
 
+static void trackChipWrite(OPN2::ChipActivity &activity, uint8_t port, uint8_t index, uint8_t value)
+{
+    // Key on/off of all channels goes through 0x28 of the first port.
+    // The OPNA rhythm and SSG sections have no held keys and are left to the silence check.
+    if(port == 0 && index == 0x28)
+    {
+        uint32_t bit = 1u << (value & 7);
+        if(value & 0xF0)
+            activity.keyOn |= bit;
+        else
+            activity.keyOn &= ~bit;
+    }
+    activity.silentFrames = 0;
+}
+
 void OPN2::writeReg(size_t chip, uint8_t port, uint8_t index, uint8_t value)
 {
+    if(chip < m_chipActivity.size())
+        trackChipWrite(m_chipActivity[chip], port, index, value);
     m_chips[chip]->writeReg(port, index, value);
 }
 
 void OPN2::writeRegI(size_t chip, uint8_t port, uint32_t index, uint32_t value)
 {
+    if(chip < m_chipActivity.size())
+        trackChipWrite(m_chipActivity[chip], port, static_cast<uint8_t>(index), static_cast<uint8_t>(value));
     m_chips[chip]->writeReg(port, static_cast<uint8_t>(index), static_cast<uint8_t>(value));
 }
 
+bool OPN2::isChipKeyed(size_t chip) const
+{
+    return chip >= m_chipActivity.size() || m_chipActivity[chip].keyOn != 0;
+}
+
+bool OPN2::isChipIdle(size_t chip) const
+{
+    if(chip >= m_chipActivity.size())
+        return false;
+    const ChipActivity &activity = m_chipActivity[chip];
+    return activity.keyOn == 0 && activity.silentFrames >= ChipIdleFrames;
+}
+
+void OPN2::updateChipActivity(size_t chip, const int32_t *frames, size_t count)
+{
+    if(chip >= m_chipActivity.size())
+        return;
+    ChipActivity &activity = m_chipActivity[chip];
+    if(activity.keyOn != 0)
+        return;
+    for(size_t i = 0; i < count * 2; ++i)
+    {
+        // Anything above one LSB counts as sound, released notes may hover there for a while
+        if(frames[i] > 1 || frames[i] < -1)
+        {
+            activity.silentFrames = 0;
+            return;
+        }
+    }
+    if(activity.silentFrames < ChipIdleFrames)
+        activity.silentFrames += static_cast<uint32_t>(count);
+}
+
 void OPN2::writePan(size_t chip, uint32_t index, uint32_t value)
 {
     m_chips[chip]->writePan(static_cast<uint16_t>(index), static_cast<uint8_t>(value));
@@ -808,6 +860,7 @@ void OPN2::reset(int emulator, unsigned long PCM_RATE, OPNFamily family, void *a
     for(size_t chip = 0; chip < m_numChips; ++chip)
         initChip(chip);
 
+    m_chipActivity.assign(m_numChips, ChipActivity());
     silenceAll();
 #ifdef OPNMIDI_MIDI2VGM
     if(m_loopStartHook) // Post-initialization Loop Start hook (fix for loop edge passing clicks)
@@ -45,6 +45,20 @@ public:
     char _padding[4];
     //! Running chip emulators
     std::vector<AdlMIDI_SPtr<OPNChipBase > > m_chips;
+
+    //! Activity of one chip, used to skip emulating chips which can't be heard
+    struct ChipActivity
+    {
+        ChipActivity() : keyOn(0), silentFrames(0) {}
+        //! Channels with any operator keyed on, indexed like the low bits of register 0x28
+        uint32_t keyOn;
+        //! Frames of inaudible output since the last register write
+        uint32_t silentFrames;
+    };
+    //! Silent frames after which a chip without keys held is no longer emulated
+    enum { ChipIdleFrames = 4096 };
+    //! Activity of every running chip
+    std::vector<ChipActivity> m_chipActivity;
 #ifdef OPNMIDI_MIDI2VGM
     //! Loop Start hook
     void (*m_loopStartHook)(void*);
@@ -238,6 +252,27 @@ public:
      */
     void writePan(size_t chip, uint32_t index, uint32_t value);
 
+    /**
+     * @brief Is any channel of the chip keyed on?
+     * @param chip Index of emulated chip
+     */
+    bool isChipKeyed(size_t chip) const;
+
+    /**
+     * @brief Can the chip skip emulation? True when no keys are held and it produced
+     * only inaudible output since its last register write. Any write wakes it up again
+     * @param chip Index of emulated chip
+     */
+    bool isChipIdle(size_t chip) const;
+
+    /**
+     * @brief Feed the chip's freshly generated output to the idle detection
+     * @param chip Index of emulated chip
+     * @param frames Generated stereo frames
+     * @param count Number of frames
+     */
+    void updateChipActivity(size_t chip, const int32_t *frames, size_t count);
+
     /**
      * @brief Off the note in specified chip channel
      * @param c Channel of chip (Emulated chip choosing by next formula: [c = ch + (chipId * 23)])
@@ -5001,7 +5001,7 @@ void Player::do_compute_data(int32_t count)
 	current_sample += count;
 }
 
-int Player::compute_data(float *buffer, int32_t count)
+int Player::compute_data(int32_t *buffer, int32_t count)
 {
 	if (count == 0) return RC_OK;
 
@@ -5015,22 +5015,20 @@ int Player::compute_data(float *buffer, int32_t count)
 		last_reverb_setting = timidity_reverb;
 	}
 
-	buffer_pointer = common_buffer;
 	computed_samples += count;
 
+	// Mix straight into the caller's buffer.
 	while (count > 0)
 	{
 		int process = std::min(count, AUDIO_BUFFER_SIZE);
+		buffer_pointer = buffer;
 		do_compute_data(process);
 		count -= process;
 
-		effect->do_effect(common_buffer, process);
-		// pass to caller
-		for (int i = 0; i < process*2; i++)
-		{
-			*buffer++ = (common_buffer[i])*(5.f / 0x80000000u);
-		}
+		effect->do_effect(buffer, process);
+		buffer += process * 2;
 	}
+	buffer_pointer = common_buffer;
 	return RC_OK;
 }
 
@@ -748,7 +748,7 @@ public:
 	void recompute_freq(int v);
 	int get_default_mapID(int ch);
 	void init_channel_layer(int ch);
-	int compute_data(float *buffer, int32_t count);
+	int compute_data(int32_t *buffer, int32_t count);	// output is the raw 32 bit mix, conversion is left to the caller
 	int send_event(int status, int parm1, int parm2);
 	void send_long_event(const uint8_t *sysexbuffer, int exlen);
 };
@@ -108,7 +108,7 @@ public:
 
 	void ShortEvent(int status, int parm1, int parm2);
 	void LongEvent(const unsigned char *data, int len);
-	void ComputeOutput(float *buffer, int len);
+	void ComputeOutput(int *buffer, int len);	// output is the raw 32 bit mix, conversion is left to the caller
 	void LoadInstrument(int bank, int percussion, int instr);
 	int GetVoiceCount();
 	int SetOption(int opt, int set);
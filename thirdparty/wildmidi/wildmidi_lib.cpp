@@ -2651,19 +2651,13 @@ void Renderer::LongEvent(const unsigned char *data, int len)
 	}
 }
 
-void Renderer::ComputeOutput(float *fbuffer, int len)
+void Renderer::ComputeOutput(int *buffer, int len)
 {
 	_mdi *mdi = (_mdi *)handle;
-	int *buffer = (int *)fbuffer;
-	int *newbuf = WM_Mix(handle, buffer, len);
-//	assert(newbuf - buffer == len);
+	WM_Mix(handle, buffer, len);
 	if (mdi->info.mixer_options & WM_MO_REVERB) {
 		_WM_do_reverb(mdi->reverb, buffer, len * 2);
 	}
-	for (; buffer < newbuf; ++buffer)
-	{
-		*(float *)buffer = (float)*buffer * (1.3f / 32768.f);	// boost the volume because Wildmidi is far more quiet than the other synths and therefore hard to balance.
-	}
 }
 
 void Renderer::LoadInstrument(int bank, int percussion, int instr)
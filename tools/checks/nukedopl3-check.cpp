@@ -0,0 +1,208 @@
+/*
+** nukedopl3-check.cpp
+** Checks that the Nuked OPL3 block generator matches chip_generate bit for bit
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** Two chips get the same stream of random register writes, including 4-op
+** and rhythm mode. One renders with NukedOPL3::Generate, the other sample by
+** sample with chip_generate. Any difference in the output or the slot state
+** fails the check. Run with "portable" or "avx2" to pick the kernels.
+**
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// The check needs to get at the chip state and the scalar path.
+#define private public
+#include "../../thirdparty/oplsynth/nukedopl3.cpp"
+#undef private
+
+using namespace NukedOPL3;
+
+enum { SKIPPED = 77 };
+
+static uint32_t Seed = 12345;
+
+static uint32_t Random()
+{
+	Seed = Seed * 1664525 + 1013904223;
+	return Seed >> 8;
+}
+
+// Returns the first slot whose state differs, 36 for the chip state, or -1.
+static int CompareState(const opl_chip *a, const opl_chip *b)
+{
+	for (int i = 0; i < 36; i++)
+	{
+		const opl_slot &x = a->slot[i], &y = b->slot[i];
+		if (x.out != y.out || x.fbmod != y.fbmod || x.prout[0] != y.prout[0] || x.prout[1] != y.prout[1] ||
+			x.eg_rout != y.eg_rout || x.eg_out != y.eg_out || x.eg_inc != y.eg_inc || x.eg_gen != y.eg_gen ||
+			x.eg_rate != y.eg_rate || x.pg_phase != y.pg_phase)
+		{
+			return i;
+		}
+	}
+	if (a->timer != b->timer || a->noise != b->noise || a->tremval != b->tremval ||
+		a->mixbuff[0] != b->mixbuff[0] || a->mixbuff[1] != b->mixbuff[1])
+	{
+		return 36;
+	}
+	return -1;
+}
+
+static int RandomRegister(int mode)
+{
+	int high = (mode != 0 && (Random() & 1)) ? 0x100 : 0;
+	switch (Random() % 10)
+	{
+	case 0: return high | (0x20 + Random() % 0x16);
+	case 1: return high | (0x40 + Random() % 0x16);
+	case 2: return high | (0x60 + Random() % 0x16);
+	case 3: return high | (0x80 + Random() % 0x16);
+	case 4: return high | (0xe0 + Random() % 0x16);
+	case 5: return high | (0xa0 + Random() % 9);
+	case 6:
+	case 7: return high | (0xb0 + Random() % 9);
+	case 8: return high | (0xc0 + Random() % 9);
+	// Rhythm mode, note select and the 4-op connections
+	default: return mode >= 2 ? 0xbd : (Random() & 1) ? 0x08 : 0x104;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	opl_soatables *tables = const_cast<opl_soatables *>(soa_tables());
+	const char *kernels = argc > 1 ? argv[1] : "portable";
+	if (!strcmp(kernels, "portable"))
+	{
+		tables->slots = soa_slots;
+		tables->operators = soa_operators;
+	}
+	else if (!strcmp(kernels, "avx2"))
+	{
+#ifdef NUKEDOPL3_AVX2
+		if (!soa_hasavx2())
+#endif
+		{
+			printf("AVX2 is not available\n");
+			return SKIPPED;
+		}
+#ifdef NUKEDOPL3_AVX2
+		tables->slots = soa_slots_avx2;
+		tables->operators = soa_operators_avx2;
+#endif
+	}
+	else
+	{
+		fprintf(stderr, "usage: nukedopl3-check [portable|avx2]\n");
+		return 2;
+	}
+
+	for (int wf = 0; wf < 8; wf++)
+	{
+		for (int phase = 0; phase < 0x10000; phase += 7)
+		{
+			for (int env = 0; env < 0x400; env += 3)
+			{
+				if (envelope_sin[wf](phase, env) != (Bit16s)soa_wave(tables, wf << 10, phase, env))
+				{
+					printf("waveform %d differs at phase %d, envelope %d\n", wf, phase, env);
+					return 1;
+				}
+			}
+		}
+	}
+
+	long total = 0;
+	static Bit16s soabuf[2 * 600], scalarbuf[2 * 600];
+	for (int run = 0; run < 40; run++)
+	{
+		bool fullpan = run & 1;
+		// Mode 0 is OPL2, 1 OPL3 with random 4-op channels, 2 and 3 add rhythm mode.
+		int mode = run % 4;
+		NukedOPL3::NukedOPL3 soachip(fullpan), scalarchip(fullpan);
+		auto write = [&](int reg, int value) { soachip.WriteReg(reg, value); scalarchip.WriteReg(reg, value); };
+
+		if (fullpan)
+		{
+			for (int c = 0; c < 18; c++)
+			{
+				float left = (Random() % 1000) / 1000.f;
+				soachip.SetPanning(c, left, 1 - left);
+				scalarchip.SetPanning(c, left, 1 - left);
+			}
+		}
+		if (mode != 0)
+		{
+			write(0x105, 1);
+			write(0x104, Random() & 0x3f);
+		}
+		for (int block = 0; block < 800; block++)
+		{
+			// Some blocks have no writes at all so that the generator state carries over.
+			int writes = Random() % 12;
+			for (int i = 0; i < writes; i++)
+			{
+				int reg = RandomRegister(mode);
+				int value = Random() & 0xff;
+				// Fast attack and decay now and then, so that envelopes actually run through.
+				if ((reg & 0xf0) == 0x60 && (Random() & 1)) value |= 0x88;
+				write(reg, value);
+			}
+
+			int samples = 1 + Random() % 600;
+			soachip.Generate(soabuf, samples);
+			for (int i = 0; i < samples; i++)
+			{
+				chip_generate(&scalarchip.opl3, scalarbuf + i * 2);
+			}
+			total += samples;
+			if (memcmp(soabuf, scalarbuf, samples * 2 * sizeof(Bit16s)))
+			{
+				printf("%s: output differs in run %d, block %d\n", kernels, run, block);
+				return 1;
+			}
+			if (soachip.soa_valid)
+			{
+				soa_store(&soachip.opl3, &soachip.soa);
+			}
+			int slot = CompareState(&soachip.opl3, &scalarchip.opl3);
+			if (slot >= 0)
+			{
+				printf("%s: state of slot %d differs in run %d, block %d\n", kernels, slot, run, block);
+				return 1;
+			}
+		}
+	}
+	printf("%s: %ld samples identical\n", kernels, total);
+	return 0;
+}
@@ -0,0 +1,150 @@
+/*
+** resampler-check.cpp
+** Checks the stream resampler against a directly computed reference
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+** Sine waves at the OPL chip's native rate get converted to 44100 and 48000
+** Hz through StreamResampler with the highest quality. The output has to
+** match the same sine sampled at the output rate everywhere, including the
+** frames just after the source reports its end.
+**
+*/
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+#include "resampler.h"
+#include "midiconfig.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Only StreamResampler::Create looks at this and the check does not use it.
+thread_local ZMusicContext *currentContext;
+
+enum
+{
+	InputRate = 49716,
+	InputFrames = 49716 * 2,
+	BufferFrames = 1000,
+};
+
+//==========================================================================
+//
+// Resamples a stereo sine and returns the worst error in dB
+//
+//==========================================================================
+
+static bool CheckRate(int outrate, double freq)
+{
+	SoundStreamInfoEx source = { 0, InputRate, SampleType_Float32, ChannelConfig_Stereo };
+	StreamResampler resampler(source, outrate, PolyphaseResampler::MaxQuality);
+
+	int inpos = 0;
+	auto sine = [&](void *buff, int len)
+	{
+		float *out = (float *)buff;
+		int frames = len / (2 * sizeof(float));
+		for (int i = 0; i < frames; i++, inpos++)
+		{
+			float v = inpos < InputFrames ? (float)(0.5 * sin(2 * M_PI * freq * inpos / InputRate)) : 0.f;
+			out[i * 2] = v;
+			out[i * 2 + 1] = -v;
+		}
+		return inpos < InputFrames;
+	};
+
+	std::vector<float> output;
+	float buffer[BufferFrames * 2];
+	bool more = true;
+	while (more)
+	{
+		more = resampler.Fill(buffer, sizeof(buffer), sine);
+		output.insert(output.end(), buffer, buffer + BufferFrames * 2);
+		if (output.size() > size_t(outrate) * 2 * 10)
+		{
+			printf("%d Hz: the output does not end\n", outrate);
+			return false;
+		}
+	}
+
+	// Every output frame up to the last input frame has to be there, however the blocks fell.
+	size_t expected = (size_t(InputFrames - 1) * outrate) / InputRate + 1;
+	if (output.size() / 2 < expected)
+	{
+		printf("%d Hz: %zu frames, expected %zu\n", outrate, output.size() / 2, expected);
+		return false;
+	}
+
+	// The edges of the input are a step that rings through the filter, so leave them out.
+	size_t margin = outrate / 100;
+	double worst = 0;
+	for (size_t i = margin; i + margin < expected; i++)
+	{
+		double ref = 0.5 * sin(2 * M_PI * freq * i / outrate);
+		worst = std::max(worst, fabs(output[i * 2] - ref));
+		worst = std::max(worst, fabs(output[i * 2 + 1] + ref));
+	}
+	// The tail must not be cut off by the filter delay.
+	double tail = 0;
+	for (size_t i = expected - margin; i < expected; i++)
+	{
+		tail = std::max<double>(tail, fabs(output[i * 2]));
+	}
+
+	double db = 20 * log10(std::max(worst, 1e-12) / 0.5);
+	printf("%d Hz, %g Hz sine: error %.1f dB\n", outrate, freq, db);
+	if (db > -80)
+	{
+		printf("%d Hz: the output does not match the reference\n", outrate);
+		return false;
+	}
+	if (tail < 0.25)
+	{
+		printf("%d Hz: the end of the input is missing\n", outrate);
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	static const double freqs[] = { 440, 1000, 5000, 12000 };
+	bool ok = true;
+	for (int outrate : { 44100, 48000 })
+	{
+		for (double freq : freqs)
+		{
+			ok &= CheckRate(outrate, freq);
+		}
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,748 @@
+/*
+** zmusic-bench.cpp
+** Measures how fast every backend renders a fixed set of songs
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The MIDI, IT, VGM and WAV songs are generated here, so that the numbers
+** do not depend on anything outside the repository. Compressed formats
+** (OGG, MP3, FLAC etc.) cannot be generated without an encoder, so those
+** come from an optional corpus directory, together with anything else
+** that should be measured.
+**
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <zmusic.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static const double Pi = 3.14159265358979323846;
+
+struct Options
+{
+	int SampleRate = 44100;
+	int Seconds = 60;
+	std::string Filter;
+	fs::path Corpus;
+	std::string DeviceData[MDEV_COUNT];
+};
+
+struct Song
+{
+	std::string Name;
+	std::vector<uint8_t> Data;
+	bool IsMIDI;
+};
+
+static void MessageFunc(int severity, const char *msg)
+{
+	if (severity >= ZMUSIC_MSG_WARNING) fprintf(stderr, "%s", msg);
+}
+
+//==========================================================================
+//
+// Peak resident set size of the process so far, in KiB
+//
+//==========================================================================
+
+static uint64_t PeakRSS()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return pmc.PeakWorkingSetSize / 1024;
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;	// bytes here
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+//==========================================================================
+//
+// Little endian writers for the generated files
+//
+//==========================================================================
+
+static void Put8(std::vector<uint8_t> &out, int value)
+{
+	out.push_back(uint8_t(value));
+}
+
+static void PutLE(std::vector<uint8_t> &out, uint32_t value, int size)
+{
+	for (int i = 0; i < size; i++) out.push_back((value >> (i * 8)) & 255);
+}
+
+static void PutBE(std::vector<uint8_t> &out, uint32_t value, int size)
+{
+	for (int i = size - 1; i >= 0; i--) out.push_back((value >> (i * 8)) & 255);
+}
+
+static void PokeLE(std::vector<uint8_t> &out, size_t pos, uint32_t value, int size)
+{
+	for (int i = 0; i < size; i++) out[pos + i] = (value >> (i * 8)) & 255;
+}
+
+static void PutString(std::vector<uint8_t> &out, const char *str, size_t size)
+{
+	size_t len = strlen(str);
+	for (size_t i = 0; i < size; i++) out.push_back(i < len ? str[i] : 0);
+}
+
+//==========================================================================
+//
+// MakeDenseMIDI
+//
+// All 16 channels play three note chords on every 16th note, with pan,
+// expression and pitch bend changes on every beat. This is about 800
+// events per second, which is far more than a typical game song.
+//
+//==========================================================================
+
+static void PutVarLen(std::vector<uint8_t> &out, uint32_t value)
+{
+	uint8_t buffer[5];
+	int count = 0;
+	do
+	{
+		buffer[count++] = value & 127;
+		value >>= 7;
+	} while (value != 0);
+	while (count-- > 0) out.push_back(buffer[count] | (count > 0 ? 128 : 0));
+}
+
+static std::vector<uint8_t> MakeDenseMIDI()
+{
+	const int division = 96;
+	const int steps = 16 * 16;	// 16 bars at 120 bpm: 32 seconds.
+	std::vector<uint8_t> track;
+	uint32_t delta = 0;
+	auto event = [&](int status, int p1, int p2)
+	{
+		PutVarLen(track, delta);
+		delta = 0;
+		Put8(track, status);
+		Put8(track, p1);
+		if (p2 >= 0) Put8(track, p2);
+	};
+
+	// tempo: 120 bpm
+	PutVarLen(track, 0);
+	Put8(track, 0xff); Put8(track, 0x51); Put8(track, 3);
+	PutBE(track, 500000, 3);
+	for (int ch = 0; ch < 16; ch++)
+	{
+		event(0xc0 | ch, (ch * 8 + 3) & 127, -1);
+		event(0xb0 | ch, 7, 100);
+	}
+
+	int lastnote[16][3] = {};
+	for (int step = 0; step < steps; step++)
+	{
+		for (int ch = 0; ch < 16; ch++)
+		{
+			for (int i = 0; i < 3 && step > 0; i++) event(0x80 | ch, lastnote[ch][i], 64);
+			if ((step & 3) == 0)
+			{
+				event(0xb0 | ch, 10, (step * 5 + ch * 8) & 127);
+				event(0xb0 | ch, 11, 80 + ((step + ch) & 31));
+				event(0xe0 | ch, 0, 64 + ((step + ch) & 15) - 8);
+			}
+			int root = ch == 9 ? 35 + (step + ch) % 12 : 36 + (ch * 5 + step * 7) % 36;
+			for (int i = 0; i < 3; i++)
+			{
+				lastnote[ch][i] = root + i * 4;
+				event(0x90 | ch, lastnote[ch][i], 70 + ((step * 3 + i * 11) & 31));
+			}
+		}
+		delta = division / 4;
+	}
+	for (int ch = 0; ch < 16; ch++)
+	{
+		for (int i = 0; i < 3; i++) event(0x80 | ch, lastnote[ch][i], 64);
+	}
+	PutVarLen(track, 0);
+	Put8(track, 0xff); Put8(track, 0x2f); Put8(track, 0);
+
+	std::vector<uint8_t> out;
+	PutString(out, "MThd", 4);
+	PutBE(out, 6, 4);
+	PutBE(out, 0, 2);
+	PutBE(out, 1, 2);
+	PutBE(out, division, 2);
+	PutString(out, "MTrk", 4);
+	PutBE(out, (uint32_t)track.size(), 4);
+	out.insert(out.end(), track.begin(), track.end());
+	return out;
+}
+
+//==========================================================================
+//
+// MakeIT
+//
+// One looped single cycle sample, retriggered on all 64 channels on
+// every row with a different note and volume.
+//
+//==========================================================================
+
+static std::vector<uint8_t> MakeIT()
+{
+	const int channels = 64;
+	const int rows = 64;
+	const int samplelength = 256;
+
+	std::vector<uint8_t> pattern;
+	for (int row = 0; row < rows; row++)
+	{
+		for (int ch = 0; ch < channels; ch++)
+		{
+			Put8(pattern, (ch + 1) | 128);
+			Put8(pattern, 1 | 2 | 4);	// note, instrument, volume
+			Put8(pattern, 36 + (ch * 5 + row * 7) % 60);
+			Put8(pattern, 1);
+			Put8(pattern, 16 + (ch + row * 3) % 49);
+		}
+		Put8(pattern, 0);
+	}
+
+	std::vector<uint8_t> out;
+	PutString(out, "IMPM", 4);
+	PutString(out, "zmusic-bench", 26);
+	PutLE(out, 0x1004, 2);		// pattern row highlight
+	PutLE(out, 2, 2);			// orders, including the end marker
+	PutLE(out, 0, 2);			// instruments
+	PutLE(out, 1, 2);			// samples
+	PutLE(out, 1, 2);			// patterns
+	PutLE(out, 0x214, 2);		// created with
+	PutLE(out, 0x214, 2);		// compatible with
+	PutLE(out, 1 | 8, 2);		// stereo, linear slides
+	PutLE(out, 0, 2);
+	Put8(out, 128);				// global volume
+	Put8(out, 48);				// mixing volume
+	Put8(out, 6);				// speed
+	Put8(out, 125);				// tempo
+	Put8(out, 128);				// stereo separation
+	Put8(out, 0);
+	PutLE(out, 0, 2);			// message
+	PutLE(out, 0, 4);
+	PutLE(out, 0, 4);
+	for (int i = 0; i < 64; i++) Put8(out, (i * 21) % 65);
+	for (int i = 0; i < 64; i++) Put8(out, 64);
+
+	Put8(out, 0);				// orders
+	Put8(out, 255);
+	size_t sampleofs = out.size();
+	PutLE(out, 0, 4);
+	size_t patternofs = out.size();
+	PutLE(out, 0, 4);
+
+	size_t sampleheader = out.size();
+	PokeLE(out, sampleofs, (uint32_t)sampleheader, 4);
+	PutString(out, "IMPS", 4);
+	PutString(out, "", 12);
+	Put8(out, 0);
+	Put8(out, 64);				// global volume
+	Put8(out, 1 | 16);			// has data, looped
+	Put8(out, 64);				// volume
+	PutString(out, "wave", 26);
+	Put8(out, 1);				// signed
+	Put8(out, 32);				// default pan, disabled
+	PutLE(out, samplelength, 4);
+	PutLE(out, 0, 4);
+	PutLE(out, samplelength, 4);
+	PutLE(out, uint32_t(samplelength * 261.63), 4);	// C-5 plays the cycle at middle C
+	PutLE(out, 0, 4);
+	PutLE(out, 0, 4);
+	PutLE(out, uint32_t(sampleheader + 80), 4);	// the data follows the header
+	PutLE(out, 0, 4);			// vibrato
+	for (int i = 0; i < samplelength; i++)
+	{
+		double x = i * 2 * Pi / samplelength;
+		Put8(out, int(80 * sin(x) + 30 * sin(3 * x)) & 255);
+	}
+
+	PokeLE(out, patternofs, (uint32_t)out.size(), 4);
+	PutLE(out, (uint32_t)pattern.size(), 2);
+	PutLE(out, rows, 2);
+	PutLE(out, 0, 4);
+	out.insert(out.end(), pattern.begin(), pattern.end());
+	return out;
+}
+
+//==========================================================================
+//
+// MakeVGM
+//
+// A Mega Drive style tune: arpeggios on all six YM2612 channels plus the
+// three SN76489 tone channels, changing every eighth of a second.
+//
+//==========================================================================
+
+static std::vector<uint8_t> MakeVGM()
+{
+	const uint32_t fmclock = 7670453, psgclock = 3579545;
+	const int steps = 240;
+	const int stepsamples = 44100 / 8;
+
+	std::vector<uint8_t> data;
+	auto fm = [&](int ch, int reg, int value)
+	{
+		Put8(data, ch < 3 ? 0x52 : 0x53);
+		Put8(data, reg);
+		Put8(data, value);
+	};
+	auto psg = [&](int value)
+	{
+		Put8(data, 0x50);
+		Put8(data, value);
+	};
+	static const int opoffsets[] = { 0, 8, 4, 12 };
+
+	fm(0, 0x22, 0);
+	fm(0, 0x27, 0);
+	fm(0, 0x2b, 0);
+	for (int ch = 0; ch < 6; ch++)
+	{
+		int c = ch % 3;
+		for (int op = 0; op < 4; op++)
+		{
+			int r = opoffsets[op] + c;
+			fm(ch, 0x30 + r, 0x01 + op);
+			fm(ch, 0x40 + r, op == 3 ? 0x08 : 0x28);
+			fm(ch, 0x50 + r, 0x1f);
+			fm(ch, 0x60 + r, 0x06);
+			fm(ch, 0x70 + r, 0x04);
+			fm(ch, 0x80 + r, 0x2f);
+			fm(ch, 0x90 + r, 0);
+		}
+		fm(ch, 0xb0 + c, 0x34);		// feedback 6, algorithm 4
+		fm(ch, 0xb4 + c, 0xc0);
+	}
+
+	for (int step = 0; step < steps; step++)
+	{
+		for (int ch = 0; ch < 6; ch++)
+		{
+			int c = ch % 3;
+			int keych = ch < 3 ? ch : ch + 1;
+			fm(0, 0x28, keych);
+			int note = 48 + (ch * 7 + step * 5) % 24;
+			double freq = 440. * pow(2., (note - 69) / 12.);
+			int block = 4;
+			int fnum = int(freq * (1 << (20 - block)) * 144 / fmclock);
+			fm(ch, 0xa4 + c, (block << 3) | (fnum >> 8));
+			fm(ch, 0xa0 + c, fnum & 255);
+			fm(0, 0x28, 0xf0 | keych);
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			int note = 60 + (c * 4 + step * 3) % 24;
+			int n = int(psgclock / (32 * 440. * pow(2., (note - 69) / 12.)));
+			psg(0x80 | (c << 5) | (n & 15));
+			psg((n >> 4) & 63);
+			psg(0x90 | (c << 5) | (step & 7));
+		}
+		Put8(data, 0x61);
+		PutLE(data, stepsamples, 2);
+	}
+	Put8(data, 0x66);
+
+	std::vector<uint8_t> out;
+	PutString(out, "Vgm ", 4);
+	PutLE(out, uint32_t(0x40 + data.size() - 4), 4);
+	PutLE(out, 0x150, 4);
+	PutLE(out, psgclock, 4);
+	PutLE(out, 0, 4);					// YM2413
+	PutLE(out, 0, 4);					// GD3
+	PutLE(out, steps * stepsamples, 4);
+	PutLE(out, 0x40 - 0x1c, 4);			// loop to the start of the data
+	PutLE(out, steps * stepsamples, 4);
+	PutLE(out, 60, 4);
+	PutLE(out, 9, 2);					// SN76489 feedback
+	Put8(out, 16);						// SN76489 shift register width
+	Put8(out, 0);
+	PutLE(out, fmclock, 4);
+	PutLE(out, 0, 4);					// YM2151
+	PutLE(out, 0x40 - 0x34, 4);
+	PutLE(out, 0, 4);
+	PutLE(out, 0, 4);
+	out.insert(out.end(), data.begin(), data.end());
+	return out;
+}
+
+//==========================================================================
+//
+// MakeWAV
+//
+// 30 seconds of a 16 bit stereo sine sweep, for the libsndfile path.
+//
+//==========================================================================
+
+static std::vector<uint8_t> MakeWAV()
+{
+	const int rate = 44100;
+	const uint32_t frames = rate * 30;
+	std::vector<uint8_t> out;
+	PutString(out, "RIFF", 4);
+	PutLE(out, 36 + frames * 4, 4);
+	PutString(out, "WAVEfmt ", 8);
+	PutLE(out, 16, 4);
+	PutLE(out, 1, 2);
+	PutLE(out, 2, 2);
+	PutLE(out, rate, 4);
+	PutLE(out, rate * 4, 4);
+	PutLE(out, 4, 2);
+	PutLE(out, 16, 2);
+	PutString(out, "data", 4);
+	PutLE(out, frames * 4, 4);
+	out.reserve(out.size() + frames * 4);
+	double phase = 0;
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		phase += 2 * Pi * (110. + 880. * i / frames) / rate;
+		int16_t s = int16_t(12000 * sin(phase));
+		PutLE(out, (uint16_t)s, 2);
+		PutLE(out, (uint16_t)-s, 2);
+	}
+	return out;
+}
+
+//==========================================================================
+//
+// JSON output
+//
+//==========================================================================
+
+static std::string JsonString(const std::string &str)
+{
+	std::string out = "\"";
+	for (unsigned char c : str)
+	{
+		if (c == '"' || c == '\\') out += '\\', out += c;
+		else if (c < 32)
+		{
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			out += buf;
+		}
+		else out += c;
+	}
+	return out + "\"";
+}
+
+//==========================================================================
+//
+// MIDI synths to measure
+//
+//==========================================================================
+
+static const struct { const char *name; EMidiDevice dev; } Devices[] =
+{
+	{ "opl", MDEV_OPL },
+	{ "adl", MDEV_ADL },
+	{ "opn", MDEV_OPN },
+	{ "gus", MDEV_GUS },
+	{ "wildmidi", MDEV_WILDMIDI },
+	{ "timidity", MDEV_TIMIDITY },
+	{ "fluidsynth", MDEV_FLUIDSYNTH },
+};
+
+static const char *DeviceName(int dev)
+{
+	for (auto &d : Devices)
+	{
+		if (d.dev == dev) return d.name;
+	}
+	return "another device";
+}
+
+//==========================================================================
+//
+// Benchmark
+//
+// Opening and starting are measured together because that is when the
+// synths load their instruments.
+//
+//==========================================================================
+
+static void Benchmark(const Options &opt, const Song &song, EMidiDevice device, const char *devname, bool &first)
+{
+	using clock = std::chrono::steady_clock;
+	auto seconds = [](clock::duration d) { return std::chrono::duration<double>(d).count(); };
+
+	std::string error;
+	double opentime = 0, rendertime = 0;
+	uint64_t frames = 0;
+	SoundStreamInfoEx fmt = {};
+
+	auto start = clock::now();
+	auto stream = ZMusic_OpenSongMem(song.Data.data(), song.Data.size(), device, nullptr);
+	if (stream == nullptr || !ZMusic_Start(stream, 0, true))
+	{
+		error = ZMusic_GetLastError();
+		if (error.empty()) error = "Unable to start song";
+	}
+	else
+	{
+		opentime = seconds(clock::now() - start);
+		ZMusic_GetStreamInfoEx(stream, &fmt);
+		// MIDI songs quietly switch to another synth if the requested one cannot be opened.
+		int actual = ZMusic_GetDeviceType(stream);
+		if (device != MDEV_DEFAULT && actual != device)
+		{
+			error = std::string("fell back to ") + DeviceName(actual);
+		}
+		else if (fmt.mSampleRate <= 0)
+		{
+			error = "Song is not streaming";
+		}
+	}
+
+	if (error.empty())
+	{
+		const size_t framesize = (fmt.mChannelConfig == ChannelConfig_Stereo ? 2 : 1) * (fmt.mSampleType == SampleType_Float32 ? 4 : fmt.mSampleType == SampleType_Int16 ? 2 : 1);
+		const size_t blockframes = 4096;
+		std::vector<uint8_t> buffer(blockframes * framesize);
+		uint64_t maxframes = (uint64_t)opt.Seconds * fmt.mSampleRate;
+
+		start = clock::now();
+		while (frames < maxframes)
+		{
+			size_t got = ZMusic_Render(stream, (size_t)std::min<uint64_t>(blockframes, maxframes - frames), buffer.data());
+			if (got == 0) break;
+			frames += got;
+		}
+		rendertime = seconds(clock::now() - start);
+	}
+	if (stream != nullptr) ZMusic_Close(stream);
+
+	printf("%s\n\t\t{ \"song\": %s, \"device\": \"%s\", ", first ? "" : ",", JsonString(song.Name).c_str(), devname);
+	first = false;
+	if (!error.empty())
+	{
+		printf("\"error\": %s }", JsonString(error).c_str());
+		return;
+	}
+	double audiotime = double(frames) / fmt.mSampleRate;
+	printf("\"open_ms\": %.3f, \"samplerate\": %d, \"frames\": %llu, \"render_seconds\": %.6f, \"samples_per_second\": %.0f, \"realtime_factor\": %.2f, \"peak_rss_kb\": %llu }",
+		opentime * 1000, fmt.mSampleRate, (unsigned long long)frames, rendertime,
+		rendertime > 0 ? frames / rendertime : 0., rendertime > 0 ? audiotime / rendertime : 0.,
+		(unsigned long long)PeakRSS());
+	fflush(stdout);
+}
+
+static void Usage()
+{
+	fprintf(stderr,
+		"Usage: zmusic-bench [options]\n"
+		"Renders a generated set of songs through every MIDI synth and stream player\n"
+		"as fast as possible and prints the results as JSON.\n\n"
+		"  -l <seconds>          amount of audio to render per song (default: 60)\n"
+		"  -r <rate>             output sample rate (default: 44100)\n"
+		"  -c <directory>        additional songs to measure, e.g. OGG and MP3 files\n"
+		"  -f <text>             only run the entries whose song or device name contains this\n"
+		"  -i <device>=<file>    instrument data for a MIDI synth:\n"
+		"                        opl=GENMIDI lump, opn=WOPN bank, adl=WOPL bank,\n"
+		"                        gus/timidity/wildmidi=config file, fluidsynth=sound font\n");
+}
+
+static bool SetupDevice(const Options &opt, EMidiDevice dev)
+{
+	auto &file = opt.DeviceData[dev];
+	if (file.empty()) return true;
+
+	std::vector<uint8_t> data;
+	if (dev == MDEV_OPL || dev == MDEV_OPN)
+	{
+		FILE *f = fopen(file.c_str(), "rb");
+		if (f == nullptr) return false;
+		fseek(f, 0, SEEK_END);
+		data.resize(ftell(f));
+		fseek(f, 0, SEEK_SET);
+		bool ok = fread(data.data(), 1, data.size(), f) == data.size();
+		fclose(f);
+		if (!ok) return false;
+	}
+	switch (dev)
+	{
+	case MDEV_OPL:
+		if (data.size() < 8 + 175 * 36) return false;
+		ZMusic_SetGenMidi(data.data() + 8);
+		break;
+	case MDEV_OPN:			ZMusic_SetWgOpn(data.data(), (unsigned)data.size()); break;
+	case MDEV_ADL:
+		ChangeMusicSettingInt(zmusic_adl_use_custom_bank, nullptr, 1, nullptr);
+		ChangeMusicSettingString(zmusic_adl_custom_bank, nullptr, file.c_str());
+		break;
+	case MDEV_GUS:			ChangeMusicSettingString(zmusic_gus_config, nullptr, file.c_str()); break;
+	case MDEV_TIMIDITY:		ChangeMusicSettingString(zmusic_timidity_config, nullptr, file.c_str()); break;
+	case MDEV_WILDMIDI:		ChangeMusicSettingString(zmusic_wildmidi_config, nullptr, file.c_str()); break;
+	case MDEV_FLUIDSYNTH:	ChangeMusicSettingString(zmusic_fluid_patchset, nullptr, file.c_str()); break;
+	default: break;
+	}
+	return true;
+}
+
+static bool Matches(const Options &opt, const std::string &song, const char *device)
+{
+	return opt.Filter.empty() || song.find(opt.Filter) != std::string::npos || strstr(device, opt.Filter.c_str()) != nullptr;
+}
+
+int main(int argc, char **argv)
+{
+	Options opt;
+	for (int i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		if (arg[0] != '-' || arg[1] == 0 || arg[2] != 0 || i + 1 >= argc)
+		{
+			Usage();
+			return 1;
+		}
+		const char *val = argv[++i];
+		switch (arg[1])
+		{
+		case 'l': opt.Seconds = atoi(val); break;
+		case 'r': opt.SampleRate = atoi(val); break;
+		case 'c': opt.Corpus = fs::u8path(val); break;
+		case 'f': opt.Filter = val; break;
+		case 'i':
+		{
+			auto eq = strchr(val, '=');
+			auto dev = std::find_if(std::begin(Devices), std::end(Devices), [&](const auto &d) { return eq && size_t(eq - val) == strlen(d.name) && !strncmp(val, d.name, eq - val); });
+			if (dev == std::end(Devices))
+			{
+				fprintf(stderr, "Unknown device in '%s'\n", val);
+				return 1;
+			}
+			opt.DeviceData[dev->dev] = eq + 1;
+			break;
+		}
+		default:
+			Usage();
+			return 1;
+		}
+	}
+	if (opt.SampleRate <= 0 || opt.Seconds <= 0)
+	{
+		Usage();
+		return 1;
+	}
+
+	ZMusicCallbacks callbacks = {};
+	callbacks.MessageFunc = MessageFunc;
+	ZMusic_SetCallbacks(&callbacks);
+	ChangeMusicSettingInt(zmusic_snd_outputrate, nullptr, opt.SampleRate, nullptr);
+	ChangeMusicSettingInt(zmusic_mod_samplerate, nullptr, opt.SampleRate, nullptr);
+	for (auto &d : Devices)
+	{
+		if (!SetupDevice(opt, d.dev))
+		{
+			fprintf(stderr, "%s: Unable to load %s\n", d.name, opt.DeviceData[d.dev].c_str());
+			return 1;
+		}
+	}
+
+	std::vector<Song> songs;
+	songs.push_back({ "generated/dense.mid", MakeDenseMIDI(), true });
+	songs.push_back({ "generated/64channels.it", MakeIT(), false });
+	songs.push_back({ "generated/genesis.vgm", MakeVGM(), false });
+	songs.push_back({ "generated/sweep.wav", MakeWAV(), false });
+
+	if (!opt.Corpus.empty())
+	{
+		std::vector<fs::path> files;
+		std::error_code ec;
+		for (auto it = fs::recursive_directory_iterator(opt.Corpus, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+		{
+			if (it->is_regular_file(ec)) files.push_back(it->path());
+		}
+		if (ec)
+		{
+			fprintf(stderr, "%s: %s\n", opt.Corpus.u8string().c_str(), ec.message().c_str());
+			return 1;
+		}
+		std::sort(files.begin(), files.end());
+		for (auto &file : files)
+		{
+			Song song = { file.lexically_relative(opt.Corpus).generic_u8string(), {}, false };
+			FILE *f = fopen(file.u8string().c_str(), "rb");
+			if (f == nullptr) continue;
+			fseek(f, 0, SEEK_END);
+			song.Data.resize(ftell(f));
+			fseek(f, 0, SEEK_SET);
+			bool ok = fread(song.Data.data(), 1, song.Data.size(), f) == song.Data.size();
+			fclose(f);
+			if (!ok || song.Data.size() < 4) continue;
+			song.IsMIDI = ZMusic_IdentifyMIDIType((uint32_t*)song.Data.data(), (int)std::min<size_t>(song.Data.size(), 32)) != MIDI_NOTMIDI;
+			songs.push_back(std::move(song));
+		}
+	}
+
+	printf("{\n\t\"samplerate\": %d,\n\t\"seconds\": %d,\n\t\"results\": [", opt.SampleRate, opt.Seconds);
+	bool first = true;
+	for (auto &song : songs)
+	{
+		if (song.IsMIDI)
+		{
+			for (auto &d : Devices)
+			{
+				if (Matches(opt, song.Name, d.name)) Benchmark(opt, song, d.dev, d.name, first);
+			}
+		}
+		else if (Matches(opt, song.Name, "stream"))
+		{
+			Benchmark(opt, song, MDEV_DEFAULT, "stream", first);
+		}
+	}
+	printf("\n\t],\n\t\"peak_rss_kb\": %llu\n}\n", (unsigned long long)PeakRSS());
+	return 0;
+}